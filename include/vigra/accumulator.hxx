@@ -55,6 +55,7 @@
 #include "polygon.hxx"
 #include "functorexpression.hxx"
 #include "labelimage.hxx"
+#include "sized_int.hxx"
 #include <algorithm>
 #include <iostream>
 
@@ -335,6 +336,8 @@ Pixel coordinates are always at index 0. To collect statistics, you simply pass
     - Histogram accumulators have two members for outliers (left_outliers, right_outliers).
 
     With the StandardQuantiles class, <b>histogram quantiles</b> (0%, 10%, 25%, 50%, 75%, 90%, 100%) are computed from a given histgram using linear interpolation. The return type is TinyVector<double, 7> .
+    
+    When the data range is unknown and a second pass is too expensive (e.g. for large or chunked data), <tt>StandardQuantiles<TDigest<100> ></tt> estimates the quantiles in a single pass from a mergeable data summary (see \ref vigra::acc::TDigest).
 
     \anchor acc_hist_options Usage:
     \code
@@ -1199,9 +1202,105 @@ VIGRA_SHAPE_OF(long double)
 
 #undef VIGRA_SHAPE_OF
 
+    // Open-addressing hash table (linear probing) that maps region labels to 
+    // consecutive indices in the order of first appearance. Used by LabelDispatch
+    // when sparse label storage is requested.
+class SparseLabelIndex
+{
+  public:
+    SparseLabelIndex()
+    : keys_(),
+      indices_(),
+      labels_(),
+      mask_(0)
+    {}
+    
+    unsigned int size() const
+    {
+        return labels_.size();
+    }
+    
+        // label of the region at index k
+    MultiArrayIndex label(unsigned int k) const
+    {
+        return labels_[k];
+    }
+    
+        // index of 'label', or -1 if the label is unknown
+    MultiArrayIndex find(MultiArrayIndex label) const
+    {
+        if(indices_.size() == 0)
+            return -1;
+        for(std::size_t k = hash(label) & mask_; ; k = (k + 1) & mask_)
+        {
+            if(indices_[k] == 0)
+                return -1;
+            if(keys_[k] == label)
+                return indices_[k] - 1;
+        }
+    }
+    
+        // index of 'label', a new index is assigned if the label is unknown
+    MultiArrayIndex insert(MultiArrayIndex label, bool & inserted)
+    {
+        if(2*(labels_.size() + 1) > indices_.size())
+            rehash(std::max<std::size_t>(16, 2*indices_.size()));
+        std::size_t k = hash(label) & mask_;
+        for(; indices_[k] != 0; k = (k + 1) & mask_)
+        {
+            if(keys_[k] == label)
+            {
+                inserted = false;
+                return indices_[k] - 1;
+            }
+        }
+        keys_[k] = label;
+        labels_.push_back(label);
+        indices_[k] = labels_.size();
+        inserted = true;
+        return labels_.size() - 1;
+    }
+    
+    void clear()
+    {
+        ArrayVector<MultiArrayIndex>().swap(keys_);
+        ArrayVector<MultiArrayIndex>().swap(indices_);
+        ArrayVector<MultiArrayIndex>().swap(labels_);
+        mask_ = 0;
+    }
+    
+  private:
+    static std::size_t hash(MultiArrayIndex label)
+    {
+        UInt64 h = (UInt64)label * 0x9E3779B97F4A7C15ull;
+        return (std::size_t)(h ^ (h >> 32));
+    }
+    
+    void rehash(std::size_t capacity)
+    {
+            // indices_ stores index+1, so that 0 marks an empty slot
+        keys_.resize(capacity);
+        indices_.resize(capacity);
+        std::fill(indices_.begin(), indices_.end(), 0);
+        mask_ = capacity - 1;
+        for(unsigned int i=0; i<labels_.size(); ++i)
+        {
+            std::size_t k = hash(labels_[i]) & mask_;
+            while(indices_[k] != 0)
+                k = (k + 1) & mask_;
+            keys_[k] = labels_[i];
+            indices_[k] = i + 1;
+        }
+    }
+    
+    ArrayVector<MultiArrayIndex> keys_, indices_, labels_;
+    std::size_t mask_;
+};
+
     // LabelDispatch is only used in AccumulatorChainArrays and has the following functionalities:
     //  * hold an accumulator chain for global statistics
     //  * hold an array of accumulator chains (one per region) for region statistics
+    //    (indexed by label, or by a SparseLabelIndex in sparse mode)
     //  * forward data to the appropriate chains
     //  * allocate the region array with appropriate size
     //  * store and forward activation requests
@@ -1249,6 +1348,9 @@ struct LabelDispatch
     MultiArrayIndex ignore_label_;
     ActiveFlagsType active_region_accumulators_;
     CoordinateType coordinateOffset_;
+    bool sparse_labels_;
+    SparseLabelIndex sparse_index_;
+    MultiArrayIndex sparse_max_label_, last_label_, last_index_;
     
     template <class TAG>
     struct ActivateImpl
@@ -1301,7 +1403,12 @@ struct LabelDispatch
       regions_(),
       region_histogram_options_(),
       ignore_label_(-1),
-      active_region_accumulators_()
+      active_region_accumulators_(),
+      sparse_labels_(false),
+      sparse_index_(),
+      sparse_max_label_(-1),
+      last_label_(0),
+      last_index_(-1)
     {}
     
     LabelDispatch(LabelDispatch const & o)
@@ -1309,7 +1416,13 @@ struct LabelDispatch
       regions_(o.regions_),
       region_histogram_options_(o.region_histogram_options_),
       ignore_label_(o.ignore_label_),
-      active_region_accumulators_(o.active_region_accumulators_)
+      active_region_accumulators_(o.active_region_accumulators_),
+      coordinateOffset_(o.coordinateOffset_),
+      sparse_labels_(o.sparse_labels_),
+      sparse_index_(o.sparse_index_),
+      sparse_max_label_(o.sparse_max_label_),
+      last_label_(o.last_label_),
+      last_index_(o.last_index_)
     {
         for(unsigned int k=0; k<regions_.size(); ++k)
         {
@@ -1319,21 +1432,108 @@ struct LabelDispatch
     
     MultiArrayIndex maxRegionLabel() const
     {
-        return (MultiArrayIndex)regions_.size() - 1;
+        return sparse_labels_
+                   ? sparse_max_label_
+                   : (MultiArrayIndex)regions_.size() - 1;
     }
     
     void setMaxRegionLabel(unsigned maxlabel)
     {
+        if(sparse_labels_)
+        {
+            // regions are only allocated when their label is encountered
+            sparse_max_label_ = std::max<MultiArrayIndex>(sparse_max_label_, maxlabel);
+            return;
+        }
         if(maxRegionLabel() == (MultiArrayIndex)maxlabel)
             return;
         unsigned int oldSize = regions_.size();
         regions_.resize(maxlabel + 1);
         for(unsigned int k=oldSize; k<regions_.size(); ++k)
+            initRegion(regions_[k]);
+    }
+    
+    void initRegion(RegionAccumulatorChain & region)
+    {
+        getAccumulator<AccumulatorEnd>(region).setGlobalAccumulator(&next_);
+        getAccumulator<AccumulatorEnd>(region).active_accumulators_ = active_region_accumulators_;
+        region.applyHistogramOptions(region_histogram_options_);
+        region.setCoordinateOffsetImpl(coordinateOffset_);
+    }
+    
+    void setSparseLabels(bool sparse)
+    {
+        vigra_precondition(regions_.size() == 0,
+             "AccumulatorChainArray::setSparseLabels(): must be called before the first region is created.");
+        sparse_labels_ = sparse;
+    }
+    
+    bool sparseLabels() const
+    {
+        return sparse_labels_;
+    }
+    
+        // map a region label to an index into regions_
+    MultiArrayIndex regionIndex(MultiArrayIndex label) const
+    {
+        if(!sparse_labels_)
+            return label;
+        MultiArrayIndex k = sparse_index_.find(label);
+        vigra_precondition(k >= 0,
+             "AccumulatorChainArray: region label not found.");
+        return k;
+    }
+    
+        // map an index into regions_ to the corresponding region label
+    MultiArrayIndex regionLabel(unsigned int k) const
+    {
+        return sparse_labels_
+                   ? sparse_index_.label(k)
+                   : (MultiArrayIndex)k;
+    }
+    
+        // in sparse mode, allocate a region the first time its label is encountered
+    template <class U>
+    MultiArrayIndex passIndex(MultiArrayIndex label, U const & t)
+    {
+        if(!sparse_labels_)
+            return label;
+        if(last_index_ >= 0 && label == last_label_)
+            return last_index_;
+        bool inserted = false;
+        MultiArrayIndex k = sparse_index_.insert(label, inserted);
+        if(inserted)
         {
-            getAccumulator<AccumulatorEnd>(regions_[k]).setGlobalAccumulator(&next_);
-            getAccumulator<AccumulatorEnd>(regions_[k]).active_accumulators_ = active_region_accumulators_;
-            regions_[k].applyHistogramOptions(region_histogram_options_);
-            regions_[k].setCoordinateOffsetImpl(coordinateOffset_);
+            regions_.push_back(RegionAccumulatorChain());
+            initRegion(regions_.back());
+            regions_.back().resize(t);
+            sparse_max_label_ = std::max(sparse_max_label_, label);
+        }
+        last_label_ = label;
+        last_index_ = k;
+        return k;
+    }
+    
+        // merge accumulator chain 'region' into the region with the given label
+        // (in sparse mode, the label is added if it doesn't exist yet)
+    void mergeRegion(MultiArrayIndex label, RegionAccumulatorChain const & region)
+    {
+        if(!sparse_labels_)
+        {
+            regions_[label].mergeImpl(region);
+            return;
+        }
+        bool inserted = false;
+        MultiArrayIndex k = sparse_index_.insert(label, inserted);
+        if(inserted)
+        {
+            regions_.push_back(region);
+            getAccumulator<AccumulatorEnd>(regions_.back()).setGlobalAccumulator(&next_);
+            sparse_max_label_ = std::max(sparse_max_label_, label);
+        }
+        else
+        {
+            regions_[k].mergeImpl(region);
         }
     }
     
@@ -1375,15 +1575,15 @@ struct LabelDispatch
     
     void setCoordinateOffsetImpl(MultiArrayIndex k, CoordinateType const & offset)
     {
-        vigra_precondition(0 <= k && k < (MultiArrayIndex)regions_.size(),
+        vigra_precondition(0 <= k && k <= maxRegionLabel() && (!sparse_labels_ || sparse_index_.find(k) >= 0),
              "Accumulator::setCoordinateOffset(k, offset): region k does not exist.");
-        regions_[k].setCoordinateOffsetImpl(offset);
+        regions_[regionIndex(k)].setCoordinateOffsetImpl(offset);
     }
     
     template <class U>
     void resize(U const & t)
     {
-        if(regions_.size() == 0)
+        if(regions_.size() == 0 && !sparse_labels_)
         {
             typedef HandleArgSelector<U, LabelArgTag, GlobalAccumulatorChain> LabelHandle;
             typedef typename LabelHandle::value_type LabelType;
@@ -1408,7 +1608,7 @@ struct LabelDispatch
         if(LabelHandle::getValue(t) != ignore_label_)
         {
             next_.template pass<N>(t);
-            regions_[LabelHandle::getValue(t)].template pass<N>(t);
+            regions_[passIndex(LabelHandle::getValue(t), t)].template pass<N>(t);
         }
     }
     
@@ -1419,7 +1619,7 @@ struct LabelDispatch
         if(LabelHandle::getValue(t) != ignore_label_)
         {
             next_.template pass<N>(t, weight);
-            regions_[LabelHandle::getValue(t)].template pass<N>(t, weight);
+            regions_[passIndex(LabelHandle::getValue(t), t)].template pass<N>(t, weight);
         }
     }
     
@@ -1440,6 +1640,9 @@ struct LabelDispatch
         
         active_region_accumulators_.clear();
         RegionAccumulatorArray().swap(regions_);
+        sparse_index_.clear();
+        sparse_max_label_ = -1;
+        last_index_ = -1;
         // FIXME: or is it better to just reset the region accumulators?
         // for(unsigned int k=0; k<regions_.size(); ++k)
             // regions_[k].reset();
@@ -1467,16 +1670,28 @@ struct LabelDispatch
     
     void mergeImpl(LabelDispatch const & o)
     {
-        for(unsigned int k=0; k<regions_.size(); ++k)
-            regions_[k].mergeImpl(o.regions_[k]);
+        if(sparse_labels_ || o.sparse_labels_)
+        {
+            // match regions by label
+            setMaxRegionLabel(std::max(maxRegionLabel(), o.maxRegionLabel()));
+            for(unsigned int k=0; k<o.regions_.size(); ++k)
+                mergeRegion(o.regionLabel(k), o.regions_[k]);
+        }
+        else
+        {
+            for(unsigned int k=0; k<regions_.size(); ++k)
+                regions_[k].mergeImpl(o.regions_[k]);
+        }
         next_.mergeImpl(o.next_);
     }
     
     void mergeImpl(unsigned i, unsigned j)
     {
-        regions_[i].mergeImpl(regions_[j]);
-        regions_[j].reset();
-        getAccumulator<AccumulatorEnd>(regions_[j]).active_accumulators_ = active_region_accumulators_;
+        MultiArrayIndex ki = regionIndex(i),
+                        kj = regionIndex(j);
+        regions_[ki].mergeImpl(regions_[kj]);
+        regions_[kj].reset();
+        getAccumulator<AccumulatorEnd>(regions_[kj]).active_accumulators_ = active_region_accumulators_;
     }
     
     template <class ArrayLike>
@@ -1485,7 +1700,7 @@ struct LabelDispatch
         MultiArrayIndex newMaxLabel = std::max<MultiArrayIndex>(maxRegionLabel(), *argMax(labelMapping.begin(), labelMapping.end()));
         setMaxRegionLabel(newMaxLabel);
         for(unsigned int k=0; k<labelMapping.size(); ++k)
-            regions_[labelMapping[k]].mergeImpl(o.regions_[k]);
+            mergeRegion(labelMapping[k], o.regions_[k]);
         next_.mergeImpl(o.next_);
     }
 };
@@ -2280,26 +2495,71 @@ class AccumulatorChainArray
     }
     
     /** Set the maximum region label (e.g. for merging two accumulator chains).
+        In sparse mode, this only updates maxRegionLabel(), but doesn't allocate any regions.
     */
     void setMaxRegionLabel(unsigned label)
     {
         this->next_.setMaxRegionLabel(label);
     }
     
-    /** Maximum region label. (equal to regionCount() - 1)
+    /** Maximum region label. (equal to regionCount() - 1, unless sparse labels are used)
     */
     MultiArrayIndex maxRegionLabel() const
     {
         return this->next_.maxRegionLabel();
     }
     
-    /** Number of Regions. (equal to maxRegionLabel() + 1)
+    /** Number of Regions. (equal to maxRegionLabel() + 1, unless sparse labels are used)
     */
     unsigned int regionCount() const
     {
         return this->next_.regions_.size();
     }
     
+    /** Switch sparse label storage on or off (default: off).
+
+        By default, the accumulator allocates a chain of region accumulators for 
+        every label in the range <tt>[0, maxRegionLabel()]</tt>. This is wasteful
+        when only a few labels occur, but their values are large (e.g. in a crop 
+        of a global segmentation). In sparse mode, a region chain is only created 
+        when its label is encountered in the data, and a hash table maps labels
+        to regions. Statistics are still accessed via <tt>get<TAG>(a, label)</tt>, 
+        but querying a label that didn't occur raises a <tt>PreconditionViolation</tt>.
+        Since regionCount() is then the number of labels actually found, regions 
+        should be enumerated via regionLabel():
+        \code
+        AccumulatorChainArray<CoupledArrays<3, float, UInt32>, 
+                              Select<DataArg<1>, LabelArg<2>, Count, Mean> > a;
+        a.setSparseLabels(true);
+        extractFeatures(data, labels, a);
+        
+        for(unsigned int k=0; k<a.regionCount(); ++k)
+            std::cout << "region " << a.regionLabel(k) << ": mean " 
+                      << get<Mean>(a, a.regionLabel(k)) << "\n";
+        \endcode
+        This function must be called before the accumulator sees any data.
+    */
+    void setSparseLabels(bool sparse = true)
+    {
+        this->next_.setSparseLabels(sparse);
+    }
+    
+    /** Check if sparse label storage is active (see setSparseLabels()).
+    */
+    bool sparseLabels() const
+    {
+        return this->next_.sparseLabels();
+    }
+    
+    /** Label of the k-th region, <tt>0 <= k < regionCount()</tt>. Without sparse label 
+        storage, this is simply <tt>k</tt>. Otherwise, regions are enumerated in the order 
+        of first appearance of their labels.
+    */
+    MultiArrayIndex regionLabel(unsigned int k) const
+    {
+        return this->next_.regionLabel(k);
+    }
+    
     /** Equivalent to <tt>merge(o)</tt>.
     */
     void operator+=(AccumulatorChainArray const & o)
@@ -2316,18 +2576,24 @@ class AccumulatorChainArray
         this->next_.mergeImpl(i, j);
     }
     
-    /** Merge with accumulator chain o. maxRegionLabel() of the two accumulators must be equal.
+    /** Merge with accumulator chain o. maxRegionLabel() of the two accumulators must be equal,
+        unless one of them uses sparse label storage. Then, regions are matched by their labels, 
+        and regions of o whose label doesn't occur in *this are added (sparse mode) or
+        the region array is enlarged (dense mode).
     */
     void merge(AccumulatorChainArray const & o)
     {
-        if(maxRegionLabel() == -1)
-            setMaxRegionLabel(o.maxRegionLabel());
-        vigra_precondition(maxRegionLabel() == o.maxRegionLabel(),
-            "AccumulatorChainArray::merge(): maxRegionLabel must be equal.");
+        if(!sparseLabels() && !o.sparseLabels())
+        {
+            if(maxRegionLabel() == -1)
+                setMaxRegionLabel(o.maxRegionLabel());
+            vigra_precondition(maxRegionLabel() == o.maxRegionLabel(),
+                "AccumulatorChainArray::merge(): maxRegionLabel must be equal.");
+        }
         this->next_.mergeImpl(o.next_);
     }
 
-    /** Merge with accumulator chain o using a mapping between labels of the two accumulators. Label l of accumulator chain o is mapped to labelMapping[l]. Hence, all elements of labelMapping must be <= maxRegionLabel() and size of labelMapping must match o.regionCount().
+    /** Merge with accumulator chain o using a mapping between labels of the two accumulators. Region k of accumulator chain o (i.e. label <tt>o.regionLabel(k)</tt>) is mapped to labelMapping[k]. Hence, size of labelMapping must match o.regionCount().
     */
     template <class ArrayLike>
     void merge(AccumulatorChainArray const & o, ArrayLike const & labelMapping)
@@ -2731,7 +2997,7 @@ struct CastImpl<Tag, LabelDispatchTag, reference>
     template <class A>
     static reference exec(A & a, MultiArrayIndex label)
     {
-        return CastImpl<Tag, typename A::RegionAccumulatorChain::Tag, reference>::exec(a.regions_[label]);
+        return CastImpl<Tag, typename A::RegionAccumulatorChain::Tag, reference>::exec(a.regions_[a.regionIndex(label)]);
     }
 };
 
@@ -2954,6 +3220,8 @@ namespace vigra { namespace acc {
 \endcode
 Of course, the number and types of the arrays specified in <tt>CoupledArrays</tt> must conform to the number and types of the arrays passed to <tt>extractFeatures()</tt>.
 
+Region statistics of volumes that do not fit into memory can be computed chunk by chunk from \ref ChunkedArray data and labels, optionally using multiple threads. The corresponding overload of <tt>extractFeatures()</tt> is defined in \<vigra/blockwise_features.hxx\>.
+
 See \ref FeatureAccumulators for more information about feature computation via accumulators.
 */
 doxygen_overloaded_function(template <...> void extractFeatures)
@@ -5921,9 +6189,248 @@ class GlobalRangeHistogram
     };
 };
 
+namespace acc_detail {
+
+struct TDigestCentroidLess
+{
+    bool operator()(TinyVector<double, 2> const & l, TinyVector<double, 2> const & r) const
+    {
+        return l[0] < r[0];
+    }
+};
+
+} // namespace acc_detail
+
+template <int N>
+struct TDigest_compression_must_be_positive
+: vigra::staticAssert::AssertBool<(N > 0)>
+{};
+
+/** \brief Approximate quantiles of the data in a single pass (t-digest).
+
+    The data distribution is summarized by a sorted list of centroids (mean, weight) whose
+    maximal weight is small near the tails and larger near the median (scale function 
+    <tt>k(q) = Compression / (2 pi) * asin(2q - 1)</tt>, see T. Dunning and O. Ertl:
+    <i>"Computing Extremely Accurate Quantiles Using t-Digests"</i>, 2019). The number of
+    centroids stays below <tt>2*Compression</tt>, regardless of the number of data points,
+    and the relative error of the quantile estimates is smallest for quantiles near 0 and 1.
+    Thus, the accumulator requires neither a predefined data range nor a second pass
+    like AutoRangeHistogram, and it can be combined with StandardQuantiles:
+    
+    \code
+    AccumulatorChainArray<CoupledArrays<3, float, UInt32>, 
+                          Select<DataArg<1>, LabelArg<2>, StandardQuantiles<TDigest<100> > > > a;
+    extractFeatures(data, labels, a);  // single pass
+    
+    TinyVector<double, 7> q = get<StandardQuantiles<TDigest<100> > >(a, 1);
+    double q95 = getAccumulator<TDigest<100> >(a, 1).quantile(0.95);
+    \endcode
+
+    - The return type of the accumulator is <tt>ArrayVector<TinyVector<double, 2> > const &</tt>,
+      i.e. the list of centroids (mean, weight), sorted by mean.
+    - Works in pass 1, %operator+=() is supported (merging), so the accumulator can be used 
+      in block-wise and parallel feature extraction.
+    - Memory grows with the number of data points: a region with n points holds at most
+      about 2n entries (and never more than <tt>5*Compression</tt> buffered points plus
+      the centroids), so that per-region digests of many small regions stay cheap.
+    - Only scalar data are supported.
+*/
+template <int Compression>
+class TDigest
+{
+  public:
+    
+    typedef Select<> Dependencies;
+    
+    static std::string name() 
+    { 
+        return std::string("TDigest<") + asString(Compression) + ">";
+    }
+    
+    template <class U, class BASE>
+    struct Impl
+    : public BASE
+    {
+        typedef TinyVector<double, 2>       centroid_type;
+        typedef ArrayVector<centroid_type>  value_type;
+        typedef value_type const &          result_type;
+        
+        static const int bufferSize = 5*Compression;
+        
+        mutable value_type value_, buffer_;
+        double count_, minimum_, maximum_;
+        
+        Impl()
+        : value_(),
+          buffer_(),
+          count_(0.0),
+          minimum_(NumericTraits<double>::max()),
+          maximum_(-NumericTraits<double>::max())
+        {
+            VIGRA_STATIC_ASSERT((TDigest_compression_must_be_positive<Compression>));
+        }
+        
+        void reset()
+        {
+            value_.clear();
+            buffer_.clear();
+            count_ = 0.0;
+            minimum_ = NumericTraits<double>::max();
+            maximum_ = -NumericTraits<double>::max();
+        }
+    
+        void update(U const & t)
+        {
+            update(t, 1.0);
+        }
+        
+        void update(U const & t, double weight)
+        {
+            if(weight <= 0.0)
+                return;
+            buffer_.push_back(centroid_type((double)t, weight));
+            count_ += weight;
+            minimum_ = std::min(minimum_, (double)t);
+            maximum_ = std::max(maximum_, (double)t);
+            if((int)buffer_.size() >= bufferSize)
+            {
+                compress();
+            }
+            else if(buffer_.size() == buffer_.capacity())
+            {
+                // grow with the region's sample count, but never beyond bufferSize
+                buffer_.reserve(std::min<std::size_t>(2*buffer_.capacity(), bufferSize));
+            }
+        }
+        
+        void operator+=(Impl const & o)
+        {
+            if(o.count_ == 0.0)
+                return;
+            compress();
+            o.compress();
+            count_ += o.count_;
+            minimum_ = std::min(minimum_, o.minimum_);
+            maximum_ = std::max(maximum_, o.maximum_);
+            mergeCentroids(o.value_);
+        }
+        
+            // merge the buffered points into the centroid list
+        void compress() const
+        {
+            if(buffer_.size() == 0)
+                return;
+            std::sort(buffer_.begin(), buffer_.end(), acc_detail::TDigestCentroidLess());
+            mergeCentroids(buffer_);
+            buffer_.clear();
+        }
+        
+            // merge a sorted list of centroids into the centroid list
+        void mergeCentroids(value_type const & sorted) const
+        {
+            value_type merged(value_.size() + sorted.size());
+            std::merge(value_.begin(), value_.end(), sorted.begin(), sorted.end(),
+                       merged.begin(), acc_detail::TDigestCentroidLess());
+            value_.clear();
+            
+            double normalizer = Compression / (2.0 * M_PI),
+                   cumulative = 0.0,
+                   limit      = count_ * inverseScale(scale(0.0, normalizer) + 1.0, normalizer);
+            centroid_type current = merged[0];
+            for(unsigned int k=1; k<merged.size(); ++k)
+            {
+                if(cumulative + current[1] + merged[k][1] <= limit)
+                {
+                    current[1] += merged[k][1];
+                    current[0] += (merged[k][0] - current[0]) * merged[k][1] / current[1];
+                }
+                else
+                {
+                    cumulative += current[1];
+                    value_.push_back(current);
+                    limit = count_ * inverseScale(scale(cumulative / count_, normalizer) + 1.0, normalizer);
+                    current = merged[k];
+                }
+            }
+            value_.push_back(current);
+        }
+        
+        static double scale(double q, double normalizer)
+        {
+            return normalizer * std::asin(2.0*q - 1.0);
+        }
+        
+        static double inverseScale(double k, double normalizer)
+        {
+            if(k >= normalizer * M_PI / 2.0)
+                return 1.0;
+            return 0.5 * (std::sin(k / normalizer) + 1.0);
+        }
+        
+            /** Estimate the quantile \a q (0 <= q <= 1) by linear interpolation 
+                between the centroids. Returns 0 if no data were seen.
+            */
+        double quantile(double q) const
+        {
+            compress();
+            if(value_.size() == 0)
+                return 0.0;
+            if(q <= 0.0)
+                return minimum_;
+            if(q >= 1.0)
+                return maximum_;
+                
+            double index = q * count_;
+            int size = (int)value_.size();
+            
+            // centroids are considered to be located at the center of their weight;
+            // outside of the first and last center, interpolate towards min and max
+            if(index < value_[0][1] / 2.0)
+                return minimum_ + (value_[0][0] - minimum_) * index / (value_[0][1] / 2.0);
+                
+            double cumulative = value_[0][1] / 2.0;
+            for(int k=0; k<size-1; ++k)
+            {
+                double step = (value_[k][1] + value_[k+1][1]) / 2.0;
+                if(index < cumulative + step)
+                    return value_[k][0] + (value_[k+1][0] - value_[k][0]) * (index - cumulative) / step;
+                cumulative += step;
+            }
+            double rest = value_[size-1][1] / 2.0;
+            return rest > 0.0
+                      ? value_[size-1][0] + (maximum_ - value_[size-1][0]) * std::min(1.0, (index - cumulative) / rest)
+                      : maximum_;
+        }
+        
+        template <class ArrayLike>
+        void computeStandardQuantiles(double minimum, double maximum, double count, 
+                                      ArrayLike const & desiredQuantiles, ArrayLike & res) const
+        {
+            if(count == 0.0)
+                return;
+            for(int k=0; k<(int)desiredQuantiles.size(); ++k)
+            {
+                if(desiredQuantiles[k] == 0.0)
+                    res[k] = minimum;
+                else if(desiredQuantiles[k] == 1.0)
+                    res[k] = maximum;
+                else
+                    res[k] = quantile(desiredQuantiles[k]);
+            }
+        }
+        
+        result_type operator()() const
+        {
+            compress();
+            return value_;
+        }
+    };
+};
+
 /** \brief Compute (0%, 10%, 25%, 50%, 75%, 90%, 100%) quantiles from given histogram.
 
-    Return type is TinyVector<double, 7> . 
+    Return type is TinyVector<double, 7> . Instead of a histogram, a TDigest can be passed 
+    to get approximate quantiles in a single pass. 
 */
 template <class HistogramAccumulator> 
 class StandardQuantiles
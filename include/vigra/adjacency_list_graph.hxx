@@ -223,6 +223,13 @@ namespace vigra{
 
     /** \brief undirected adjacency list graph in the LEMON API 
 
+        While the graph is being built, each node keeps its neighbors in a sorted
+        set. Once construction is finished, freeze() can be called to move the
+        adjacency of all nodes into two flat arrays (compressed sparse row
+        format). This saves a lot of memory for large graphs (e.g. region
+        adjacency graphs with millions of nodes), and incident edges are then
+        visited with contiguous loads by all graph algorithms.
+        A frozen graph cannot be modified anymore.
     */
     class AdjacencyListGraph
     {
@@ -466,11 +473,25 @@ namespace vigra{
         size_t maxDegree()const{
             size_t md=0;
             for(NodeIt it(*this);it!=lemon::INVALID;++it){
-                std::max(md, size_t( degree(*it) ) );
+                md = std::max(md, size_t( degree(*it) ) );
             }
             return md;
         }
 
+        /** \brief Store the adjacency of all nodes in compressed sparse row format.
+
+            The per-node adjacency sets are released afterwards. Nodes and edges
+            keep their IDs, so existing node and edge maps remain valid.
+            Subsequent calls to addNode() or addEdge() are not allowed.
+        */
+        void freeze();
+
+        /** \brief Return <tt>true</tt> if freeze() has been called.
+        */
+        bool isFrozen()const{
+            return frozen_;
+        }
+
 
         ////////////////////////
         // BOOST API
@@ -482,6 +503,8 @@ namespace vigra{
         edge_iterator    get_edge_iterator()const;
         edge_iterator    get_edge_end_iterator()const  ;
         degree_size_type degree(const vertex_descriptor & node)const{
+            if(frozen_)
+                return adjacencyOffsets_[node.id()+1] - adjacencyOffsets_[node.id()];
             return nodeImpl(node).numberOfEdges();
         }
 
@@ -491,6 +514,9 @@ namespace vigra{
         // private typedefs
         typedef std::vector<NodeStorage> NodeVector;
         typedef std::vector<EdgeStorage> EdgeVector;
+        typedef NodeStorage::AdjacencyElement AdjacencyElement;
+        typedef std::vector<AdjacencyElement> AdjacencyVector;
+        typedef NodeStorage::AdjIt AdjIt;
 
 
         // needs acces to const nodeImpl
@@ -523,7 +549,19 @@ namespace vigra{
             return nodes_[node.id()];
         }
 
+        // the sorted adjacency of a node, either from its
+        // adjacency set or from the CSR arrays of a frozen graph
+        AdjIt adjacencyBegin(const Node & node)const{
+            if(frozen_)
+                return adjacency_.begin() + adjacencyOffsets_[node.id()];
+            return nodes_[node.id()].adjacencyBegin();
+        }
 
+        AdjIt adjacencyEnd(const Node & node)const{
+            if(frozen_)
+                return adjacency_.begin() + adjacencyOffsets_[node.id()+1];
+            return nodes_[node.id()].adjacencyEnd();
+        }
 
 
 
@@ -533,6 +571,11 @@ namespace vigra{
 
         size_t nodeNum_;
         size_t edgeNum_;
+
+        // compressed sparse row adjacency (only used when frozen_)
+        std::vector<index_type> adjacencyOffsets_;
+        AdjacencyVector         adjacency_;
+        bool                    frozen_;
     };
 
 
@@ -546,15 +589,37 @@ namespace vigra{
     :   nodes_(),
         edges_(),
         nodeNum_(0),
-        edgeNum_(0)
+        edgeNum_(0),
+        adjacencyOffsets_(),
+        adjacency_(),
+        frozen_(false)
     {
         nodes_.reserve(reserveNodes);
         edges_.reserve(reserveEdges);
     }
 
+    inline void
+    AdjacencyListGraph::freeze(){
+        if(frozen_)
+            return;
+        adjacencyOffsets_.resize(nodes_.size()+1);
+        adjacencyOffsets_[0] = 0;
+        for(std::size_t n=0; n<nodes_.size(); ++n)
+            adjacencyOffsets_[n+1] = adjacencyOffsets_[n] + nodes_[n].numberOfEdges();
+
+        adjacency_.reserve(adjacencyOffsets_.back());
+        for(std::size_t n=0; n<nodes_.size(); ++n){
+            adjacency_.insert(adjacency_.end(), nodes_[n].adjacencyBegin(), nodes_[n].adjacencyEnd());
+            // release the memory of the adjacency set
+            NodeStorage(nodes_[n].id()).adjacency_.swap(nodes_[n].adjacency_);
+        }
+        frozen_ = true;
+    }
+
 
     inline AdjacencyListGraph::Node 
     AdjacencyListGraph::addNode(){
+        vigra_precondition(!frozen_, "AdjacencyListGraph::addNode(): graph is frozen.");
         const index_type id = nodes_.size();
         nodes_.push_back(NodeStorage(id));
         ++nodeNum_;
@@ -563,6 +628,7 @@ namespace vigra{
 
     inline AdjacencyListGraph::Node 
     AdjacencyListGraph::addNode(const AdjacencyListGraph::index_type id){
+        vigra_precondition(!frozen_, "AdjacencyListGraph::addNode(): graph is frozen.");
         if(id == nodes_.size()){
             nodes_.push_back(NodeStorage(id));
             ++nodeNum_;
@@ -595,6 +661,7 @@ namespace vigra{
         const AdjacencyListGraph::Node & u , 
         const AdjacencyListGraph::Node & v
     ){
+        vigra_precondition(!frozen_, "AdjacencyListGraph::addEdge(): graph is frozen.");
         const Edge foundEdge  = findEdge(u,v);
         if(foundEdge!=lemon::INVALID){
             return foundEdge;
@@ -883,9 +950,18 @@ namespace vigra{
         const AdjacencyListGraph::Node & b
     )const{
         if(a!=b){
-            std::pair<index_type,bool> res =  nodes_[id(a)].findEdge(id(b));
-            if(res.second){
-                return Edge(res.first);
+            if(frozen_){
+                const AdjIt end  = adjacencyEnd(a);
+                const AdjIt iter = std::lower_bound(adjacencyBegin(a), end, AdjacencyElement(id(b),0));
+                if(iter!=end && iter->nodeId()==id(b)){
+                    return Edge(iter->edgeId());
+                }
+            }
+            else{
+                std::pair<index_type,bool> res =  nodes_[id(a)].findEdge(id(b));
+                if(res.second){
+                    return Edge(res.first);
+                }
             }
         }
         return Edge(lemon::INVALID);
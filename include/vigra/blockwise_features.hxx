@@ -0,0 +1,271 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2015 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_BLOCKWISE_FEATURES_HXX
+#define VIGRA_BLOCKWISE_FEATURES_HXX
+
+#include "accumulator.hxx"
+#include "multi_array_chunked.hxx"
+#include "threadpool.hxx"
+
+namespace vigra {
+
+namespace acc {
+
+namespace blockwise_features_detail {
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class ACCUMULATOR>
+void 
+extractFeaturesPass(MultiArrayView<N, T1, S1> const & data,
+                    MultiArrayView<N, T2, S2> const & labels,
+                    ACCUMULATOR & a, unsigned int pass)
+{
+    typedef typename CoupledIteratorType<N, T1, T2>::type Iterator;
+    Iterator i   = createCoupledIterator(data, labels),
+             end = i.getEndIterator();
+    for(; i < end; ++i)
+        a.updatePassN(*i, pass);
+}
+
+    // Perform all passes of the accumulator chain 'a' on the given set of chunks.
+    // Coordinates are reported in the global coordinate system of the ChunkedArray.
+template <unsigned int N, class T1, class T2, class ACCUMULATOR>
+void 
+extractFeaturesInChunks(ChunkedArray<N, T1> const & data,
+                        ChunkedArray<N, T2> const & labels,
+                        ArrayVector<typename MultiArrayShape<N>::type> const & chunks,
+                        ACCUMULATOR & a)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    
+    bool sameChunkShape = (data.chunkShape() == labels.chunkShape());
+    MultiArray<N, T2> labelBuffer;
+    
+    for(unsigned int pass=1; pass <= a.passesRequired(); ++pass)
+    {
+        for(unsigned int k=0; k<chunks.size(); ++k)
+        {
+            Shape start = chunks[k] * data.chunkShape(),
+                  stop  = min(start + data.chunkShape(), data.shape());
+            typename ChunkedArray<N, T1>::chunk_const_iterator d = data.chunk_cbegin(start, stop);
+            a.setCoordinateOffset(start);
+            if(sameChunkShape)
+            {
+                typename ChunkedArray<N, T2>::chunk_const_iterator l = labels.chunk_cbegin(start, stop);
+                extractFeaturesPass(*d, *l, a, pass);
+            }
+            else
+            {
+                labelBuffer.reshape(stop - start);
+                labels.checkoutSubarray(start, labelBuffer);
+                extractFeaturesPass(*d, labelBuffer, a, pass);
+            }
+        }
+    }
+}
+
+template <unsigned int N, class T>
+struct ChunkedMaxLabelFunctor
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    
+    ChunkedArray<N, T> const & labels_;
+    Shape chunkArrayShape_;
+    ArrayVector<T> & maxima_;
+    
+    ChunkedMaxLabelFunctor(ChunkedArray<N, T> const & labels, ArrayVector<T> & maxima)
+    : labels_(labels),
+      chunkArrayShape_(labels.chunkArrayShape()),
+      maxima_(maxima)
+    {}
+    
+    void operator()(int thread, MultiArrayIndex k)
+    {
+        Shape chunk;
+        detail::ScanOrderToCoordinate<N>::exec(k, chunkArrayShape_, chunk);
+        Shape start = chunk * labels_.chunkShape(),
+              stop  = min(start + labels_.chunkShape(), labels_.shape());
+        typename ChunkedArray<N, T>::chunk_const_iterator l = labels_.chunk_cbegin(start, stop);
+        T minimum, maximum;
+        l->minmax(&minimum, &maximum);
+        maxima_[thread] = std::max(maxima_[thread], maximum);
+    }
+};
+
+template <unsigned int N, class T1, class T2, class ACCUMULATOR>
+struct ChunkedFeaturesFunctor
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    
+    ChunkedArray<N, T1> const & data_;
+    ChunkedArray<N, T2> const & labels_;
+    ArrayVector<ArrayVector<Shape> > const & chunks_;
+    ACCUMULATOR & first_;
+    ArrayVector<ACCUMULATOR> & others_;
+    
+    ChunkedFeaturesFunctor(ChunkedArray<N, T1> const & data, 
+                           ChunkedArray<N, T2> const & labels, 
+                           ArrayVector<ArrayVector<Shape> > const & chunks, 
+                           ACCUMULATOR & first,
+                           ArrayVector<ACCUMULATOR> & others)
+    : data_(data),
+      labels_(labels),
+      chunks_(chunks),
+      first_(first),
+      others_(others)
+    {}
+    
+    void operator()(int, MultiArrayIndex k)
+    {
+        extractFeaturesInChunks(data_, labels_, chunks_[k], 
+                                k == 0 ? first_ : others_[k-1]);
+    }
+};
+
+} // namespace blockwise_features_detail
+
+/** \brief Compute region statistics directly from ChunkedArrays.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra { namespace acc {
+        template <unsigned int N, class T1, class T2, class ACCUMULATOR>
+        void 
+        extractFeatures(ChunkedArray<N, T1> const & data,
+                        ChunkedArray<N, T2> const & labels,
+                        ACCUMULATOR & a,
+                        ParallelOptions const & options = ParallelOptions());
+    }}
+    \endcode
+
+    This is the out-of-core counterpart of \ref extractFeatures() for an 
+    \ref AccumulatorChainArray "AccumulatorChainArray<CoupledArrays<N, T1, T2>, Select<DataArg<1>, LabelArg<2>, ...> >". 
+    The arrays are processed chunk by chunk (the chunk shape of \a data 
+    determines the blocking), so that the complete volume never has to be 
+    checked out at once. Coordinate-based statistics such as <tt>RegionCenter</tt>
+    are computed in the global coordinate system of the arrays. If the labels
+    have a different chunk shape than the data, each block of labels is copied 
+    into a temporary buffer, otherwise chunks are accessed without copying.
+
+    If the accumulator's region count has not been set (i.e. <tt>a.maxRegionLabel() == -1</tt>),
+    the maximum label is determined by a preliminary scan over the label chunks
+    (this is unnecessary and skipped when <tt>a.setSparseLabels(true)</tt> was called).
+    If the selected statistics require several passes over the data (e.g. 
+    <tt>Central<PowerSum<2> ></tt> or histograms with automatic range), each 
+    pass is a separate sweep over the chunks.
+    
+    The chunks are distributed over <tt>options.getActualNumThreads()</tt> threads.
+    Each thread works on its own copy of \a a (which must not 
+    have seen any data yet), and the thread-local results are finally merged 
+    into \a a via <tt>operator+=</tt>. Multi-threading 
+    is therefore only possible when all selected statistics support merging 
+    (see \ref FeatureAccumulators). Pass <tt>ParallelOptions().numThreads(1)</tt> otherwise.
+    The assignment of chunks to threads is deterministic, so that the result 
+    only depends on the number of threads, not on thread scheduling.
+    Statistics of later passes depend on the complete results of the previous pass 
+    (e.g. the range of an <tt>AutoRangeHistogram</tt>), so chains requiring more 
+    than one pass are always computed by a single thread.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_features.hxx\><br>
+    Namespace: vigra::acc
+
+    \code
+    ChunkedArrayLazy<3, float>    data(Shape3(2000, 2000, 2000));
+    ChunkedArrayLazy<3, UInt32> labels(Shape3(2000, 2000, 2000));
+    ... // fill data and labels
+    
+    AccumulatorChainArray<CoupledArrays<3, float, UInt32>,
+                          Select<DataArg<1>, LabelArg<2>, Count, Mean, RegionCenter> > a;
+    
+    extractFeatures(data, labels, a, ParallelOptions().numThreads(8));
+    
+    std::cout << "mean of region 5: " << get<Mean>(a, 5) << std::endl;
+    \endcode
+*/
+template <unsigned int N, class T1, class T2, class ACCUMULATOR>
+void 
+extractFeatures(ChunkedArray<N, T1> const & data,
+                ChunkedArray<N, T2> const & labels,
+                ACCUMULATOR & a,
+                ParallelOptions const & options = ParallelOptions())
+{
+    using namespace blockwise_features_detail;
+    typedef typename MultiArrayShape<N>::type Shape;
+    
+    vigra_precondition(data.shape() == labels.shape(),
+        "extractFeatures(): shape mismatch between data and labels.");
+    
+    Shape chunkArrayShape = data.chunkArrayShape();
+    MultiArrayIndex chunkCount = prod(chunkArrayShape);
+    int threadCount = a.passesRequired() > 1
+                          ? 1
+                          : (int)std::min<MultiArrayIndex>(options.getActualNumThreads(), chunkCount);
+    
+    if(!a.sparseLabels() && a.maxRegionLabel() < 0)
+    {
+        ArrayVector<T2> maxima(options.getActualNumThreads(), NumericTraits<T2>::zero());
+        parallel_foreach(options, prod(labels.chunkArrayShape()), 
+                         ChunkedMaxLabelFunctor<N, T2>(labels, maxima));
+        a.setMaxRegionLabel(*argMax(maxima.begin(), maxima.end()));
+    }
+    
+    // distribute the chunks in round-robin fashion
+    ArrayVector<ArrayVector<Shape> > chunks(std::max(threadCount, 1));
+    MultiCoordinateIterator<N> c(chunkArrayShape), cend(c.getEndIterator());
+    for(MultiArrayIndex k=0; c != cend; ++c, ++k)
+        chunks[k % chunks.size()].push_back(*c);
+    
+    if(threadCount <= 1)
+    {
+        extractFeaturesInChunks(data, labels, chunks[0], a);
+        return;
+    }
+    
+    // 'a' itself serves as the accumulator of the first thread
+    ArrayVector<ACCUMULATOR> accumulators(threadCount-1, a);
+    parallel_foreach(options, threadCount, 
+                     ChunkedFeaturesFunctor<N, T1, T2, ACCUMULATOR>(data, labels, chunks, a, accumulators));
+    for(int k=0; k<threadCount-1; ++k)
+        a.merge(accumulators[k]);
+}
+
+} // namespace acc
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_FEATURES_HXX
@@ -56,6 +56,8 @@
 #include "graph_maps.hxx"
 #include "functorexpression.hxx"
 #include "array_vector.hxx"
+#include "multi_fwd.hxx"
+#include "threadpool.hxx"
 
 namespace vigra{
 
@@ -105,6 +107,89 @@ namespace vigra{
         std::sort(sortedEdges.begin(),sortedEdges.end(),edgeComperator);
     }
 
+    namespace detail_graph_algorithms{
+        // stable merge sort: runs are sorted in parallel and then merged pairwise
+        template<class ITER, class COMPARE>
+        void parallelStableSort(ITER begin, ITER end, COMPARE const & compare, 
+                                ParallelOptions const & options)
+        {
+            const std::ptrdiff_t size = end - begin,
+                                 minRunSize = 4096,
+                                 nRuns = std::max<std::ptrdiff_t>(1, 
+                                             std::min<std::ptrdiff_t>(options.getActualNumThreads(), size / minRunSize));
+            std::vector<std::ptrdiff_t> bounds(nRuns+1);
+            for(std::ptrdiff_t k=0; k<=nRuns; ++k)
+                bounds[k] = k*size/nRuns;
+
+            parallel_foreach(options, nRuns,
+                [&](int, std::ptrdiff_t k)
+                {
+                    std::stable_sort(begin+bounds[k], begin+bounds[k+1], compare);
+                }
+            );
+            for(std::ptrdiff_t step=1; step<nRuns; step*=2)
+            {
+                parallel_foreach(options, (nRuns + 2*step - 1) / (2*step),
+                    [&](int, std::ptrdiff_t m)
+                    {
+                        const std::ptrdiff_t first  = 2*step*m,
+                                             middle = std::min(first+step, nRuns),
+                                             last   = std::min(first+2*step, nRuns);
+                        if(middle < last)
+                            std::inplace_merge(begin+bounds[first], begin+bounds[middle], 
+                                               begin+bounds[last], compare);
+                    }
+                );
+            }
+        }
+    } // namespace detail_graph_algorithms
+
+    /// \brief get a vector of Edge descriptors, sorted in parallel
+    ///
+    /// Same as the function above, but the edges are sorted by a parallel merge sort.
+    /// The weights are copied next to the edge ids before sorting, so that the 
+    /// sort does not access the weight map. The sort is stable, i.e. edges with equal 
+    /// weights remain in the order of <tt>EdgeIt</tt>, and the result does not depend 
+    /// on the number of threads.
+    template<class GRAPH,class WEIGHTS,class COMPERATOR>
+    void edgeSort(
+        const GRAPH   & g,
+        const WEIGHTS & weights,
+        const COMPERATOR  & comperator,
+        std::vector<typename GRAPH::Edge> & sortedEdges,
+        ParallelOptions const & options
+    ){
+        typedef std::pair<typename WEIGHTS::Value, Int64> Key;
+
+        // only (weight, edge id) pairs are sorted, the edges are
+        // written once from their ids
+        std::vector<Key> keys(g.edgeNum());
+        size_t c=0;
+        for(typename GRAPH::EdgeIt e(g);e!=lemon::INVALID;++e){
+            keys[c]=Key(weights[*e], g.id(*e));
+            ++c;
+        }
+
+        detail_graph_algorithms::parallelStableSort(keys.begin(), keys.end(),
+            [&comperator](Key const & a, Key const & b)
+            {
+                return comperator(a.first, b.first);
+            },
+            options);
+
+        const std::ptrdiff_t chunkSize = 1 << 16,
+                             nChunks = (keys.size() + chunkSize - 1) / chunkSize;
+        sortedEdges.resize(keys.size());
+        parallel_foreach(options, nChunks,
+            [&](int, std::ptrdiff_t chunk)
+            {
+                const std::size_t end = std::min<std::size_t>((chunk+1)*chunkSize, keys.size());
+                for(std::size_t i=chunk*chunkSize; i<end; ++i)
+                    sortedEdges[i] = g.edgeFromId(keys[i].second);
+            }
+        );
+    }
+
 
     /// \brief copy a lemon node map
     template<class G,class A,class B>
@@ -207,7 +292,374 @@ namespace vigra{
         }
     }
 
+    namespace detail_graph_algorithms{
+
+        // grid edges of one block whose end points have different labels, 
+        // stable-sorted by the (smaller, larger) label pair
+        template<unsigned int N, class LABEL_TYPE>
+        struct RagBlockEdges
+        {
+            typedef TinyVector<LABEL_TYPE, 2>                     LabelPair;
+            typedef typename MultiArrayShape<N+1>::type           GridEdge;
+            typedef std::pair<LabelPair, GridEdge>                Item;
+
+            std::vector<Item>            items;
+            std::vector<LABEL_TYPE>      labels;     // sorted labels occurring in the block
+            std::vector<MultiArrayIndex> runStarts;  // first item of each label pair, plus end
+            std::vector<MultiArrayIndex> runEdges;   // RAG edge ID of each run
+        };
+
+        template<class ITEM>
+        struct RagLabelPairLess
+        {
+            bool operator()(ITEM const & a, ITEM const & b) const
+            {
+                return a.first[0] < b.first[0] || 
+                       (a.first[0] == b.first[0] && a.first[1] < b.first[1]);
+            }
+        };
+
+        template<class T>
+        struct RagPairLess
+        {
+            bool operator()(TinyVector<T, 2> const & a, TinyVector<T, 2> const & b) const
+            {
+                return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+            }
+        };
+
+        // access to a block of an array (e.g. labels including a one-pixel margin):
+        // a view is used directly, a chunked array is checked out into the buffer
+        template<unsigned int N, class T, class S>
+        MultiArrayView<N, T, StridedArrayTag>
+        checkoutBlock(MultiArrayView<N, T, S> const & labels, 
+                       typename MultiArrayShape<N>::type const & begin, 
+                       typename MultiArrayShape<N>::type const & end,
+                       MultiArray<N, T> &)
+        {
+            return labels.subarray(begin, end);
+        }
+
+        template<unsigned int N, class T>
+        MultiArrayView<N, T, StridedArrayTag>
+        checkoutBlock(ChunkedArray<N, T> const & labels, 
+                       typename MultiArrayShape<N>::type const & begin, 
+                       typename MultiArrayShape<N>::type const & end,
+                       MultiArray<N, T> & buffer)
+        {
+            buffer.reshape(end - begin);
+            labels.checkoutSubarray(begin, buffer);
+            return buffer;
+        }
+
+        // blocking for parallel processing: arrays are split into slabs along 
+        // the last axis (about four per thread for load balancing), chunked 
+        // arrays are processed chunk by chunk
+        template<unsigned int N, class T, class S>
+        typename MultiArrayShape<N>::type
+        defaultBlockShape(MultiArrayView<N, T, S> const & array, ParallelOptions const & options)
+        {
+            const MultiArrayIndex slabCount = 4*std::max(options.getActualNumThreads(), 1);
+            typename MultiArrayShape<N>::type blockShape(array.shape());
+            blockShape[N-1] = std::max<MultiArrayIndex>(1, (blockShape[N-1] + slabCount - 1) / slabCount);
+            return blockShape;
+        }
+
+        template<unsigned int N, class T>
+        typename MultiArrayShape<N>::type
+        defaultBlockShape(ChunkedArray<N, T> const & array, ParallelOptions const &)
+        {
+            return array.chunkShape();
+        }
+
+        // collect the label pairs of all grid edges starting in one block
+        template<unsigned int N, class LABELS, class LABEL_TYPE>
+        struct RagBlockEdgesFunctor
+        {
+            typedef GridGraph<N, boost_graph::undirected_tag> Graph;
+            typedef typename MultiArrayShape<N>::type         Shape;
+            typedef RagBlockEdges<N, LABEL_TYPE>              BlockEdges;
+            typedef typename BlockEdges::Item                 Item;
+            typedef typename BlockEdges::LabelPair            LabelPair;
+
+            RagBlockEdgesFunctor(Graph const & graph, LABELS const & labels, 
+                                 Shape const & blockShape, Int64 ignoreLabel,
+                                 std::vector<BlockEdges> & blocks)
+            : graph_(&graph), labels_(&labels), blockShape_(blockShape), 
+              ignoreLabel_(ignoreLabel), blocks_(&blocks)
+            {}
+
+            void operator()(int /* thread */, MultiArrayIndex blockIndex) const
+            {
+                Graph const & g = *graph_;
+                Shape blockCoord;
+                detail::ScanOrderToCoordinate<N>::exec(blockIndex, 
+                        (g.shape() + blockShape_ - Shape(1)) / blockShape_, blockCoord);
+                Shape begin = blockCoord*blockShape_,
+                      end   = min(begin + blockShape_, g.shape()),
+                      marginBegin = max(begin - Shape(1), Shape()),
+                      marginEnd   = min(end + Shape(1), g.shape());
+
+                MultiArray<N, LABEL_TYPE> buffer;
+                MultiArrayView<N, LABEL_TYPE, StridedArrayTag> labels = 
+                    checkoutBlock(*labels_, marginBegin, marginEnd, buffer);
+
+                BlockEdges & block = (*blocks_)[blockIndex];
+                const bool ignore = ignoreLabel_ != -1;
+                MultiCoordinateIterator<N> p(end - begin), pend(p.getEndIterator());
+                for(; p != pend; ++p)
+                {
+                    const Shape node = *p + begin;
+                    const LABEL_TYPE lu = labels[node - marginBegin];
+                    if(block.labels.size() == 0 || block.labels.back() != lu)
+                        block.labels.push_back(lu);
+                    if(ignore && static_cast<Int64>(lu) == ignoreLabel_)
+                        continue;
+                    for(typename Graph::OutBackArcIt a(g, node); a != lemon::INVALID; ++a)
+                    {
+                        const LABEL_TYPE lv = labels[g.target(*a) - marginBegin];
+                        if(lu == lv || (ignore && static_cast<Int64>(lv) == ignoreLabel_))
+                            continue;
+                        block.items.push_back(Item(lu < lv ? LabelPair(lu, lv) 
+                                                           : LabelPair(lv, lu), 
+                                                   typename Graph::Edge(*a)));
+                    }
+                }
+
+                std::stable_sort(block.items.begin(), block.items.end(), RagLabelPairLess<Item>());
+                for(std::size_t k=0; k<block.items.size(); ++k)
+                    if(k == 0 || block.items[k].first != block.items[k-1].first)
+                        block.runStarts.push_back(k);
+                block.runStarts.push_back(block.items.size());
+
+                std::sort(block.labels.begin(), block.labels.end());
+                block.labels.erase(std::unique(block.labels.begin(), block.labels.end()), 
+                                   block.labels.end());
+            }
+
+            Graph const * graph_;
+            LABELS const * labels_;
+            Shape blockShape_;
+            Int64 ignoreLabel_;
+            std::vector<BlockEdges> * blocks_;
+        };
+
+        // find the RAG edge of each run of a block
+        template<unsigned int N, class LABEL_TYPE>
+        struct RagRunEdgesFunctor
+        {
+            typedef RagBlockEdges<N, LABEL_TYPE>   BlockEdges;
+            typedef typename BlockEdges::LabelPair LabelPair;
+
+            RagRunEdgesFunctor(std::vector<LabelPair> const & ragEdges, 
+                               std::vector<BlockEdges> & blocks)
+            : ragEdges_(&ragEdges), blocks_(&blocks)
+            {}
+
+            void operator()(int /* thread */, MultiArrayIndex blockIndex) const
+            {
+                BlockEdges & block = (*blocks_)[blockIndex];
+                const std::size_t runCount = block.runStarts.size() - 1;
+                block.runEdges.resize(runCount);
+                for(std::size_t r=0; r<runCount; ++r)
+                {
+                    block.runEdges[r] = std::lower_bound(ragEdges_->begin(), ragEdges_->end(), 
+                                                         block.items[block.runStarts[r]].first, 
+                                                         RagPairLess<LABEL_TYPE>()) 
+                                        - ragEdges_->begin();
+                }
+            }
+
+            std::vector<LabelPair> const * ragEdges_;
+            std::vector<BlockEdges> * blocks_;
+        };
+
+        // fill the affiliated grid edges of one RAG edge from its runs
+        template<unsigned int N, class LABEL_TYPE, class AFFILIATED_EDGES>
+        struct RagAffiliatedEdgesFunctor
+        {
+            typedef RagBlockEdges<N, LABEL_TYPE>   BlockEdges;
+
+            RagAffiliatedEdgesFunctor(std::vector<BlockEdges> const & blocks,
+                                      std::vector<std::pair<MultiArrayIndex, MultiArrayIndex> > const & runs,
+                                      std::vector<MultiArrayIndex> const & edgeRuns,
+                                      AFFILIATED_EDGES & affiliatedEdges)
+            : blocks_(&blocks), runs_(&runs), edgeRuns_(&edgeRuns), 
+              affiliatedEdges_(&affiliatedEdges)
+            {}
+
+            void operator()(int /* thread */, MultiArrayIndex edgeId) const
+            {
+                typename AFFILIATED_EDGES::Reference edges = 
+                    (*affiliatedEdges_)[AdjacencyListGraph::Edge(edgeId)];
+                std::size_t size = 0;
+                for(MultiArrayIndex k=(*edgeRuns_)[edgeId]; k<(*edgeRuns_)[edgeId+1]; ++k)
+                {
+                    BlockEdges const & block = (*blocks_)[(*runs_)[k].first];
+                    const MultiArrayIndex r = (*runs_)[k].second;
+                    size += block.runStarts[r+1] - block.runStarts[r];
+                }
+                edges.reserve(size);
+                for(MultiArrayIndex k=(*edgeRuns_)[edgeId]; k<(*edgeRuns_)[edgeId+1]; ++k)
+                {
+                    BlockEdges const & block = (*blocks_)[(*runs_)[k].first];
+                    const MultiArrayIndex r = (*runs_)[k].second;
+                    for(MultiArrayIndex i=block.runStarts[r]; i<block.runStarts[r+1]; ++i)
+                        edges.push_back(block.items[i].second);
+                }
+            }
+
+            std::vector<BlockEdges> const * blocks_;
+            std::vector<std::pair<MultiArrayIndex, MultiArrayIndex> > const * runs_;
+            std::vector<MultiArrayIndex> const * edgeRuns_;
+            AFFILIATED_EDGES * affiliatedEdges_;
+        };
+
+        template<unsigned int N, class LABELS, class LABEL_TYPE>
+        void makeRegionAdjacencyGraphParallel(
+            GridGraph<N, boost_graph::undirected_tag> const & graphIn,
+            LABELS const & labels,
+            typename MultiArrayShape<N>::type const & blockShape,
+            AdjacencyListGraph & rag,
+            typename AdjacencyListGraph:: template EdgeMap< std::vector<typename GridGraph<N, boost_graph::undirected_tag>::Edge> > & affiliatedEdges,
+            const Int64 ignoreLabel,
+            ParallelOptions const & options)
+        {
+            typedef typename MultiArrayShape<N>::type   Shape;
+            typedef RagBlockEdges<N, LABEL_TYPE>         BlockEdges;
+            typedef typename BlockEdges::LabelPair       LabelPair;
+            typedef typename AdjacencyListGraph:: template EdgeMap< 
+                std::vector<typename GridGraph<N, boost_graph::undirected_tag>::Edge> > AffiliatedEdges;
+
+            vigra_precondition(labels.shape() == graphIn.shape(),
+                "makeRegionAdjacencyGraph(): shape mismatch between graph and labels.");
+
+            // collect label pairs and labels of all blocks in parallel
+            const Shape blockCount = (graphIn.shape() + blockShape - Shape(1)) / blockShape;
+            std::vector<BlockEdges> blocks(prod(blockCount));
+            parallel_foreach(options, blocks.size(),
+                RagBlockEdgesFunctor<N, LABELS, LABEL_TYPE>(graphIn, labels, blockShape, 
+                                                              ignoreLabel, blocks));
+
+            // merge them into the sorted lists of RAG nodes and edges
+            std::vector<LABEL_TYPE> ragNodes;
+            std::vector<LabelPair>  ragEdges;
+            for(std::size_t b=0; b<blocks.size(); ++b)
+            {
+                ragNodes.insert(ragNodes.end(), blocks[b].labels.begin(), blocks[b].labels.end());
+                for(std::size_t r=0; r+1<blocks[b].runStarts.size(); ++r)
+                    ragEdges.push_back(blocks[b].items[blocks[b].runStarts[r]].first);
+                std::vector<LABEL_TYPE>().swap(blocks[b].labels);
+            }
+            std::sort(ragNodes.begin(), ragNodes.end());
+            ragNodes.erase(std::unique(ragNodes.begin(), ragNodes.end()), ragNodes.end());
+            std::sort(ragEdges.begin(), ragEdges.end(), RagPairLess<LABEL_TYPE>());
+            ragEdges.erase(std::unique(ragEdges.begin(), ragEdges.end()), ragEdges.end());
+
+            // build the graph in bulk: since edges are inserted in sorted order,
+            // the adjacency sets of the nodes are only appended to
+            rag = AdjacencyListGraph(ragNodes.size(), ragEdges.size());
+            for(std::size_t k=0; k<ragNodes.size(); ++k)
+                if(ignoreLabel == -1 || static_cast<Int64>(ragNodes[k]) != ignoreLabel)
+                    rag.addNode(ragNodes[k]);
+            for(std::size_t k=0; k<ragEdges.size(); ++k)
+                rag.addEdge(rag.nodeFromId(ragEdges[k][0]), rag.nodeFromId(ragEdges[k][1]));
+
+            // group the runs of all blocks by RAG edge (in block order)
+            parallel_foreach(options, blocks.size(),
+                RagRunEdgesFunctor<N, LABEL_TYPE>(ragEdges, blocks));
+            std::vector<MultiArrayIndex> edgeRuns(ragEdges.size()+1, 0);
+            for(std::size_t b=0; b<blocks.size(); ++b)
+                for(std::size_t r=0; r<blocks[b].runEdges.size(); ++r)
+                    ++edgeRuns[blocks[b].runEdges[r]+1];
+            for(std::size_t k=0; k<ragEdges.size(); ++k)
+                edgeRuns[k+1] += edgeRuns[k];
+            std::vector<std::pair<MultiArrayIndex, MultiArrayIndex> > runs(edgeRuns.back());
+            {
+                std::vector<MultiArrayIndex> next(edgeRuns.begin(), edgeRuns.end()-1);
+                for(std::size_t b=0; b<blocks.size(); ++b)
+                    for(std::size_t r=0; r<blocks[b].runEdges.size(); ++r)
+                        runs[next[blocks[b].runEdges[r]]++] = std::make_pair(b, r);
+            }
+
+            affiliatedEdges.assign(rag);
+            parallel_foreach(options, ragEdges.size(),
+                RagAffiliatedEdgesFunctor<N, LABEL_TYPE, AffiliatedEdges>(blocks, runs, edgeRuns, 
+                                                                          affiliatedEdges));
+        }
+
+    } // namespace detail_graph_algorithms
+
+    /// \brief make a region adjacency graph from a label array on a \ref GridGraph in parallel
+    ///
+    /// \param graphIn  : undirected grid graph (its neighborhood determines the RAG edges)
+    /// \param labels   : labels w.r.t. graphIn, i.e. an array of shape <tt>graphIn.shape()</tt>
+    /// \param[out] rag  : region adjacency graph 
+    /// \param[out] affiliatedEdges : a vector of edges of graphIn for each edge in rag
+    /// \param      ignoreLabel : label to ignore (-1 means no label will be ignored)
+    /// \param      options : number of threads
+    ///
+    /// This overload is only selected when \a options are passed explicitly. 
+    /// The array is processed in slabs along the last dimension. Each thread collects the 
+    /// label pairs of the grid edges in its slab, and the RAG is then built in bulk 
+    /// from the sorted and deduplicated pairs. Unlike the serial version above, the RAG 
+    /// edges are numbered in lexicographic order of their (smaller, larger) label pair, 
+    /// and <tt>rag.u(e)</tt> is the smaller label. The affiliated edges of each RAG edge 
+    /// are in scan order, i.e. in the order of <tt>GridGraph::EdgeIt</tt>.
+    ///
+    template<unsigned int N, class T, class S>
+    void makeRegionAdjacencyGraph(
+        GridGraph<N, boost_graph::undirected_tag> const & graphIn,
+        MultiArrayView<N, T, S> const & labels,
+        AdjacencyListGraph & rag,
+        typename AdjacencyListGraph:: template EdgeMap< std::vector<typename GridGraph<N, boost_graph::undirected_tag>::Edge> > & affiliatedEdges,
+        const Int64   ignoreLabel,
+        ParallelOptions const & options
+    ){
+        detail_graph_algorithms::makeRegionAdjacencyGraphParallel<N, MultiArrayView<N, T, S>, T>(
+            graphIn, labels, detail_graph_algorithms::defaultBlockShape(labels, options), 
+            rag, affiliatedEdges, ignoreLabel, options);
+    }
+
+    template<unsigned int N, class T, class A>
+    inline void makeRegionAdjacencyGraph(
+        GridGraph<N, boost_graph::undirected_tag> const & graphIn,
+        MultiArray<N, T, A> const & labels,
+        AdjacencyListGraph & rag,
+        typename AdjacencyListGraph:: template EdgeMap< std::vector<typename GridGraph<N, boost_graph::undirected_tag>::Edge> > & affiliatedEdges,
+        const Int64   ignoreLabel,
+        ParallelOptions const & options
+    ){
+        makeRegionAdjacencyGraph(graphIn, static_cast<MultiArrayView<N, T> const &>(labels), 
+                                 rag, affiliatedEdges, ignoreLabel, options);
+    }
+
+    /// \brief make a region adjacency graph from a chunked label array on a \ref GridGraph in parallel
+    ///
+    /// Same as above, but the labels are read chunk by chunk (with a margin of one 
+    /// pixel), so that the label volume need not fit into memory. The affiliated 
+    /// edges of each RAG edge are in scan order within each chunk, and the chunks 
+    /// are visited in scan order. Requires <tt>\#include \<vigra/multi_array_chunked.hxx\></tt>.
+    ///
+    template<unsigned int N, class T>
+    void makeRegionAdjacencyGraph(
+        GridGraph<N, boost_graph::undirected_tag> const & graphIn,
+        ChunkedArray<N, T> const & labels,
+        AdjacencyListGraph & rag,
+        typename AdjacencyListGraph:: template EdgeMap< std::vector<typename GridGraph<N, boost_graph::undirected_tag>::Edge> > & affiliatedEdges,
+        const Int64   ignoreLabel,
+        ParallelOptions const & options
+    ){
+        detail_graph_algorithms::makeRegionAdjacencyGraphParallel<N, ChunkedArray<N, T>, T>(
+            graphIn, labels, detail_graph_algorithms::defaultBlockShape(labels, options), 
+            rag, affiliatedEdges, ignoreLabel, options);
+    }
+
     /// \brief shortest path computer
+    ///
+    /// The object can be reused for many queries on the same graph. After the first 
+    /// <tt>run()</tt>, only the nodes visited by the previous search are reset, 
+    /// so that a query costs only what it visits, even on very large graphs.
     template<class GRAPH,class WEIGHT_TYPE>
     class ShortestPathDijkstra{
     public:
@@ -229,7 +681,9 @@ namespace vigra{
         :   graph_(g),
             pq_(g.maxNodeId()+1),
             predMap_(g),
-            distMap_(g)
+            distMap_(g),
+            cleanMaps_(false),
+            pqBackward_(0)
         {
         }
 
@@ -245,12 +699,19 @@ namespace vigra{
         /// or \a maxDistance is exceeded), it is set to <tt>lemon::INVALID</tt>. In contrast, if \a target
         /// was <tt>lemon::INVALID</tt> at the beginning, it will always be set to the last node 
         /// visited in the search.
+        ///
+        /// The first call initializes the predecessors of all nodes. Subsequent calls only 
+        /// reset the nodes visited in the previous search (as <tt>reRun()</tt> does), unless 
+        /// the previous search was restricted to a ROI.
         template<class WEIGHTS>
         void run(const WEIGHTS & weights, const Node & source,
                  const Node & target = lemon::INVALID, 
                  WeightType maxDistance=NumericTraits<WeightType>::max())
         {
-            this->initializeMaps(source);
+            if(cleanMaps_)
+                this->reInitializeMaps(source);
+            else
+                this->initializeMaps(source);
             runImpl(weights, target, maxDistance);
         }
 
@@ -311,6 +772,96 @@ namespace vigra{
             runImpl(weights, target, maxDistance);
         }
 
+        /// \brief find the shortest path between \a source and \a target by bidirectional search
+        ///
+        /// \param weights : edge weights encoding the distance between adjacent nodes (must be non-negative) 
+        /// \param source  : source node where shortest path should start
+        /// \param target  : target node where shortest path should stop (must be valid)
+        /// \param maxDistance  : path search is terminated when the path length exceeds <tt>maxDistance</tt>
+        ///
+        /// Two searches are grown from \a source and \a target simultaneously until they meet,
+        /// which typically visits far fewer nodes than <tt>run()</tt> with a target. 
+        /// The graph must be undirected. Afterwards, <tt>target()</tt> is \a target 
+        /// or <tt>lemon::INVALID</tt> if no path was found, and <tt>predecessors()</tt> and 
+        /// <tt>distances()</tt> are valid along the path from \a target back to \a source. 
+        /// <tt>discoveryOrder()</tt> contains the nodes reached by the forward search
+        /// (not sorted by distance), followed by the path nodes found by the backward search. The maps for the backward 
+        /// search are allocated at the first call.
+        template<class WEIGHTS>
+        void runBidirectional(const WEIGHTS & weights, const Node & source, const Node & target,
+                              WeightType maxDistance=NumericTraits<WeightType>::max())
+        {
+            vigra_precondition(target != lemon::INVALID,
+                "ShortestPathDijkstra::runBidirectional(): target must be valid.");
+            if(cleanMaps_)
+                this->reInitializeMaps(source);
+            else
+                this->initializeMaps(source);
+            if(predMapBackward_.size() == 0)
+            {
+                predMapBackward_ = PredecessorsMap(graph_);
+                distMapBackward_ = DistanceMap(graph_);
+                pqBackward_ = PqType(graph_.maxNodeId()+1);
+                for(NodeIt n(graph_); n!=lemon::INVALID; ++n)
+                    predMapBackward_[*n]=lemon::INVALID;
+            }
+            distMapBackward_[target]=static_cast<WeightType>(0.0);
+            predMapBackward_[target]=target;
+            pqBackward_.push(graph_.id(target),0.0);
+            discoveryOrderBackward_.clear();
+
+            // length of the best path found so far and the edge (u, v) where 
+            // it crosses from the forward to the backward search
+            WeightType bestDistance = NumericTraits<WeightType>::max();
+            Node bestU(lemon::INVALID), bestV(lemon::INVALID);
+            if(source == target)
+            {
+                bestDistance = static_cast<WeightType>(0.0);
+                bestU = bestV = source;
+            }
+            while(!pq_.empty() && !pqBackward_.empty())
+            {
+                const WeightType lowerBound = pq_.topPriority() + pqBackward_.topPriority();
+                if(lowerBound >= bestDistance || lowerBound > maxDistance)
+                    break;
+                if(pq_.topPriority() <= pqBackward_.topPriority())
+                    bidirectionalStep(weights, maxDistance, pq_, predMap_, distMap_, discoveryOrder_,
+                                      predMapBackward_, distMapBackward_, bestDistance, bestU, bestV);
+                else
+                    bidirectionalStep(weights, maxDistance, pqBackward_, predMapBackward_, distMapBackward_, 
+                                      discoveryOrderBackward_, predMap_, distMap_, bestDistance, bestV, bestU);
+            }
+
+            // nodes still in the queues keep their predecessors until the path is extracted
+            while(!pq_.empty()){
+                discoveryOrder_.push_back(graph_.nodeFromId(pq_.top()));
+                pq_.pop();
+            }
+            while(!pqBackward_.empty()){
+                discoveryOrderBackward_.push_back(graph_.nodeFromId(pqBackward_.top()));
+                pqBackward_.pop();
+            }
+
+            target_ = lemon::INVALID;
+            if(bestU != lemon::INVALID && bestDistance <= maxDistance)
+            {
+                // append the backward part of the path to the forward search tree
+                Node current = bestU, next = bestV;
+                while(current != target)
+                {
+                    if(predMap_[next] == lemon::INVALID)
+                        discoveryOrder_.push_back(next);
+                    predMap_[next] = current;
+                    distMap_[next] = bestDistance - distMapBackward_[next];
+                    current = next;
+                    next = predMapBackward_[current];
+                }
+                target_ = target;
+            }
+            for(unsigned int n=0; n<discoveryOrderBackward_.size(); ++n)
+                predMapBackward_[discoveryOrderBackward_[n]]=lemon::INVALID;
+        }
+
         /// \brief get the graph
         const Graph & graph()const{
             return graph_;
@@ -352,6 +903,47 @@ namespace vigra{
 
     private:
 
+        // settle the top node of 'pq' and relax its edges. If a neighbor has already 
+        // been reached by the other search, a path from the source to the target 
+        // has been found.
+        template<class WEIGHTS>
+        void bidirectionalStep(const WEIGHTS & weights, WeightType maxDistance,
+                               PqType & pq, PredecessorsMap & predMap, DistanceMap & distMap, 
+                               DiscoveryOrder & discoveryOrder,
+                               PredecessorsMap const & otherPredMap, DistanceMap const & otherDistMap,
+                               WeightType & bestDistance, Node & bestU, Node & bestV)
+        {
+            const Node topNode(graph_.nodeFromId(pq.top()));
+            pq.pop();
+            discoveryOrder.push_back(topNode);
+            for(OutArcIt outArcIt(graph_,topNode);outArcIt!=lemon::INVALID;++outArcIt){
+                const Node otherNode = graph_.target(*outArcIt);
+                const size_t otherNodeId = graph_.id(otherNode);
+                const WeightType alternativeDist = distMap[topNode]+weights[Edge(*outArcIt)];
+
+                if(pq.contains(otherNodeId)){
+                    if(alternativeDist<distMap[otherNode]){
+                        pq.push(otherNodeId,alternativeDist);
+                        distMap[otherNode]=alternativeDist;
+                        predMap[otherNode]=topNode;
+                    }
+                }
+                else if(predMap[otherNode]==lemon::INVALID && alternativeDist<=maxDistance){
+                    pq.push(otherNodeId,alternativeDist);
+                    distMap[otherNode]=alternativeDist;
+                    predMap[otherNode]=topNode;
+                }
+                if(otherPredMap[otherNode]!=lemon::INVALID){
+                    const WeightType pathDist = alternativeDist + otherDistMap[otherNode];
+                    if(pathDist < bestDistance){
+                        bestDistance = pathDist;
+                        bestU = topNode;
+                        bestV = otherNode;
+                    }
+                }
+            }
+        }
+
         template<class WEIGHTS>
         void runImpl(const WEIGHTS & weights,
                      const Node & target = lemon::INVALID, 
@@ -408,6 +1000,7 @@ namespace vigra{
                 const Node node(*n);
                 predMap_[node]=lemon::INVALID;
             }
+            cleanMaps_=true;
             distMap_[source]=static_cast<WeightType>(0.0);
             predMap_[source]=source;
             discoveryOrder_.clear();
@@ -426,6 +1019,8 @@ namespace vigra{
                                  left_border, right_border, DONT_TOUCH);
             predMap_.subarray(start, stop) = lemon::INVALID;
             predMap_[source]=source;
+            // the border markers stay in place (so that reRun() remains restricted to the ROI)
+            cleanMaps_=false;
             
             distMap_[source]=static_cast<WeightType>(0.0);
             discoveryOrder_.clear();
@@ -435,9 +1030,17 @@ namespace vigra{
 
         template <class ITER>
         void initializeMapsMultiSource(ITER source, ITER source_end){
-            for(NodeIt n(graph_); n!=lemon::INVALID; ++n){
-                const Node node(*n);
-                predMap_[node]=lemon::INVALID;
+            if(cleanMaps_){
+                for(unsigned int n=0; n<discoveryOrder_.size(); ++n){
+                    predMap_[discoveryOrder_[n]]=lemon::INVALID;
+                }
+            }
+            else{
+                for(NodeIt n(graph_); n!=lemon::INVALID; ++n){
+                    const Node node(*n);
+                    predMap_[node]=lemon::INVALID;
+                }
+                cleanMaps_=true;
             }
             discoveryOrder_.clear();
             for( ; source != source_end; ++source)
@@ -465,6 +1068,14 @@ namespace vigra{
         PredecessorsMap predMap_;
         DistanceMap     distMap_;
         DiscoveryOrder  discoveryOrder_;
+        // true if predMap_ is INVALID everywhere except at the nodes in discoveryOrder_
+        bool            cleanMaps_;
+
+        // maps of the backward search in runBidirectional()
+        PqType          pqBackward_;
+        PredecessorsMap predMapBackward_;
+        DistanceMap     distMapBackward_;
+        DiscoveryOrder  discoveryOrderBackward_;
 
         Node source_;
         Node target_;
@@ -571,6 +1182,257 @@ namespace vigra{
     }
     
 
+    namespace detail_graph_algorithms{
+
+        // relaxation request of the delta-stepping search in shortestPathVoronoi()
+        template<class INDEX, class DISTANCE, class LABEL>
+        struct VoronoiRequest
+        {
+            VoronoiRequest(INDEX node, DISTANCE distance, LABEL label)
+            : node_(node), distance_(distance), label_(label)
+            {}
+
+            INDEX    node_;
+            DISTANCE distance_;
+            LABEL    label_;
+        };
+
+        // a candidate (distance, label) is better if it is closer, or equally close 
+        // to a seed with smaller label
+        template<class DISTANCE, class LABEL>
+        inline bool voronoiImproves(DISTANCE d, LABEL l, DISTANCE oldD, LABEL oldL)
+        {
+            return d < oldD || (d == oldD && l < oldL);
+        }
+
+        template<class GRAPH, class SEEDS, class DISTANCES, class LABELS>
+        void initShortestPathVoronoi(const GRAPH & g, const SEEDS & seeds,
+                                     DISTANCES & distances, LABELS & labels)
+        {
+            typedef typename DISTANCES::Value DistanceType;
+            typedef typename LABELS::Value    LabelType;
+            for(typename GRAPH::NodeIt n(g); n!=lemon::INVALID; ++n){
+                const typename GRAPH::Node node(*n);
+                labels[node] = static_cast<LabelType>(seeds[node]);
+                distances[node] = labels[node] != static_cast<LabelType>(0)
+                                      ? static_cast<DistanceType>(0)
+                                      : NumericTraits<DistanceType>::max();
+            }
+        }
+    } // namespace detail_graph_algorithms
+
+    /// \brief geodesic distance to the nearest seed and the corresponding Voronoi labeling
+    ///
+    /// \param g : input graph
+    /// \param weights : edge weights encoding the distance between adjacent nodes (must be non-negative)
+    /// \param seeds : node map of seed labels (0 means: node is not a seed)
+    /// \param[out] distances : length of the shortest path from each node to its nearest seed
+    /// \param[out] labels : label of the nearest seed
+    ///
+    /// All seeds are propagated by a single Dijkstra search, so the cost is that of one 
+    /// shortest path search regardless of the number of seeds. When several seeds are at
+    /// the same distance, the smaller label wins, i.e. the result does not depend on the 
+    /// traversal order. Nodes that cannot be reached from any seed get label 0 and distance 
+    /// <tt>NumericTraits<DistanceType>::max()</tt>.
+    template<class GRAPH, class WEIGHTS, class SEEDS, class DISTANCES, class LABELS>
+    void shortestPathVoronoi(
+        const GRAPH     & g,
+        const WEIGHTS   & weights,
+        const SEEDS     & seeds,
+        DISTANCES       & distances,
+        LABELS          & labels
+    ){
+        typedef GRAPH Graph;
+        typedef typename Graph::Node Node;
+        typedef typename Graph::Edge Edge;
+        typedef typename Graph::NodeIt NodeIt;
+        typedef typename Graph::OutArcIt OutArcIt;
+        typedef typename DISTANCES::Value DistanceType;
+        typedef typename LABELS::Value    LabelType;
+
+        detail_graph_algorithms::initShortestPathVoronoi(g, seeds, distances, labels);
+
+        ChangeablePriorityQueue<DistanceType> pq(g.maxNodeId()+1);
+        for(NodeIt n(g); n!=lemon::INVALID; ++n){
+            const Node node(*n);
+            if(labels[node] != static_cast<LabelType>(0))
+                pq.push(g.id(node), static_cast<DistanceType>(0));
+        }
+
+        // Nodes that have already been popped keep their distance, but may still
+        // receive a smaller label at the same distance (via edges of weight zero).
+        // They are then pushed again, so that the new label is propagated as well.
+        while(!pq.empty()){
+            const Node node = g.nodeFromId(pq.top());
+            pq.pop();
+
+            const DistanceType dist  = distances[node];
+            const LabelType    label = labels[node];
+            for(OutArcIt a(g, node); a!=lemon::INVALID; ++a){
+                const Node other = g.target(*a);
+                const DistanceType otherDist = dist + weights[Edge(*a)];
+                if(detail_graph_algorithms::voronoiImproves(otherDist, label, distances[other], labels[other])){
+                    distances[other] = otherDist;
+                    labels[other]    = label;
+                    pq.push(g.id(other), otherDist);
+                }
+            }
+        }
+    }
+
+    /// \brief geodesic distance and Voronoi labeling by parallel delta-stepping
+    ///
+    /// \param g : input graph
+    /// \param weights : edge weights encoding the distance between adjacent nodes (must be non-negative)
+    /// \param seeds : node map of seed labels (0 means: node is not a seed)
+    /// \param[out] distances : length of the shortest path from each node to its nearest seed
+    /// \param[out] labels : label of the nearest seed
+    /// \param options : number of threads (<tt>ParallelOptions::NoThreads</tt> runs the 
+    ///                  sequential Dijkstra version)
+    /// \param delta : bucket width (default: 0 means the mean edge weight)
+    ///
+    /// Nodes are put into buckets of width \a delta according to their tentative 
+    /// distance. The buckets are processed in increasing order, and the out-arcs of all
+    /// nodes in the current bucket are relaxed in parallel. Small \a delta approaches 
+    /// Dijkstra's algorithm, large \a delta approaches Bellman-Ford. The results are 
+    /// identical to the sequential version, including the tie-breaking rule. Since
+    /// a relaxation can only reach up to <tt>maxWeight / delta</tt> buckets ahead, the
+    /// buckets are stored in a cyclic array of that size (at most 1024, nodes that are
+    /// even further away are deferred to the last bucket of the array).
+    template<class GRAPH, class WEIGHTS, class SEEDS, class DISTANCES, class LABELS>
+    void shortestPathVoronoi(
+        const GRAPH     & g,
+        const WEIGHTS   & weights,
+        const SEEDS     & seeds,
+        DISTANCES       & distances,
+        LABELS          & labels,
+        ParallelOptions const & options,
+        typename DISTANCES::Value delta = 0
+    ){
+        typedef GRAPH Graph;
+        typedef typename Graph::Node Node;
+        typedef typename Graph::Edge Edge;
+        typedef typename Graph::EdgeIt EdgeIt;
+        typedef typename Graph::NodeIt NodeIt;
+        typedef typename Graph::OutArcIt OutArcIt;
+        typedef typename Graph::index_type IndexType;
+        typedef typename DISTANCES::Value DistanceType;
+        typedef typename LABELS::Value    LabelType;
+        typedef detail_graph_algorithms::VoronoiRequest<IndexType, DistanceType, LabelType> Request;
+
+        if(options.getNumThreads() == 0){
+            shortestPathVoronoi(g, weights, seeds, distances, labels);
+            return;
+        }
+
+        vigra_precondition(delta >= static_cast<DistanceType>(0),
+            "shortestPathVoronoi(): delta must be non-negative.");
+        double sum = 0.0, maxWeight = 0.0;
+        for(EdgeIt e(g); e!=lemon::INVALID; ++e){
+            sum += weights[*e];
+            maxWeight = std::max<double>(maxWeight, weights[*e]);
+        }
+        if(delta == static_cast<DistanceType>(0)){
+            if(g.edgeNum() > 0 && sum > 0.0)
+                delta = static_cast<DistanceType>(sum / g.edgeNum());
+            else
+                delta = static_cast<DistanceType>(1);
+        }
+
+        detail_graph_algorithms::initShortestPathVoronoi(g, seeds, distances, labels);
+
+        // cyclic bucket array: bucket b is stored in slot b % bucketCount
+        const std::size_t bucketCount =
+            static_cast<std::size_t>(std::min<double>(maxWeight / delta, 1022.0)) + 2;
+        std::vector<std::vector<IndexType> > buckets(bucketCount);
+        for(NodeIt n(g); n!=lemon::INVALID; ++n){
+            const Node node(*n);
+            if(labels[node] != static_cast<LabelType>(0))
+                buckets[0].push_back(g.id(node));
+        }
+
+        // round in which a node was last expanded (avoids expanding duplicates twice per round)
+        typename Graph:: template NodeMap<Int64> expanded(g);
+        fillNodeMap(g, expanded, Int64(-1));
+
+        const int nThreads = options.getActualNumThreads();
+        std::vector<std::vector<Request> > requests(nThreads);
+        std::vector<IndexType> frontier;
+        Int64 round = 0;
+
+        // the search is finished when all slots of the cyclic array are empty
+        std::size_t emptyBuckets = 0;
+        for(std::size_t b=0; emptyBuckets < bucketCount; ++b){
+            std::vector<IndexType> & bucket = buckets[b % bucketCount];
+            if(bucket.empty()){
+                ++emptyBuckets;
+                continue;
+            }
+            emptyBuckets = 0;
+            while(!bucket.empty()){
+                // collect the nodes of the current bucket (entries are stale when the 
+                // node has moved to a lower bucket in the meantime, and deferred when
+                // the node belongs to a bucket beyond the end of the cyclic array)
+                frontier.clear();
+                for(std::size_t k=0; k<bucket.size(); ++k){
+                    const Node node = g.nodeFromId(bucket[k]);
+                    const std::size_t nodeBucket = static_cast<std::size_t>(distances[node] / delta);
+                    if(expanded[node] == round || nodeBucket < b)
+                        continue;
+                    if(nodeBucket > b){
+                        buckets[std::min(nodeBucket, b + bucketCount - 1) % bucketCount].push_back(bucket[k]);
+                        continue;
+                    }
+                    expanded[node] = round;
+                    frontier.push_back(bucket[k]);
+                }
+                bucket.clear();
+                ++round;
+
+                // relax all out-arcs of the frontier in parallel (reading the maps only)
+                const std::ptrdiff_t chunkSize = 1024;
+                const std::ptrdiff_t nChunks = std::min<std::ptrdiff_t>(nThreads, 
+                                                   (frontier.size() + chunkSize - 1) / chunkSize);
+                parallel_foreach(options, nChunks,
+                    [&](int threadId, std::ptrdiff_t chunk)
+                    {
+                        const std::size_t begin = chunk * frontier.size() / nChunks,
+                                          end   = (chunk+1) * frontier.size() / nChunks;
+                        std::vector<Request> & req = requests[threadId];
+                        for(std::size_t k=begin; k<end; ++k){
+                            const Node node = g.nodeFromId(frontier[k]);
+                            const DistanceType dist  = distances[node];
+                            const LabelType    label = labels[node];
+                            for(OutArcIt a(g, node); a!=lemon::INVALID; ++a){
+                                const Node other = g.target(*a);
+                                const DistanceType otherDist = dist + weights[Edge(*a)];
+                                if(detail_graph_algorithms::voronoiImproves(otherDist, label, 
+                                                                            distances[other], labels[other]))
+                                    req.push_back(Request(g.id(other), otherDist, label));
+                            }
+                        }
+                    }
+                );
+
+                // apply the requests sequentially
+                for(int t=0; t<nThreads; ++t){
+                    for(std::size_t k=0; k<requests[t].size(); ++k){
+                        const Request & r = requests[t][k];
+                        const Node node = g.nodeFromId(r.node_);
+                        if(!detail_graph_algorithms::voronoiImproves(r.distance_, r.label_, 
+                                                                     distances[node], labels[node]))
+                            continue;
+                        distances[node] = r.distance_;
+                        labels[node]    = r.label_;
+                        const std::size_t target = static_cast<std::size_t>(r.distance_ / delta);
+                        buckets[std::min(target, b + bucketCount - 1) % bucketCount].push_back(r.node_);
+                    }
+                    requests[t].clear();
+                }
+            }
+        }
+    }
+
     namespace detail_watersheds_segmentation{
 
     struct RawPriorityFunctor{
@@ -745,22 +1607,18 @@ namespace vigra{
     }
 
 
-    /// \brief edge weighted watersheds Segmentataion
-    /// 
-    /// \param graph: input graph
-    /// \param edgeWeights : edge weights / edge indicator
-    /// \param nodeSizes : size of each node
-    /// \param k : free parameter of felzenszwalb algorithm
-    /// \param[out] nodeLabeling :  nodeLabeling (not necessarily dense)
-    /// \param nodeNumStopCond      : optional stopping condition
+    namespace detail_graph_algorithms{
+
+    // Kruskal-style sweep of felzenszwalbSegmentation() over the sorted edges
     template< class GRAPH , class EDGE_WEIGHTS, class NODE_SIZE,class NODE_LABEL_MAP>
-    void felzenszwalbSegmentation(
+    void felzenszwalbSegmentationImpl(
         const GRAPH &         graph,
         const EDGE_WEIGHTS &  edgeWeights,
         const NODE_SIZE    &  nodeSizes,
         float           k,
         NODE_LABEL_MAP     &  nodeLabeling,
-        const int             nodeNumStopCond = -1
+        const int             nodeNumStopCond,
+        std::vector<typename GRAPH::Edge> const & sortedEdges
     ){
         typedef GRAPH Graph;
         typedef typename Graph::Edge Edge;
@@ -779,13 +1637,6 @@ namespace vigra{
 
 
 
-        // initlaize internal node diff map
-
-        // sort the edges by their weights
-        std::vector<Edge> sortedEdges;
-        std::less<WeightType> comperator;
-        edgeSort(graph,edgeWeights,comperator,sortedEdges);
-
         // make the ufd
         UnionFindArray<UInt64> ufdArray(graph.maxNodeId()+1);
 
@@ -842,8 +1693,64 @@ namespace vigra{
             const Node node(*n);
             nodeLabeling[node]=ufdArray.findLabel(graph.id(node));
         }
+    }
+
+    } // namespace detail_graph_algorithms
+
+    /// \brief edge weighted watersheds Segmentataion
+    /// 
+    /// \param graph: input graph
+    /// \param edgeWeights : edge weights / edge indicator
+    /// \param nodeSizes : size of each node
+    /// \param k : free parameter of felzenszwalb algorithm
+    /// \param[out] nodeLabeling :  nodeLabeling (not necessarily dense)
+    /// \param nodeNumStopCond      : optional stopping condition
+    template< class GRAPH , class EDGE_WEIGHTS, class NODE_SIZE,class NODE_LABEL_MAP>
+    void felzenszwalbSegmentation(
+        const GRAPH &         graph,
+        const EDGE_WEIGHTS &  edgeWeights,
+        const NODE_SIZE    &  nodeSizes,
+        float           k,
+        NODE_LABEL_MAP     &  nodeLabeling,
+        const int             nodeNumStopCond = -1
+    ){
+        typedef typename EDGE_WEIGHTS::Value WeightType;
+
+        // sort the edges by their weights
+        std::vector<typename GRAPH::Edge> sortedEdges;
+        std::less<WeightType> comperator;
+        edgeSort(graph,edgeWeights,comperator,sortedEdges);
+
+        detail_graph_algorithms::felzenszwalbSegmentationImpl(graph,edgeWeights,nodeSizes,k,nodeLabeling,
+                                                              nodeNumStopCond,sortedEdges);
     } 
 
+    /// \brief felzenszwalb segmentation with parallel edge sorting
+    /// 
+    /// Identical to the function above, except that the edges are sorted by the 
+    /// parallel version of <tt>edgeSort()</tt>. Since that sort is stable, the result 
+    /// does not depend on the number of threads (but may differ from the sequential 
+    /// version for edges of equal weight).
+    template< class GRAPH , class EDGE_WEIGHTS, class NODE_SIZE,class NODE_LABEL_MAP>
+    void felzenszwalbSegmentation(
+        const GRAPH &         graph,
+        const EDGE_WEIGHTS &  edgeWeights,
+        const NODE_SIZE    &  nodeSizes,
+        float           k,
+        NODE_LABEL_MAP     &  nodeLabeling,
+        const int             nodeNumStopCond,
+        ParallelOptions const & options
+    ){
+        typedef typename EDGE_WEIGHTS::Value WeightType;
+
+        std::vector<typename GRAPH::Edge> sortedEdges;
+        std::less<WeightType> comperator;
+        edgeSort(graph,edgeWeights,comperator,sortedEdges,options);
+
+        detail_graph_algorithms::felzenszwalbSegmentationImpl(graph,edgeWeights,nodeSizes,k,nodeLabeling,
+                                                              nodeNumStopCond,sortedEdges);
+    }
+
 
 
 
@@ -1156,6 +2063,174 @@ namespace vigra{
         }
     }
 
+    namespace detail_graph_algorithms{
+        // default functor of implicitEdgeWeightsFromNodeWeights()
+        struct EndpointMean
+        {
+            template<class T>
+            typename NumericTraits<T>::RealPromote operator()(T const & a, T const & b) const
+            {
+                return 0.5*(typename NumericTraits<T>::RealPromote(a) + b);
+            }
+        };
+    } // namespace detail_graph_algorithms
+
+    /// \brief implicit edge map computing edge weights from node weights on access
+    ///
+    /// This is the lazy counterpart of <tt>edgeWeightsFromNodeWeights()</tt>: instead of 
+    /// storing <tt>maxDegree()/2</tt> values per node, the weight of an edge is computed 
+    /// from the weights of its end nodes whenever it is read. The map can be passed as 
+    /// edge weights to <tt>ShortestPathDijkstra</tt>, <tt>edgeWeightedWatershedsSegmentation()</tt>,
+    /// <tt>felzenszwalbSegmentation()</tt> and other algorithms that only read edge weights.
+    /// The map keeps references to the graph and the node weights, which must 
+    /// outlive it. Use the factory function <tt>implicitEdgeWeightsFromNodeWeights()</tt> 
+    /// to create it.
+    template<unsigned int N, class DirectedTag, class NODEMAP, class FUNCTOR>
+    class ImplicitEdgeWeightsFromNodeWeights
+    {
+      public:
+        typedef GridGraph<N, DirectedTag>  Graph;
+        typedef typename Graph::Edge       Key;
+        typedef typename NumericTraits<typename NODEMAP::value_type>::RealPromote Value;
+        typedef Value                      ConstReference;
+
+        typedef Key             key_type;
+        typedef Value           value_type;
+        typedef ConstReference  const_reference;
+
+        typedef boost_graph::readable_property_map_tag category;
+
+        ImplicitEdgeWeightsFromNodeWeights(const Graph & g, const NODEMAP & nodeWeights,
+                                           bool euclidean, FUNCTOR const & func)
+        :   graph_(g),
+            nodeWeights_(nodeWeights),
+            func_(func),
+            lengths_(euclidean ? g.maxDegree() : 0)
+        {
+            vigra_precondition(nodeWeights.shape() == g.shape(), 
+                 "ImplicitEdgeWeightsFromNodeWeights(): shape mismatch between graph and nodeWeights.");
+            for(unsigned int k=0; k<lengths_.size(); ++k)
+                lengths_[k] = norm(g.neighborOffset(k));
+        }
+
+        ConstReference operator[](const Key & edge) const
+        {
+            const Value w = static_cast<Value>(func_(nodeWeights_[graph_.u(edge)], 
+                                                     nodeWeights_[graph_.v(edge)]));
+            return lengths_.size() == 0
+                       ? w
+                       : static_cast<Value>(lengths_[edge[N]] * w);
+        }
+
+      private:
+        const Graph & graph_;
+        const NODEMAP & nodeWeights_;
+        FUNCTOR func_;
+        ArrayVector<double> lengths_;
+    };
+
+    /// \brief implicit edge map reading edge weights from an interpolated image on access
+    ///
+    /// This is the lazy counterpart of <tt>edgeWeightsFromInterpolatedImage()</tt>: the 
+    /// weight of the edge between <tt>u</tt> and <tt>v</tt> is <tt>interpolatedImage[u+v]</tt>,
+    /// i.e. the value at the edge's midpoint, and is looked up whenever it is read. 
+    /// Otherwise, it behaves like \ref ImplicitEdgeWeightsFromNodeWeights. Use the factory 
+    /// function <tt>implicitEdgeWeightsFromInterpolatedImage()</tt> to create it.
+    template<unsigned int N, class DirectedTag, class T, class S>
+    class ImplicitEdgeWeightsFromInterpolatedImage
+    {
+      public:
+        typedef GridGraph<N, DirectedTag>  Graph;
+        typedef typename Graph::Edge       Key;
+        typedef typename NumericTraits<T>::RealPromote Value;
+        typedef Value                      ConstReference;
+
+        typedef Key             key_type;
+        typedef Value           value_type;
+        typedef ConstReference  const_reference;
+
+        typedef boost_graph::readable_property_map_tag category;
+
+        ImplicitEdgeWeightsFromInterpolatedImage(const Graph & g, 
+                                                 MultiArrayView<N, T, S> const & interpolatedImage,
+                                                 bool euclidean)
+        :   graph_(g),
+            interpolatedImage_(interpolatedImage),
+            lengths_(euclidean ? g.maxDegree() : 0)
+        {
+            vigra_precondition(interpolatedImage.shape() == 2*g.shape()-typename MultiArrayShape<N>::type(1), 
+                 "ImplicitEdgeWeightsFromInterpolatedImage(): interpolated shape must be shape*2-1");
+            for(unsigned int k=0; k<lengths_.size(); ++k)
+                lengths_[k] = norm(g.neighborOffset(k));
+        }
+
+        ConstReference operator[](const Key & edge) const
+        {
+            const Value w = static_cast<Value>(interpolatedImage_[graph_.u(edge) + graph_.v(edge)]);
+            return lengths_.size() == 0
+                       ? w
+                       : static_cast<Value>(lengths_[edge[N]] * w);
+        }
+
+      private:
+        const Graph & graph_;
+        MultiArrayView<N, T, S> interpolatedImage_;
+        ArrayVector<double> lengths_;
+    };
+
+    /// \brief create an implicit edge map from node weights
+    ///
+    /// \param g : input graph
+    /// \param nodeWeights : node property map holding node weights
+    /// \param euclidean : if 'true', multiply the computed weights with the Euclidean
+    ///                    distance between the edge's end nodes (default: 'false')
+    /// \param func : binary function that computes the edge weight from the 
+    ///               weights of the edge's end nodes (default: take the average)
+    ///
+    /// See \ref ImplicitEdgeWeightsFromNodeWeights.
+    template<unsigned int N, class DirectedTag,
+             class NODEMAP, class FUNCTOR>
+    inline ImplicitEdgeWeightsFromNodeWeights<N, DirectedTag, NODEMAP, FUNCTOR>
+    implicitEdgeWeightsFromNodeWeights(
+            const GridGraph<N, DirectedTag> & g,
+            const NODEMAP  & nodeWeights,
+            bool euclidean,
+            FUNCTOR const & func)
+    {
+        return ImplicitEdgeWeightsFromNodeWeights<N, DirectedTag, NODEMAP, FUNCTOR>(g, nodeWeights, euclidean, func);
+    }
+
+    template<unsigned int N, class DirectedTag,
+             class NODEMAP>
+    inline ImplicitEdgeWeightsFromNodeWeights<N, DirectedTag, NODEMAP, detail_graph_algorithms::EndpointMean>
+    implicitEdgeWeightsFromNodeWeights(
+            const GridGraph<N, DirectedTag> & g,
+            const NODEMAP  & nodeWeights,
+            bool euclidean=false)
+    {
+        return implicitEdgeWeightsFromNodeWeights(g, nodeWeights, euclidean, detail_graph_algorithms::EndpointMean());
+    }
+
+    /// \brief create an implicit edge map from an interpolated image
+    ///
+    /// \param g : input graph
+    /// \param interpolatedImage : interpolated image of shape <tt>2*g.shape()-1</tt>
+    /// \param euclidean : if 'true', multiply the weights with the Euclidean
+    ///                    distance between the edge's end nodes (default: 'false')
+    ///
+    /// See \ref ImplicitEdgeWeightsFromInterpolatedImage.
+    template<unsigned int N, class DirectedTag,
+             class T, class S>
+    inline ImplicitEdgeWeightsFromInterpolatedImage<N, DirectedTag, T, S>
+    implicitEdgeWeightsFromInterpolatedImage(
+            const GridGraph<N, DirectedTag> & g,
+            MultiArrayView<N, T, S> const & interpolatedImage,
+            bool euclidean = false)
+    {
+        return ImplicitEdgeWeightsFromInterpolatedImage<N, DirectedTag, T, S>(g, interpolatedImage, euclidean);
+    }
+
+
 //@}
 
 } // namespace vigra
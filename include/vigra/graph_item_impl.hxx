@@ -197,22 +197,24 @@ namespace vigra{
 
             // default constructor
             GenericIncEdgeIt(const lemon::Invalid & invalid = lemon::INVALID)
-            :   nodeImpl_(NULL),
-                graph_(NULL),
+            :   graph_(NULL),
                 ownNodeId_(-1),
+                adjBegin_(),
                 adjIter_(),
+                adjEnd_(),
                 resultItem_(lemon::INVALID){
             }   
             // from a given node iterator
             GenericIncEdgeIt(const Graph & g , const NodeIt & nodeIt)
-            :   nodeImpl_(&g.nodeImpl(*nodeIt)),
-                graph_(&g),
+            :   graph_(&g),
                 ownNodeId_(g.id(*nodeIt)),
-                adjIter_(g.nodeImpl(*nodeIt).adjacencyBegin()),
+                adjBegin_(g.adjacencyBegin(*nodeIt)),
+                adjIter_(adjBegin_),
+                adjEnd_(g.adjacencyEnd(*nodeIt)),
                 resultItem_(lemon::INVALID){
 
                 if(FILTER::IsFilter){
-                    while(adjIter_!=nodeImpl_->adjacencyEnd() && !FILTER::valid(*graph_,*adjIter_,ownNodeId_) ) {
+                    while(adjIter_!=adjEnd_ && !FILTER::valid(*graph_,*adjIter_,ownNodeId_) ) {
                         ++adjIter_;
                     }
                 }
@@ -220,14 +222,15 @@ namespace vigra{
 
             // from a given node
             GenericIncEdgeIt(const Graph & g , const Node & node)
-            :   nodeImpl_(&g.nodeImpl(node)),
-                graph_(&g),
+            :   graph_(&g),
                 ownNodeId_(g.id(node)),
-                adjIter_(g.nodeImpl(node).adjacencyBegin()),
+                adjBegin_(g.adjacencyBegin(node)),
+                adjIter_(adjBegin_),
+                adjEnd_(g.adjacencyEnd(node)),
                 resultItem_(lemon::INVALID){
 
                 if(FILTER::IsFilter){
-                    while(adjIter_!=nodeImpl_->adjacencyEnd() && !FILTER::valid(*graph_,*adjIter_,ownNodeId_) ) {
+                    while(adjIter_!=adjEnd_ && !FILTER::valid(*graph_,*adjIter_,ownNodeId_) ) {
                         ++adjIter_;
                     }
                 }
@@ -240,10 +243,10 @@ namespace vigra{
             typedef typename NodeImpl::AdjIt AdjIt;
 
             bool isEnd()const{
-                return  (nodeImpl_==NULL  || adjIter_==nodeImpl_->adjacencyEnd());      
+                return  (graph_==NULL  || adjIter_==adjEnd_);      
             }
             bool isBegin()const{
-                return (nodeImpl_!=NULL &&  adjIter_==nodeImpl_->adjacencyBegin());
+                return (graph_!=NULL &&  adjIter_==adjBegin_);
             }
             bool equal(const GenericIncEdgeIt<GRAPH,NODE_IMPL,FILTER> & other)const{
                 if(isEnd() && other.isEnd()){
@@ -260,7 +263,7 @@ namespace vigra{
             void increment(){
                 ++adjIter_;
                 if(FILTER::IsFilter){
-                    while(adjIter_!=nodeImpl_->adjacencyEnd() && !FILTER::valid(*graph_,*adjIter_,ownNodeId_)){
+                    while(adjIter_!=adjEnd_ && !FILTER::valid(*graph_,*adjIter_,ownNodeId_)){
                         ++adjIter_;
                     }
                 }
@@ -274,10 +277,13 @@ namespace vigra{
             }
 
 
-            const NODE_IMPL * nodeImpl_;
+            // the adjacency range is obtained from the graph, so that
+            // it may either live in the node or in a compact (CSR) array
             const GRAPH     * graph_;
             const index_type  ownNodeId_;
+            AdjIt adjBegin_;
             AdjIt adjIter_;
+            AdjIt adjEnd_;
             mutable ResultItem resultItem_;
         };
 
@@ -369,6 +375,14 @@ namespace vigra{
                     adjacency_.insert(AdjacencyElement(nodeId,edgeId));
                 }
 
+                // replace the adjacency by a range which is already sorted by node id
+                template<class ITER>
+                void assignSorted(ITER begin, ITER end){
+                    adjacency_.clear();
+                    for(; begin!=end; ++begin)
+                        adjacency_.insert(adjacency_.end(), *begin);
+                }
+
                 AdjIt adjacencyBegin()const{
                     return adjacency_.begin();
                 }
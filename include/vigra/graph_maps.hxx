@@ -121,7 +121,7 @@ public:
 
     }
     DenseGraphItemReferenceMap(const Graph & g,typename DenseReferenceMapType::ConstReference value)
-    :   DenseReferenceMapType(ItemHelper::itemNum(g)==0 ? 0: ItemHelper::maxItemId(g)){
+    :   DenseReferenceMapType(ItemHelper::itemNum(g)==0 ? 0: ItemHelper::maxItemId(g),value){
 
     }
     void assign(const Graph & g){
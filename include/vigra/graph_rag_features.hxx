@@ -0,0 +1,539 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2015 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_GRAPH_RAG_FEATURES_HXX
+#define VIGRA_GRAPH_RAG_FEATURES_HXX
+
+#include <vector>
+
+#include "blockwise_features.hxx"
+#include "graph_algorithms.hxx"
+#include "multi_gridgraph.hxx"
+#include "adjacency_list_graph.hxx"
+#include "threadpool.hxx"
+
+namespace vigra {
+
+namespace acc {
+
+namespace rag_features_detail {
+
+using detail_graph_algorithms::checkoutBlock;
+
+    // Collects (value, RAG node ID) for all pixels of a block.
+template <unsigned int N, class LABELS, class DATA>
+struct RagNodeSamples
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    AdjacencyListGraph const & rag_;
+    LABELS const & labels_;
+    DATA const & data_;
+
+    RagNodeSamples(GridGraph<N, boost_graph::undirected_tag> const &,
+                   AdjacencyListGraph const & rag, LABELS const & labels, DATA const & data)
+    : rag_(rag), labels_(labels), data_(data)
+    {}
+
+    template <class V, class L>
+    void operator()(Shape const & begin, Shape const & end,
+                    std::vector<V> & values, std::vector<L> & ids) const
+    {
+        typedef typename LABELS::value_type LabelType;
+        typedef typename DATA::value_type   DataType;
+        MultiArray<N, LabelType> labelBuffer;
+        MultiArray<N, DataType>  dataBuffer;
+        MultiArrayView<N, LabelType, StridedArrayTag> labels = checkoutBlock(labels_, begin, end, labelBuffer);
+        MultiArrayView<N, DataType, StridedArrayTag>  data   = checkoutBlock(data_, begin, end, dataBuffer);
+
+        typedef typename CoupledIteratorType<N, DataType, LabelType>::type Iterator;
+        Iterator i = createCoupledIterator(data, labels), iend = i.getEndIterator();
+        for(; i < iend; ++i)
+        {
+            const LabelType l = i.template get<2>();
+            if(rag_.nodeFromId(l) == lemon::INVALID)
+                continue;
+            values.push_back(static_cast<V>(i.template get<1>()));
+            ids.push_back(static_cast<L>(l));
+        }
+    }
+};
+
+    // Collects (value, RAG edge ID) for all grid edges starting in a block 
+    // whose end points belong to different regions. If the data are an edge
+    // map of the grid graph, the edge values are used directly, otherwise 
+    // (node data) the value of a grid edge is the average of its end points.
+template <unsigned int N, class LABELS, class DATA>
+struct RagEdgeSamples
+{
+    typedef GridGraph<N, boost_graph::undirected_tag> Graph;
+    typedef typename MultiArrayShape<N>::type         Shape;
+    typedef typename MultiArrayShape<N+1>::type       EdgeShape;
+
+    Graph const & graph_;
+    AdjacencyListGraph const & rag_;
+    LABELS const & labels_;
+    DATA const & data_;
+
+    RagEdgeSamples(Graph const & graph, AdjacencyListGraph const & rag, 
+                   LABELS const & labels, DATA const & data)
+    : graph_(graph), rag_(rag), labels_(labels), data_(data)
+    {}
+
+    template <class V, class L>
+    void operator()(Shape const & begin, Shape const & end,
+                    std::vector<V> & values, std::vector<L> & ids) const
+    {
+        typedef typename LABELS::value_type LabelType;
+        typedef typename DATA::value_type   DataType;
+        static const bool edgeData = (DATA::actual_dimension == N+1);
+
+        Shape marginBegin = max(begin - Shape(1), Shape()),
+              marginEnd   = min(end + Shape(1), graph_.shape());
+        MultiArray<N, LabelType> labelBuffer;
+        MultiArrayView<N, LabelType, StridedArrayTag> labels = 
+            checkoutBlock(labels_, marginBegin, marginEnd, labelBuffer);
+
+        // node data with margin, or the edges stored at the nodes of the block
+        typedef typename MultiArrayShape<DATA::actual_dimension>::type DataShape;
+        DataShape dataBegin, dataEnd;
+        for(unsigned int k=0; k<N; ++k)
+        {
+            dataBegin[k] = edgeData ? begin[k] : marginBegin[k];
+            dataEnd[k]   = edgeData ? end[k]   : marginEnd[k];
+        }
+        if(edgeData)
+            dataEnd[DATA::actual_dimension-1] = data_.shape(DATA::actual_dimension-1);
+        MultiArray<DATA::actual_dimension, DataType> dataBuffer;
+        MultiArrayView<DATA::actual_dimension, DataType, StridedArrayTag> data = 
+            checkoutBlock(data_, dataBegin, dataEnd, dataBuffer);
+
+        MultiCoordinateIterator<N> p(end - begin), pend(p.getEndIterator());
+        for(; p != pend; ++p)
+        {
+            const Shape node = *p + begin;
+            const LabelType lu = labels[node - marginBegin];
+            const AdjacencyListGraph::Node ragU = rag_.nodeFromId(lu);
+            if(ragU == lemon::INVALID)
+                continue;
+            for(typename Graph::OutBackArcIt a(graph_, node); a != lemon::INVALID; ++a)
+            {
+                const Shape target = graph_.target(*a);
+                const LabelType lv = labels[target - marginBegin];
+                if(lu == lv)
+                    continue;
+                const AdjacencyListGraph::Edge ragEdge = rag_.findEdge(ragU, rag_.nodeFromId(lv));
+                if(ragEdge == lemon::INVALID)
+                    continue;
+                values.push_back(static_cast<V>(edgeValue(data, node, target, (*a)[N], 
+                                                          marginBegin, begin, 
+                                                          MetaInt<DATA::actual_dimension - N>())));
+                ids.push_back(static_cast<L>(rag_.id(ragEdge)));
+            }
+        }
+    }
+
+    template <class ARRAY>
+    static typename NumericTraits<typename ARRAY::value_type>::RealPromote 
+    edgeValue(ARRAY const & data, Shape const & u, Shape const & v, MultiArrayIndex, 
+              Shape const & marginBegin, Shape const &, MetaInt<0>)
+    {
+        typedef typename NumericTraits<typename ARRAY::value_type>::RealPromote RealType;
+        return (RealType(data[u - marginBegin]) + RealType(data[v - marginBegin])) / 2.0;
+    }
+
+    template <class ARRAY>
+    static typename ARRAY::value_type
+    edgeValue(ARRAY const & data, Shape const & u, Shape const &, MultiArrayIndex edgeIndex, 
+              Shape const &, Shape const & begin, MetaInt<1>)
+    {
+        EdgeShape e;
+        e.template subarray<0, N>() = u - begin;
+        e[N] = edgeIndex;
+        return data[e];
+    }
+};
+
+    // Perform all passes of the accumulator chain 'a' on the given blocks.
+template <unsigned int N, class SAMPLES, class ACCUMULATOR>
+void 
+extractRagFeaturesInBlocks(SAMPLES const & samples,
+                           typename MultiArrayShape<N>::type const & shape,
+                           typename MultiArrayShape<N>::type const & blockShape,
+                           ArrayVector<typename MultiArrayShape<N>::type> const & blocks,
+                           ACCUMULATOR & a)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename UnqualifiedType<typename ACCUMULATOR::argument_type>::type Handle;
+    typedef typename CoupledHandleCast<1, Handle>::value_type V;
+    typedef typename CoupledHandleCast<2, Handle>::value_type L;
+
+    std::vector<V> values;
+    std::vector<L> ids;
+    for(unsigned int pass=1; pass <= a.passesRequired(); ++pass)
+    {
+        for(unsigned int k=0; k<blocks.size(); ++k)
+        {
+            Shape begin = blocks[k] * blockShape,
+                  end   = min(begin + blockShape, shape);
+            values.clear();
+            ids.clear();
+            samples(begin, end, values, ids);
+            if(values.size() == 0)
+                continue;
+            blockwise_features_detail::extractFeaturesPass(
+                MultiArrayView<1, V>(Shape1(values.size()), &values[0]),
+                MultiArrayView<1, L>(Shape1(ids.size()), &ids[0]),
+                a, pass);
+        }
+    }
+}
+
+template <unsigned int N, class SAMPLES, class ACCUMULATOR>
+struct RagFeaturesFunctor
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    SAMPLES const & samples_;
+    Shape shape_, blockShape_;
+    ArrayVector<ArrayVector<Shape> > const & blocks_;
+    ACCUMULATOR & first_;
+    ArrayVector<ACCUMULATOR> & others_;
+
+    RagFeaturesFunctor(SAMPLES const & samples, Shape const & shape, Shape const & blockShape,
+                       ArrayVector<ArrayVector<Shape> > const & blocks,
+                       ACCUMULATOR & first, ArrayVector<ACCUMULATOR> & others)
+    : samples_(samples), shape_(shape), blockShape_(blockShape), 
+      blocks_(blocks), first_(first), others_(others)
+    {}
+
+    void operator()(int, MultiArrayIndex k)
+    {
+        extractRagFeaturesInBlocks<N>(samples_, shape_, blockShape_, blocks_[k], 
+                                      k == 0 ? first_ : others_[k-1]);
+    }
+};
+
+template <unsigned int N, class SAMPLES, class ACCUMULATOR>
+void 
+extractRagFeatures(SAMPLES const & samples,
+                   typename MultiArrayShape<N>::type const & shape,
+                   typename MultiArrayShape<N>::type const & blockShape,
+                   MultiArrayIndex maxLabel,
+                   ACCUMULATOR & a,
+                   ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    if(!a.sparseLabels() && a.maxRegionLabel() < 0)
+        a.setMaxRegionLabel(maxLabel);
+
+    Shape blockArrayShape = (shape + blockShape - Shape(1)) / blockShape;
+    MultiArrayIndex blockCount = prod(blockArrayShape);
+    // later passes depend on the complete results of the previous pass
+    int threadCount = a.passesRequired() > 1
+                          ? 1
+                          : (int)std::min<MultiArrayIndex>(options.getActualNumThreads(), blockCount);
+
+    // distribute the blocks in round-robin fashion
+    ArrayVector<ArrayVector<Shape> > blocks(std::max(threadCount, 1));
+    MultiCoordinateIterator<N> c(blockArrayShape), cend(c.getEndIterator());
+    for(MultiArrayIndex k=0; c != cend; ++c, ++k)
+        blocks[k % blocks.size()].push_back(*c);
+
+    if(threadCount <= 1)
+    {
+        extractRagFeaturesInBlocks<N>(samples, shape, blockShape, blocks[0], a);
+        return;
+    }
+
+    // 'a' itself serves as the accumulator of the first thread
+    ArrayVector<ACCUMULATOR> accumulators(threadCount-1, a);
+    parallel_foreach(options, threadCount, 
+                     RagFeaturesFunctor<N, SAMPLES, ACCUMULATOR>(samples, shape, blockShape, 
+                                                                  blocks, a, accumulators));
+    for(int k=0; k<threadCount-1; ++k)
+        a.merge(accumulators[k]);
+}
+
+template <unsigned int N>
+bool 
+isNodeOrEdgeMapShape(GridGraph<N, boost_graph::undirected_tag> const & graph,
+                     typename MultiArrayShape<N>::type const & shape)
+{
+    return shape == graph.shape();
+}
+
+template <unsigned int N>
+bool 
+isNodeOrEdgeMapShape(GridGraph<N, boost_graph::undirected_tag> const & graph,
+                     typename MultiArrayShape<N+1>::type const & shape)
+{
+    return shape == graph.edge_propmap_shape();
+}
+
+template <bool PREDICATE>
+struct extractRagEdgeFeatures_data_must_be_a_node_map_or_an_edge_map
+: vigra::staticAssert::AssertBool<PREDICATE>
+{};
+
+} // namespace rag_features_detail
+
+/** \brief Compute statistics of the boundaries between regions of a label array.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra { namespace acc {
+        // in-memory arrays
+        template <unsigned int N, class L, class S1, unsigned int M, class T, class S2, class ACCUMULATOR>
+        void 
+        extractRagEdgeFeatures(GridGraph<N, undirected_tag> const & graph,
+                               AdjacencyListGraph const & rag,
+                               MultiArrayView<N, L, S1> const & labels,
+                               MultiArrayView<M, T, S2> const & data,
+                               ACCUMULATOR & a,
+                               ParallelOptions const & options = ParallelOptions());
+
+        // chunked arrays
+        template <unsigned int N, class L, unsigned int M, class T, class ACCUMULATOR>
+        void 
+        extractRagEdgeFeatures(GridGraph<N, undirected_tag> const & graph,
+                               AdjacencyListGraph const & rag,
+                               ChunkedArray<N, L> const & labels,
+                               ChunkedArray<M, T> const & data,
+                               ACCUMULATOR & a,
+                               ParallelOptions const & options = ParallelOptions());
+    }}
+    \endcode
+
+    The region adjacency graph \a rag must have been created from \a labels and \a graph
+    by \ref makeRegionAdjacencyGraph(). For every grid edge that connects two regions, 
+    a sample is passed to the statistics of the corresponding RAG edge, where the region
+    label of the accumulator is the RAG edge ID. The \a data can either be an edge map
+    of \a graph (i.e. <tt>M == N+1</tt> and <tt>data.shape() == graph.edge_propmap_shape()</tt>), 
+    in which case the sample is the value of the grid edge, or a node map (<tt>M == N</tt>), 
+    in which case the sample is the average of the values at the two end points. 
+    Regions which are not nodes of the RAG (e.g. an ignored label) are skipped.
+    Each call processes a single \a data array. Several features can be computed 
+    in one pass (reading the labels only once) by combining them into the channels 
+    of a multiband array with <tt>TinyVector</tt> values; the statistics are then 
+    computed per channel.
+
+    The accumulator must be an
+    \ref AccumulatorChainArray "AccumulatorChainArray<CoupledArrays<1, V, I>, Select<DataArg<1>, LabelArg<2>, ...> >",
+    where \a V is the sample type and \a I an integer type that can hold the RAG edge IDs. 
+    The samples are computed on the fly block by block, so that the grid edges 
+    affiliated with each RAG edge never have to be stored. Arrays are split into 
+    slabs along the last axis, chunked arrays are processed chunk by chunk. Coordinate-based 
+    statistics are not meaningful here, since the samples are passed as a 1-dimensional
+    sequence. Multi-threading and multi-pass statistics work as in the
+    \ref extractFeatures() "ChunkedArray version of extractFeatures()": each thread
+    processes its blocks with its own copy of \a a, and the copies are finally 
+    merged, so that all selected statistics must support merging when 
+    more than one thread is used. Chains requiring several passes (e.g. quantiles
+    via <tt>StandardQuantiles<AutoRangeHistogram<...> ></tt>) are computed by a 
+    single thread.
+
+    If the accumulator's region count has not been set, it is set to <tt>rag.maxEdgeId()</tt>.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/graph_rag_features.hxx\><br>
+    Namespace: vigra::acc
+
+    \code
+    MultiArray<3, UInt32> labels(shape);
+    MultiArray<3, float>  boundaryProbability(shape);
+    ... // compute labels, e.g. by a watershed transform
+
+    GridGraph<3> graph(shape, DirectNeighborhood);
+    AdjacencyListGraph rag;
+    AdjacencyListGraph::EdgeMap<std::vector<GridGraph<3>::Edge> > affiliatedEdges;
+    makeRegionAdjacencyGraph(graph, labels, rag, affiliatedEdges, -1, ParallelOptions());
+
+    AccumulatorChainArray<CoupledArrays<1, float, UInt32>,
+                          Select<DataArg<1>, LabelArg<2>, Count, Mean, Minimum, Maximum> > a;
+    extractRagEdgeFeatures(graph, rag, labels, boundaryProbability, a);
+
+    for(AdjacencyListGraph::EdgeIt e(rag); e != lemon::INVALID; ++e)
+        std::cout << "mean boundary probability of edge " << rag.id(*e) << ": " 
+                  << get<Mean>(a, rag.id(*e)) << std::endl;
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void extractRagEdgeFeatures)
+
+template <unsigned int N, class L, class S1, unsigned int M, class T, class S2, class ACCUMULATOR>
+void 
+extractRagEdgeFeatures(GridGraph<N, boost_graph::undirected_tag> const & graph,
+                       AdjacencyListGraph const & rag,
+                       MultiArrayView<N, L, S1> const & labels,
+                       MultiArrayView<M, T, S2> const & data,
+                       ACCUMULATOR & a,
+                       ParallelOptions const & options = ParallelOptions())
+{
+    using namespace rag_features_detail;
+    typedef MultiArrayView<N, L, S1> Labels;
+    typedef MultiArrayView<M, T, S2> Data;
+
+    VIGRA_STATIC_ASSERT((rag_features_detail::extractRagEdgeFeatures_data_must_be_a_node_map_or_an_edge_map<M == N || M == N+1>));
+    vigra_precondition(labels.shape() == graph.shape(),
+        "extractRagEdgeFeatures(): shape mismatch between graph and labels.");
+    vigra_precondition(isNodeOrEdgeMapShape(graph, data.shape()),
+        "extractRagEdgeFeatures(): data must be a node map or an edge map of the graph.");
+    vigra_precondition(rag.edgeNum() > 0,
+        "extractRagEdgeFeatures(): region adjacency graph has no edges.");
+
+    extractRagFeatures<N>(RagEdgeSamples<N, Labels, Data>(graph, rag, labels, data),
+                          graph.shape(), detail_graph_algorithms::defaultBlockShape(labels, options),
+                          rag.maxEdgeId(), a, options);
+}
+
+template <unsigned int N, class L, unsigned int M, class T, class ACCUMULATOR>
+void 
+extractRagEdgeFeatures(GridGraph<N, boost_graph::undirected_tag> const & graph,
+                       AdjacencyListGraph const & rag,
+                       ChunkedArray<N, L> const & labels,
+                       ChunkedArray<M, T> const & data,
+                       ACCUMULATOR & a,
+                       ParallelOptions const & options = ParallelOptions())
+{
+    using namespace rag_features_detail;
+    typedef ChunkedArray<N, L> Labels;
+    typedef ChunkedArray<M, T> Data;
+
+    VIGRA_STATIC_ASSERT((rag_features_detail::extractRagEdgeFeatures_data_must_be_a_node_map_or_an_edge_map<M == N || M == N+1>));
+    vigra_precondition(labels.shape() == graph.shape(),
+        "extractRagEdgeFeatures(): shape mismatch between graph and labels.");
+    vigra_precondition(isNodeOrEdgeMapShape(graph, data.shape()),
+        "extractRagEdgeFeatures(): data must be a node map or an edge map of the graph.");
+    vigra_precondition(rag.edgeNum() > 0,
+        "extractRagEdgeFeatures(): region adjacency graph has no edges.");
+
+    extractRagFeatures<N>(RagEdgeSamples<N, Labels, Data>(graph, rag, labels, data),
+                          graph.shape(), detail_graph_algorithms::defaultBlockShape(labels, options),
+                          rag.maxEdgeId(), a, options);
+}
+
+/** \brief Compute statistics of the regions of a label array in parallel.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra { namespace acc {
+        // in-memory arrays
+        template <unsigned int N, class L, class S1, class T, class S2, class ACCUMULATOR>
+        void 
+        extractRagNodeFeatures(AdjacencyListGraph const & rag,
+                               MultiArrayView<N, L, S1> const & labels,
+                               MultiArrayView<N, T, S2> const & data,
+                               ACCUMULATOR & a,
+                               ParallelOptions const & options = ParallelOptions());
+
+        // chunked arrays
+        template <unsigned int N, class L, class T, class ACCUMULATOR>
+        void 
+        extractRagNodeFeatures(AdjacencyListGraph const & rag,
+                               ChunkedArray<N, L> const & labels,
+                               ChunkedArray<N, T> const & data,
+                               ACCUMULATOR & a,
+                               ParallelOptions const & options = ParallelOptions());
+    }}
+    \endcode
+
+    Counterpart of \ref extractRagEdgeFeatures() for the nodes of the region adjacency 
+    graph: the value of every pixel is passed to the statistics of its region, 
+    where the region label of the accumulator is the RAG node ID (i.e. the label). 
+    Pixels whose label is not a node of \a rag (e.g. an ignored label) are skipped.
+    The accumulator must be an
+    \ref AccumulatorChainArray "AccumulatorChainArray<CoupledArrays<1, V, I>, Select<DataArg<1>, LabelArg<2>, ...> >".
+    If its region count has not been set, it is set to <tt>rag.maxNodeId()</tt>.
+
+    <b>\#include</b> \<vigra/graph_rag_features.hxx\><br>
+    Namespace: vigra::acc
+*/
+doxygen_overloaded_function(template <...> void extractRagNodeFeatures)
+
+template <unsigned int N, class L, class S1, class T, class S2, class ACCUMULATOR>
+void 
+extractRagNodeFeatures(AdjacencyListGraph const & rag,
+                       MultiArrayView<N, L, S1> const & labels,
+                       MultiArrayView<N, T, S2> const & data,
+                       ACCUMULATOR & a,
+                       ParallelOptions const & options = ParallelOptions())
+{
+    using namespace rag_features_detail;
+    typedef MultiArrayView<N, L, S1> Labels;
+    typedef MultiArrayView<N, T, S2> Data;
+
+    vigra_precondition(labels.shape() == data.shape(),
+        "extractRagNodeFeatures(): shape mismatch between labels and data.");
+    vigra_precondition(rag.nodeNum() > 0,
+        "extractRagNodeFeatures(): region adjacency graph has no nodes.");
+
+    GridGraph<N, boost_graph::undirected_tag> graph(labels.shape());
+    extractRagFeatures<N>(RagNodeSamples<N, Labels, Data>(graph, rag, labels, data),
+                          labels.shape(), detail_graph_algorithms::defaultBlockShape(labels, options),
+                          rag.maxNodeId(), a, options);
+}
+
+template <unsigned int N, class L, class T, class ACCUMULATOR>
+void 
+extractRagNodeFeatures(AdjacencyListGraph const & rag,
+                       ChunkedArray<N, L> const & labels,
+                       ChunkedArray<N, T> const & data,
+                       ACCUMULATOR & a,
+                       ParallelOptions const & options = ParallelOptions())
+{
+    using namespace rag_features_detail;
+    typedef ChunkedArray<N, L> Labels;
+    typedef ChunkedArray<N, T> Data;
+
+    vigra_precondition(labels.shape() == data.shape(),
+        "extractRagNodeFeatures(): shape mismatch between labels and data.");
+    vigra_precondition(rag.nodeNum() > 0,
+        "extractRagNodeFeatures(): region adjacency graph has no nodes.");
+
+    GridGraph<N, boost_graph::undirected_tag> graph(labels.shape());
+    extractRagFeatures<N>(RagNodeSamples<N, Labels, Data>(graph, rag, labels, data),
+                          labels.shape(), detail_graph_algorithms::defaultBlockShape(labels, options),
+                          rag.maxNodeId(), a, options);
+}
+
+} // namespace acc
+
+} // namespace vigra
+
+#endif // VIGRA_GRAPH_RAG_FEATURES_HXX
@@ -43,6 +43,10 @@
 /*std*/
 #include <queue>          
 #include <iomanip>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <memory>
 
 /*vigra*/
 #include "priority_queue.hxx"
@@ -52,7 +56,20 @@ namespace vigra{
 
 namespace cluster_operators{
 
-    /// \brief  get minimum edge weight from an edge indicator and difference of node features
+    /** \brief  get minimum edge weight from an edge indicator and difference of node features
+
+        Whenever two regions are merged, the weights of all edges incident to the
+        merged region change. By default, they are recomputed immediately. If
+        \a lazyWeightUpdates is true, the merged region only receives a new timestamp,
+        and an edge's weight is recomputed when it reaches the top of the priority queue
+        and is found to be older than one of its end points (stale-entry checking). 
+        This saves most weight computations when large regions with many neighbors 
+        are merged. The lazy mode gives the same merge order as the default
+        mode if merging never decreases the weights of the incident edges. 
+        Otherwise, an edge whose weight dropped is only considered when its old 
+        weight comes up, so that the result is an approximation. In lazy mode, 
+        \a minWeightEdgeMap holds the most recently computed weight of every edge.
+    */
     template<
         class MERGE_GRAPH,
         class EDGE_INDICATOR_MAP,
@@ -102,7 +119,8 @@ namespace cluster_operators{
             MIN_WEIGHT_MAP minWeightEdgeMap,
             const ValueType beta,
             const metrics::MetricType metricType,
-            const ValueType wardness=1.0
+            const ValueType wardness=1.0,
+            const bool lazyWeightUpdates=false
         )
         :   mergeGraph_(mergeGraph),
             edgeIndicatorMap_(edgeIndicatorMap),
@@ -113,7 +131,11 @@ namespace cluster_operators{
             pq_(mergeGraph.maxEdgeId()+1),
             beta_(beta),
             wardness_(wardness),
-            metric_(metricType)
+            metric_(metricType),
+            lazyWeightUpdates_(lazyWeightUpdates),
+            timestamp_(0),
+            nodeTimestamp_(mergeGraph.maxNodeId()+1, 0),
+            edgeTimestamp_(mergeGraph.maxEdgeId()+1, 0)
         {
             typedef typename MergeGraph::MergeNodeCallBackType MergeNodeCallBackType;
             typedef typename MergeGraph::MergeEdgeCallBackType MergeEdgeCallBackType;
@@ -182,6 +204,13 @@ namespace cluster_operators{
             const Node newNode = mergeGraph_.inactiveEdgesNode(edge);
             //std::cout<<"new node "<<mergeGraph_.id(newNode)<<"\n";
 
+            if(lazyWeightUpdates_){
+                // all incident edges are now stale and will be 
+                // updated when they reach the top of the pq
+                nodeTimestamp_[mergeGraph_.id(newNode)] = ++timestamp_;
+                return;
+            }
+
             size_t counter=0;
             // iterate over all edges of this node
             for (IncEdgeIt e(mergeGraph_,newNode);e!=lemon::INVALID;++e){
@@ -211,23 +240,13 @@ namespace cluster_operators{
 
         /// \brief get the edge which should be contracted next
         Edge contractionEdge(){
-            index_type minLabel = pq_.top();
-            while(mergeGraph_.hasEdgeId(minLabel)==false){
-                pq_.deleteItem(minLabel);
-                minLabel = pq_.top();
-            }
-            return Edge(minLabel);
+            return Edge(validTop());
         }
 
         /// \brief get the edge weight of the edge which should be contracted next
         WeightType contractionWeight(){
-            index_type minLabel = pq_.top();
-            while(mergeGraph_.hasEdgeId(minLabel)==false){
-                pq_.deleteItem(minLabel);
-                minLabel = pq_.top();
-            }
+            validTop();
             return pq_.topPriority();
-
         }
 
 
@@ -236,6 +255,34 @@ namespace cluster_operators{
             return mergeGraph_;
         }
     private:
+        // remove dead edges from the top of the pq and (in lazy mode)
+        // recompute stale weights until the top edge is up to date
+        index_type validTop(){
+            index_type minLabel = pq_.top();
+            for(;;){
+                if(mergeGraph_.hasEdgeId(minLabel)==false){
+                    pq_.deleteItem(minLabel);
+                }
+                else if(lazyWeightUpdates_ && isStale(minLabel)){
+                    const Edge edge(minLabel);
+                    const ValueType newWeight = getEdgeWeight(edge);
+                    pq_.push(minLabel,newWeight);
+                    minWeightEdgeMap_[EdgeHelper::itemToGraphItem(mergeGraph_,edge)]=newWeight;
+                    edgeTimestamp_[minLabel]=timestamp_;
+                }
+                else{
+                    return minLabel;
+                }
+                minLabel = pq_.top();
+            }
+        }
+
+        bool isStale(const index_type edgeId)const{
+            const Edge edge(edgeId);
+            return edgeTimestamp_[edgeId] < nodeTimestamp_[mergeGraph_.id(mergeGraph_.u(edge))] ||
+                   edgeTimestamp_[edgeId] < nodeTimestamp_[mergeGraph_.id(mergeGraph_.v(edge))];
+        }
+
         ValueType getEdgeWeight(const Edge & e){
             
             const Node u = mergeGraph_.u(e);
@@ -266,10 +313,164 @@ namespace cluster_operators{
         ValueType wardness_;
 
         metrics::Metric<float> metric_;
+
+        bool lazyWeightUpdates_;
+        size_t timestamp_;
+        std::vector<size_t> nodeTimestamp_;
+        std::vector<size_t> edgeTimestamp_;
     };
 } // end namespace cluster_operators
 
 
+    /** \brief  merge tree (dendrogram) of an agglomerative clustering
+
+        The tree is built once from the merge tree encoding of a \ref HierarchicalClustering
+        (or any sequence of items with members <tt>a_</tt>, <tt>b_</tt>, <tt>r_</tt>, <tt>w_</tt>
+        in merge order). Afterwards, the segmentation at any threshold or any number of merges
+        can be obtained in O(n) without rerunning the clustering. Tree node ids 
+        <tt>0 ... maxLeafId</tt> are the nodes of the base graph, the i-th merge creates the tree 
+        node <tt>maxLeafId+1+i</tt>.
+
+        The merge weights need not be monotonic (e.g. with the lazy weight update of
+        \ref cluster_operators::EdgeWeightNodeFeatures). Therefore, every merge is assigned a 
+        level, which is the maximum weight of all merges in its subtree. The levels 
+        form an ultrametric, and cutting at a threshold applies exactly the merges whose level 
+        does not exceed the threshold.
+    */
+    template<class INDEX_TYPE, class VALUE_TYPE>
+    class MergeTree{
+    public:
+        typedef INDEX_TYPE index_type;
+        typedef VALUE_TYPE value_type;
+
+        /// \brief construct from a merge tree encoding and the largest node id of the base graph
+        template<class MERGE_TREE_ENCODING>
+        MergeTree(const MERGE_TREE_ENCODING & encoding, const index_type maxLeafId)
+        :   maxLeafId_(maxLeafId),
+            parents_(maxLeafId+1+encoding.size(), -1),
+            levels_(encoding.size()),
+            reprLeafs_(maxLeafId+1+encoding.size())
+        {
+            for(index_type id=0; id<=maxLeafId_; ++id){
+                reprLeafs_[id]=id;
+            }
+            for(size_t m=0; m<encoding.size(); ++m){
+                const index_type r = encoding[m].r_;
+                const index_type a = encoding[m].a_;
+                const index_type b = encoding[m].b_;
+                vigra_precondition(r == maxLeafId_+1+static_cast<index_type>(m) && a < r && b < r,
+                    "MergeTree(): merge tree encoding is not in merge order.");
+                parents_[a]=r;
+                parents_[b]=r;
+                value_type level = encoding[m].w_;
+                if(a > maxLeafId_)
+                    level = std::max(level, levels_[a-maxLeafId_-1]);
+                if(b > maxLeafId_)
+                    level = std::max(level, levels_[b-maxLeafId_-1]);
+                levels_[m]=level;
+                reprLeafs_[r]=std::min(reprLeafs_[a], reprLeafs_[b]);
+            }
+        }
+
+        /// \brief largest node id of the base graph
+        index_type maxLeafId()const{
+            return maxLeafId_;
+        }
+
+        /// \brief number of merges
+        size_t mergeNum()const{
+            return levels_.size();
+        }
+
+        /// \brief parent of tree node \a id, or -1 if \a id is a root
+        index_type parent(const index_type id)const{
+            return parents_[id];
+        }
+
+        /// \brief level of the merge which created tree node \a id (\a id must be a merge)
+        value_type level(const index_type id)const{
+            return levels_[id-maxLeafId_-1];
+        }
+
+        /** \brief level at which tree node \a id is merged into its parent
+
+            Tree node \a id is a cluster of its own for all thresholds <tt>t</tt> with 
+            <tt>level(id) <= t < mergeLevel(id)</tt> (for base graph nodes, 
+            <tt>t < mergeLevel(id)</tt>). Roots return <tt>NumericTraits<value_type>::max()</tt>.
+        */
+        value_type mergeLevel(const index_type id)const{
+            const index_type parent = parents_[id];
+            return parent == -1 ? NumericTraits<value_type>::max() : level(parent);
+        }
+
+        /// \brief smallest base graph node id below tree node \a id
+        index_type reprLeafId(const index_type id)const{
+            return reprLeafs_[id];
+        }
+
+        /** \brief label the base graph nodes after applying all merges with level <= \a threshold
+
+            \a labels must be writable at <tt>0 ... maxLeafId()</tt>. The label of every node
+            is the smallest node id in its cluster.
+        */
+        template<class OUT_ITER>
+        void labelsAtThreshold(const value_type threshold, OUT_ITER labels)const{
+            labelsImpl(LevelCut(*this, threshold), labels);
+        }
+
+        /** \brief label the base graph nodes after applying the first \a mergeNum merges
+
+            This gives the same partition as a clustering stopped at 
+            <tt>nodeNum() - mergeNum</tt> nodes. \a labels must be writable at 
+            <tt>0 ... maxLeafId()</tt>. The label of every node is the smallest node id in its cluster.
+        */
+        template<class OUT_ITER>
+        void labelsAfterMerges(const size_t mergeNum, OUT_ITER labels)const{
+            labelsImpl(MergeNumCut(*this, mergeNum), labels);
+        }
+
+    private:
+        struct LevelCut{
+            LevelCut(const MergeTree & tree, const value_type threshold)
+            : tree_(tree), threshold_(threshold){
+            }
+            bool operator()(const index_type merge)const{
+                return tree_.level(merge) <= threshold_;
+            }
+            const MergeTree & tree_;
+            value_type threshold_;
+        };
+
+        struct MergeNumCut{
+            MergeNumCut(const MergeTree & tree, const size_t mergeNum)
+            : tree_(tree), mergeNum_(mergeNum){
+            }
+            bool operator()(const index_type merge)const{
+                return static_cast<size_t>(merge-tree_.maxLeafId()-1) < mergeNum_;
+            }
+            const MergeTree & tree_;
+            size_t mergeNum_;
+        };
+
+        // a merge is applied iff its parent is, so that the labels can be 
+        // propagated top-down (parents have larger ids than their children)
+        template<class IS_APPLIED, class OUT_ITER>
+        void labelsImpl(const IS_APPLIED & isApplied, OUT_ITER labels)const{
+            std::vector<index_type> reprs(parents_.size());
+            for(std::ptrdiff_t id=static_cast<std::ptrdiff_t>(parents_.size())-1; id>=0; --id){
+                const index_type parent = parents_[id];
+                reprs[id] = (parent != -1 && isApplied(parent)) ? reprs[parent] : reprLeafs_[id];
+            }
+            std::copy(reprs.begin(), reprs.begin()+maxLeafId_+1, labels);
+        }
+
+        index_type                      maxLeafId_;
+        std::vector<index_type>         parents_;
+        std::vector<value_type>         levels_;
+        std::vector<index_type>         reprLeafs_;
+    };
+
+
 
     /// \brief  do hierarchical clustering with a given cluster operator
     template< class CLUSTER_OPERATOR>
@@ -317,6 +518,7 @@ namespace cluster_operators{
         };
 
         typedef std::vector<MergeItem> MergeTreeEncoding;
+        typedef vigra::MergeTree<MergeGraphIndexType,ValueType> MergeTree;
 
         /// \brief construct HierarchicalClustering from clusterOperator and an optional parameter object
         HierarchicalClustering(
@@ -344,6 +546,7 @@ namespace cluster_operators{
 
         /// \brief start the clustering
         void cluster(){
+            mergeTree_.reset();
             if(param_.verbose_)
                 std::cout<<"\n"; 
             while(mergeGraph_.nodeNum()>param_.nodeNumStopCond_ && mergeGraph_.edgeNum()>0){
@@ -380,6 +583,20 @@ namespace cluster_operators{
             return mergeTreeEndcoding_;
         }
 
+        /// \brief get the merge tree for fast queries at other thresholds 
+        /// (requires <tt>Parameter::buildMergeTreeEncoding_</tt>)
+        ///
+        /// The tree is built on the first call and reused until <tt>cluster()</tt> 
+        /// is called again.
+        const MergeTree & mergeTree()const{
+            vigra_precondition(param_.buildMergeTreeEncoding_,
+                "HierarchicalClustering::mergeTree(): merge tree encoding was not built "
+                "(see Parameter::buildMergeTreeEncoding_).");
+            if(!mergeTree_)
+                mergeTree_.reset(new MergeTree(mergeTreeEndcoding_, graph_.maxNodeId()));
+            return *mergeTree_;
+        }
+
         /// \brief get the node id's which are the leafes of a treeNodeId
         template<class OUT_ITER>
         size_t leafNodeIds(const MergeGraphIndexType treeNodeId, OUT_ITER begin)const{
@@ -453,6 +670,8 @@ namespace cluster_operators{
         std::vector<MergeGraphIndexType> timeStampIndexToMergeIndex_;
         // data which can reconstruct the merge tree
         MergeTreeEncoding mergeTreeEndcoding_;
+        // merge tree built from the encoding on demand
+        mutable VIGRA_SHARED_PTR<MergeTree> mergeTree_;
 
 
     };
@@ -10,8 +10,12 @@
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
 
 #include "applywindowfunction.hxx"
+#include "multi_array.hxx"
+#include "multi_iterator.hxx"
+#include "threadpool.hxx"
 
 namespace vigra
 {
@@ -96,6 +100,9 @@ namespace vigra
     <b> Preconditions:</b>
 
     The image must be larger than the window size of the filter.
+
+    For large windows and arrays of arbitrary dimension, \ref medianFilterMultiArray()
+    is much faster.
 */
 
 doxygen_overloaded_function(template <...> void medianFilter)
@@ -188,6 +195,503 @@ inline void medianFilter(MultiArrayView<2, T1, S1> const & src,
 
 //@}
 
+/********************************************************/
+/*                                                      */
+/*              N-dimensional rank filters              */
+/*                                                      */
+/********************************************************/
+
+/** Choose the window of \ref rankFilterMultiArray() and \ref medianFilterMultiArray() */
+enum RankFilterWindow {
+    BoxWindow,   ///< all points within the given radius along each axis
+    DiscWindow   ///< disc/ellipsoid inscribed into the box
+};
+
+namespace detail {
+
+// Two-level histogram: a fine histogram plus a coarse one that counts
+// blocks of fine bins, so that the k-th entry is found by scanning
+// about 2*sqrt(binCount) bins.
+class RankFilterHistogram
+{
+    ArrayVector<MultiArrayIndex> fine_, coarse_;
+    int shift_;
+    MultiArrayIndex count_;
+
+  public:
+    RankFilterHistogram()
+    : shift_(0), count_(0)
+    {}
+
+        // must only be called when the histogram is empty
+    void reshape(MultiArrayIndex binCount)
+    {
+        int bits = 0;
+        while(((MultiArrayIndex)1 << bits) < binCount)
+            ++bits;
+        shift_ = (bits + 1) / 2;
+        fine_.resize(binCount, 0);
+        coarse_.resize(((binCount - 1) >> shift_) + 1, 0);
+    }
+
+    MultiArrayIndex binCount() const
+    {
+        return fine_.size();
+    }
+
+    MultiArrayIndex count() const
+    {
+        return count_;
+    }
+
+    void add(MultiArrayIndex bin)
+    {
+        ++fine_[bin];
+        ++coarse_[bin >> shift_];
+        ++count_;
+    }
+
+    void remove(MultiArrayIndex bin)
+    {
+        --fine_[bin];
+        --coarse_[bin >> shift_];
+        --count_;
+    }
+
+        // bin of the k-th smallest entry (k starts at 1)
+    MultiArrayIndex kth(MultiArrayIndex k) const
+    {
+        MultiArrayIndex c = 0;
+        for(; k > coarse_[c]; ++c)
+            k -= coarse_[c];
+        MultiArrayIndex b = c << shift_;
+        for(; k > fine_[b]; ++b)
+            k -= fine_[b];
+        return b;
+    }
+};
+
+// small integer types are used as histogram bins directly,
+// all other types are replaced by their rank within the processed region
+template <class T>
+struct RankFilterDirectBins
+{
+    typedef VigraFalseType type;
+};
+
+#define VIGRA_RANK_FILTER_DIRECT_BINS(T) \
+template <> \
+struct RankFilterDirectBins<T> \
+{ \
+    typedef VigraTrueType type; \
+};
+
+VIGRA_RANK_FILTER_DIRECT_BINS(UInt8)
+VIGRA_RANK_FILTER_DIRECT_BINS(Int8)
+VIGRA_RANK_FILTER_DIRECT_BINS(UInt16)
+VIGRA_RANK_FILTER_DIRECT_BINS(Int16)
+
+#undef VIGRA_RANK_FILTER_DIRECT_BINS
+
+template <class T>
+struct RankFilterWorkspace
+{
+    RankFilterHistogram histogram;
+    ArrayVector<MultiArrayIndex> bins, rowOffsets, rowRadii;
+    ArrayVector<std::pair<T, MultiArrayIndex> > sorted;
+};
+
+// Copy the region [start, start+shape) into 'bins' in scan order.
+// Lines along dimension 0 are always complete.
+template <unsigned int N, class T, class S>
+void
+rankFilterGatherBins(MultiArrayView<N, T, S> const & src,
+                     typename MultiArrayShape<N>::type const & start,
+                     typename MultiArrayShape<N>::type const & shape,
+                     RankFilterWorkspace<T> & ws,
+                     VigraTrueType /* direct bins */)
+{
+    MultiArrayView<N, T, S> region(src.subarray(start, start + shape));
+    MultiArrayIndex * bin = ws.bins.begin();
+    typename MultiArrayView<N, T, S>::iterator i = region.begin(), end = region.end();
+    for(; i != end; ++i, ++bin)
+        *bin = (MultiArrayIndex)*i - (MultiArrayIndex)NumericTraits<T>::min();
+}
+
+template <unsigned int N, class T, class S>
+void
+rankFilterGatherBins(MultiArrayView<N, T, S> const & src,
+                     typename MultiArrayShape<N>::type const & start,
+                     typename MultiArrayShape<N>::type const & shape,
+                     RankFilterWorkspace<T> & ws,
+                     VigraFalseType /* direct bins */)
+{
+    MultiArrayView<N, T, S> region(src.subarray(start, start + shape));
+    ws.sorted.clear();
+    typename MultiArrayView<N, T, S>::iterator i = region.begin(), end = region.end();
+    for(MultiArrayIndex k=0; i != end; ++i, ++k)
+        ws.sorted.push_back(std::make_pair(*i, k));
+    // sort the region once, then use the rank of each value as its bin
+    std::sort(ws.sorted.begin(), ws.sorted.end());
+    for(unsigned int k=0; k<ws.sorted.size(); ++k)
+        ws.bins[ws.sorted[k].second] = k;
+}
+
+template <class T>
+inline MultiArrayIndex
+rankFilterBinCount(MultiArrayIndex, VigraTrueType)
+{
+    return (MultiArrayIndex)NumericTraits<T>::max() - (MultiArrayIndex)NumericTraits<T>::min() + 1;
+}
+
+template <class T>
+inline MultiArrayIndex
+rankFilterBinCount(MultiArrayIndex regionSize, VigraFalseType)
+{
+    return regionSize;
+}
+
+template <class T>
+inline T
+rankFilterBinValue(RankFilterWorkspace<T> const &, MultiArrayIndex bin, VigraTrueType)
+{
+    return (T)(bin + (MultiArrayIndex)NumericTraits<T>::min());
+}
+
+template <class T>
+inline T
+rankFilterBinValue(RankFilterWorkspace<T> const & ws, MultiArrayIndex bin, VigraFalseType)
+{
+    return ws.sorted[bin].first;
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+void
+rankFilterMultiArrayImpl(MultiArrayView<N, T1, S1> const & src,
+                         MultiArrayView<N, T2, S2> dest,
+                         typename MultiArrayShape<N>::type const & radius,
+                         double rank,
+                         RankFilterWindow window,
+                         ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename RankFilterDirectBins<T1>::type DirectBins;
+
+    Shape shape(src.shape());
+    MultiArrayIndex w = shape[0];
+
+    // The window is described by its rows along dimension 0: for each offset
+    // in the remaining dimensions, the row covers [-radii[r], radii[r]].
+    ArrayVector<Shape> rows;
+    ArrayVector<MultiArrayIndex> radii;
+    Shape boxShape(2*radius + Shape(1));
+    boxShape[0] = 1;
+    MultiCoordinateIterator<N> c(boxShape), cend(c.getEndIterator());
+    for(; c != cend; ++c)
+    {
+        Shape offset = *c - radius;
+        offset[0] = 0;
+        if(window == BoxWindow)
+        {
+            rows.push_back(offset);
+            radii.push_back(radius[0]);
+            continue;
+        }
+        // same structuring function as discRankOrderFilter() in 2D
+        double d2 = 0.0;
+        for(unsigned int k=1; k<N; ++k)
+        {
+            if(offset[k] == 0)
+                continue;
+            double d = (std::abs((double)offset[k]) - 0.5) / radius[k];
+            d2 += d*d;
+        }
+        if(d2 > 1.0)
+            continue;
+        rows.push_back(offset);
+        radii.push_back((MultiArrayIndex)(radius[0]*std::sqrt(1.0 - d2) + 0.5));
+    }
+
+    // The lines along dimension 0 are processed in blocks. The values of the
+    // region covered by the windows of a block are converted into histogram
+    // bins once per block.
+    Shape blockShape(min(shape, radius + Shape(1))),
+          regionShape(min(shape, 3*radius + Shape(1)));
+    blockShape[0] = 1;
+    regionShape[0] = w;
+    Shape blocks((shape + blockShape - Shape(1)) / blockShape);
+    blocks[0] = 1;
+    MultiArrayIndex blockCount = prod(blocks);
+
+    int threadCount = options.getActualNumThreads();
+    ArrayVector<RankFilterWorkspace<T1> > workspaces(threadCount);
+    for(int k=0; k<threadCount; ++k)
+    {
+        workspaces[k].bins.resize(prod(regionShape));
+        workspaces[k].histogram.reshape(rankFilterBinCount<T1>(prod(regionShape), DirectBins()));
+    }
+
+    parallel_foreach(options, blockCount,
+        [&](int threadId, MultiArrayIndex b)
+        {
+            RankFilterWorkspace<T1> & ws = workspaces[threadId];
+            RankFilterHistogram & hist = ws.histogram;
+
+            Shape blockStart;
+            for(unsigned int k=1; k<N; ++k)
+            {
+                blockStart[k] = (b % blocks[k]) * blockShape[k];
+                b /= blocks[k];
+            }
+            Shape blockStop(min(shape, blockStart + blockShape)),
+                  regionStart(max(Shape(), blockStart - radius)),
+                  regionStop(min(shape, blockStop + radius));
+            regionStart[0] = 0;
+            regionStop[0] = w;
+            rankFilterGatherBins(src, regionStart, regionStop - regionStart, ws, DirectBins());
+
+            // scan-order strides of the region
+            Shape regionStrides;
+            regionStrides[0] = 1;
+            for(unsigned int k=1; k<N; ++k)
+                regionStrides[k] = regionStrides[k-1] * (regionStop[k-1] - regionStart[k-1]);
+
+            MultiCoordinateIterator<N> line(blockStop - blockStart), lend(line.getEndIterator());
+            for(; line != lend; ++line)
+            {
+                Shape start = blockStart + *line;
+                ws.rowOffsets.clear();
+                ws.rowRadii.clear();
+                for(unsigned int r=0; r<rows.size(); ++r)
+                {
+                    Shape p = start + rows[r];
+                    if(!src.isInside(p))
+                        continue;
+                    ws.rowOffsets.push_back(dot(p - regionStart, regionStrides));
+                    ws.rowRadii.push_back(radii[r]);
+                }
+                MultiArrayIndex const * bins = ws.bins.begin();
+                unsigned int rowCount = ws.rowOffsets.size();
+
+                // sliding window along dimension 0 (Huang's algorithm)
+                for(unsigned int r=0; r<rowCount; ++r)
+                {
+                    MultiArrayIndex const * row = bins + ws.rowOffsets[r];
+                    MultiArrayIndex xend = std::min(ws.rowRadii[r], w-1);
+                    for(MultiArrayIndex x=0; x<=xend; ++x)
+                        hist.add(row[x]);
+                }
+                T2 * out = &dest[start];
+                MultiArrayIndex outStride = dest.stride(0);
+                for(MultiArrayIndex x=0; x<w; ++x)
+                {
+                    if(x > 0)
+                    {
+                        for(unsigned int r=0; r<rowCount; ++r)
+                        {
+                            MultiArrayIndex const * row = bins + ws.rowOffsets[r];
+                            MultiArrayIndex xout = x - 1 - ws.rowRadii[r],
+                                            xin  = x + ws.rowRadii[r];
+                            if(xout >= 0)
+                                hist.remove(row[xout]);
+                            if(xin < w)
+                                hist.add(row[xin]);
+                        }
+                    }
+                    MultiArrayIndex k = std::max<MultiArrayIndex>(1, (MultiArrayIndex)std::ceil(rank*hist.count()));
+                    out[x*outStride] = detail::RequiresExplicitCast<T2>::cast(
+                                          rankFilterBinValue(ws, hist.kth(k), DirectBins()));
+                }
+
+                // empty the histogram for the next line
+                for(unsigned int r=0; r<rowCount; ++r)
+                {
+                    MultiArrayIndex const * row = bins + ws.rowOffsets[r];
+                    for(MultiArrayIndex x=std::max<MultiArrayIndex>(0, w-1-ws.rowRadii[r]); x<w; ++x)
+                        hist.remove(row[x]);
+                }
+            }
+        }
+    );
+}
+
+} // namespace detail
+
+/** \brief Rank order filter with box or disc window for arrays of arbitrary dimension.
+
+    For each element, the filter sorts the values in the window around this element
+    and returns the value at relative position <tt>rank</tt> (the smallest value
+    <tt>v</tt> such that at least <tt>rank</tt> times the window size values are
+    <tt>&lt;= v</tt>). Thus, the filter acts as a minimum filter if <tt>rank = 0.0</tt>,
+    as a median filter if <tt>rank = 0.5</tt>, and as a maximum filter if <tt>rank = 1.0</tt>.
+
+    The window extends <tt>radius[k]</tt> elements in either direction along axis <tt>k</tt>.
+    With <tt>window = BoxWindow</tt>, it is the complete box, with <tt>window = DiscWindow</tt>
+    the disc (ellipsoid) inscribed into the box. In 2D, the latter is the same structuring
+    function as in \ref discRankOrderFilter(). At the array border, only the
+    window elements inside the array are taken into account.
+
+    The window is moved along the first axis, and its contents are kept in a histogram
+    that only needs updates at the window's front and back (Huang's algorithm).
+    For <tt>UInt8</tt>, <tt>Int8</tt>, <tt>UInt16</tt> and <tt>Int16</tt> data, the
+    values are the histogram bins. For any other type, which must be comparable with
+    <tt>operator&lt;</tt>, the values around each line are sorted once and their ranks
+    are used as bins. The lines are distributed over the threads given by <tt>options</tt>.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        rankFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                             MultiArrayView<N, T2, S2> dest,
+                             typename MultiArrayShape<N>::type const & radius,
+                             double rank,
+                             RankFilterWindow window = BoxWindow,
+                             ParallelOptions const & options = ParallelOptions());
+
+        // isotropic radius
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        rankFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                             MultiArrayView<N, T2, S2> dest,
+                             MultiArrayIndex radius,
+                             double rank,
+                             RankFilterWindow window = BoxWindow,
+                             ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/medianfilter.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8> src(Shape3(200, 200, 200)), dest(src.shape());
+    ...
+
+    // 30% quantile in a ball of radius 10, using 4 threads
+    rankFilterMultiArray(src, dest, 10, 0.3, DiscWindow, ParallelOptions().numThreads(4));
+    \endcode
+
+    <b> Preconditions:</b>
+
+    <tt>0.0 <= rank <= 1.0</tt>, all radii are non-negative, and <tt>src</tt> and
+    <tt>dest</tt> have the same shape.
+*/
+doxygen_overloaded_function(template <...> void rankFilterMultiArray)
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+void
+rankFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                     MultiArrayView<N, T2, S2> dest,
+                     typename MultiArrayShape<N>::type const & radius,
+                     double rank,
+                     RankFilterWindow window = BoxWindow,
+                     ParallelOptions const & options = ParallelOptions())
+{
+    vigra_precondition(src.shape() == dest.shape(),
+        "rankFilterMultiArray(): shape mismatch between input and output.");
+    vigra_precondition(rank >= 0.0 && rank <= 1.0,
+        "rankFilterMultiArray(): Rank must be between 0 and 1 (inclusive).");
+    vigra_precondition(radius.minimum() >= 0,
+        "rankFilterMultiArray(): Radius must be >= 0.");
+    if(src.size() == 0)
+        return;
+    detail::rankFilterMultiArrayImpl(src, dest, radius, rank, window, options);
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+rankFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                     MultiArrayView<N, T2, S2> dest,
+                     MultiArrayIndex radius,
+                     double rank,
+                     RankFilterWindow window = BoxWindow,
+                     ParallelOptions const & options = ParallelOptions())
+{
+    rankFilterMultiArray(src, dest, typename MultiArrayShape<N>::type(radius),
+                         rank, window, options);
+}
+
+/** \brief Median filter with box or disc window for arrays of arbitrary dimension.
+
+    This is an abbreviation for \ref rankFilterMultiArray() with <tt>rank = 0.5</tt>.
+    In contrast to \ref medianFilter(), the window is given by its radius
+    and the border is handled by ignoring window elements outside the array.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        medianFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                               MultiArrayView<N, T2, S2> dest,
+                               typename MultiArrayShape<N>::type const & radius,
+                               RankFilterWindow window = BoxWindow,
+                               ParallelOptions const & options = ParallelOptions());
+
+        // isotropic radius
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        medianFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                               MultiArrayView<N, T2, S2> dest,
+                               MultiArrayIndex radius,
+                               RankFilterWindow window = BoxWindow,
+                               ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/medianfilter.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> src(Shape3(200, 200, 200)), dest(src.shape());
+    ...
+
+    // median in a 21x21x21 box
+    medianFilterMultiArray(src, dest, 10);
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void medianFilterMultiArray)
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+medianFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                       MultiArrayView<N, T2, S2> dest,
+                       typename MultiArrayShape<N>::type const & radius,
+                       RankFilterWindow window = BoxWindow,
+                       ParallelOptions const & options = ParallelOptions())
+{
+    rankFilterMultiArray(src, dest, radius, 0.5, window, options);
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+medianFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                       MultiArrayView<N, T2, S2> dest,
+                       MultiArrayIndex radius,
+                       RankFilterWindow window = BoxWindow,
+                       ParallelOptions const & options = ParallelOptions())
+{
+    rankFilterMultiArray(src, dest, typename MultiArrayShape<N>::type(radius),
+                         0.5, window, options);
+}
+
 } //end of namespace vigra
 
 #endif //VIGRA_MEDIANFILTER_HXX
@@ -191,6 +191,11 @@ public:
          return ConstRepIter<T>(*this,lastRep_+1);
    }
 
+   // O(1) alternative to find(value)==value
+   bool isRepresentative(const value_type & value)const{
+      return parents_[static_cast<SizeTType>(value)] == value;
+   }
+
    bool isErased(const value_type & value)const{
       return jumpVec_[value].first == -1 && jumpVec_[value].second == -1;
    }
@@ -807,6 +812,12 @@ class MergeGraphAdaptor
         NodeStorage & nodeImpl(const Node & node){
             return nodeVector_[id(node)];
         }
+        typename NodeStorage::AdjIt adjacencyBegin(const Node & node)const{
+            return nodeVector_[id(node)].adjacencyBegin();
+        }
+        typename NodeStorage::AdjIt adjacencyEnd(const Node & node)const{
+            return nodeVector_[id(node)].adjacencyEnd();
+        }
 
 
         const GRAPH & graph_;
@@ -820,6 +831,7 @@ class MergeGraphAdaptor
 
         size_t nDoubleEdges_;
         std::vector<std::pair<index_type,index_type> > doubleEdges_;
+        std::vector<typename NodeStorage::AdjacencyElement> mergedAdjacency_;
 };
 
 
@@ -1059,13 +1071,12 @@ MergeGraphAdaptor<GRAPH>::hasEdgeId(
     const typename MergeGraphAdaptor<GRAPH>::IdType edgeIndex
 )const{
     if(edgeIndex<=maxEdgeId() && !edgeUfd_.isErased(edgeIndex)){
-        const IdType reprEdgeIndex = reprEdgeId(edgeIndex);
-        if(reprEdgeIndex!=edgeIndex){
+        if(!edgeUfd_.isRepresentative(edgeIndex)){
             return false;
         }
         else{
-            const index_type rnid0=  uId(reprEdgeIndex);
-            const index_type rnid1=  vId(reprEdgeIndex);
+            const index_type rnid0=  uId(edgeIndex);
+            const index_type rnid1=  vId(edgeIndex);
             return rnid0!=rnid1;
         }
     }
@@ -1080,7 +1091,7 @@ MergeGraphAdaptor<GRAPH>::hasNodeId(
     const typename MergeGraphAdaptor<GRAPH>::IdType nodeIndex
 )const{
 
-    return nodeIndex<=maxNodeId() &&  !nodeUfd_.isErased(nodeIndex) && nodeUfd_.find(nodeIndex)==nodeIndex;
+    return nodeIndex<=maxNodeId() &&  !nodeUfd_.isErased(nodeIndex) && nodeUfd_.isRepresentative(nodeIndex);
 }
 
 template<class GRAPH>
@@ -1138,57 +1149,58 @@ void MergeGraphAdaptor<GRAPH>::contractEdge(
     const IdType newNodeRep    = reprNodeId(nodesIds[0]);
     const IdType notNewNodeRep =  (newNodeRep == nodesIds[0] ? nodesIds[1] : nodesIds[0] );
 
-    typename NodeStorage::AdjIt iter=nodeVector_[notNewNodeRep].adjacencyBegin();
-    typename NodeStorage::AdjIt end =nodeVector_[notNewNodeRep].adjacencyEnd();
-   
-    nDoubleEdges_=0;
-    for(;iter!=end;++iter){
-        const size_t adjToDeadNodeId = iter->nodeId(); 
-        if(adjToDeadNodeId!=newNodeRep){
-
-            // REFACTOR ME,  we can make that faster if
-            // we do that in set intersect style
-            std::pair<index_type,bool> found=nodeVector_[adjToDeadNodeId].findEdge(newNodeRep);
-
-
-            if(found.second){
-                edgeUfd_.merge(iter->edgeId(),found.first);
-                
-                const index_type edgeA = iter->edgeId();
-                const index_type edgeB = found.first;
-                const index_type edgeR  = edgeUfd_.find(edgeA);
-                const index_type edgeNR = edgeR==edgeA ? edgeB : edgeA; 
-
-                nodeVector_[adjToDeadNodeId].eraseFromAdjacency(notNewNodeRep);
-
-                // refactor me ... this DOES NOT change the key
-                nodeVector_[adjToDeadNodeId].eraseFromAdjacency(newNodeRep);
-                nodeVector_[adjToDeadNodeId].insert(newNodeRep,edgeR);
-
-                // refactor me .. this DOES NOT change the key
-                nodeVector_[newNodeRep].eraseFromAdjacency(adjToDeadNodeId);
-                nodeVector_[newNodeRep].insert(adjToDeadNodeId,edgeR);
+    // merge the adjacency of the dead node into the adjacency of the new 
+    // representative in a single pass over both sorted sets, and detect
+    // the common neighbors (i.e. double edges) on the way
+    NodeStorage & newNode  = nodeVector_[newNodeRep];
+    NodeStorage & deadNode = nodeVector_[notNewNodeRep];
+    typename NodeStorage::AdjIt newIter = newNode.adjacencyBegin(),  newEnd  = newNode.adjacencyEnd();
+    typename NodeStorage::AdjIt deadIter= deadNode.adjacencyBegin(), deadEnd = deadNode.adjacencyEnd();
 
-                doubleEdges_[nDoubleEdges_]=std::pair<index_type,index_type>(edgeR,edgeNR );
-                ++nDoubleEdges_;
-            }
-            else{
-                nodeVector_[adjToDeadNodeId].eraseFromAdjacency(notNewNodeRep);
-                //nodeVector_[adjToDeadNodeId].eraseFromAdjacency(newNodeRep);
-                nodeVector_[adjToDeadNodeId].insert(newNodeRep,iter->edgeId());
-
-                // symetric
-                //nodeVector_[newNodeRep].eraseFromAdjacency(adjToDeadNodeId);
-                nodeVector_[newNodeRep].insert(adjToDeadNodeId,iter->edgeId());
-
-            }
+    mergedAdjacency_.clear();
+    nDoubleEdges_=0;
+    while(newIter!=newEnd || deadIter!=deadEnd){
+        if(newIter!=newEnd && newIter->nodeId()==notNewNodeRep){
+            ++newIter;
+        }
+        else if(deadIter!=deadEnd && deadIter->nodeId()==newNodeRep){
+            ++deadIter;
+        }
+        else if(deadIter==deadEnd || (newIter!=newEnd && newIter->nodeId() < deadIter->nodeId())){
+            // neighbor of the new representative only
+            mergedAdjacency_.push_back(*newIter);
+            ++newIter;
+        }
+        else if(newIter==newEnd || deadIter->nodeId() < newIter->nodeId()){
+            // neighbor of the dead node only => just relabel
+            const index_type adjToDeadNodeId = deadIter->nodeId();
+            nodeVector_[adjToDeadNodeId].eraseFromAdjacency(notNewNodeRep);
+            nodeVector_[adjToDeadNodeId].insert(newNodeRep,deadIter->edgeId());
+            mergedAdjacency_.push_back(*deadIter);
+            ++deadIter;
+        }
+        else{
+            // common neighbor => the two edges become one
+            const index_type adjToDeadNodeId = deadIter->nodeId();
+            const index_type edgeA = deadIter->edgeId();
+            const index_type edgeB = newIter->edgeId();
+            edgeUfd_.merge(edgeA,edgeB);
+            const index_type edgeR  = edgeUfd_.find(edgeA);
+            const index_type edgeNR = edgeR==edgeA ? edgeB : edgeA; 
+
+            nodeVector_[adjToDeadNodeId].eraseFromAdjacency(notNewNodeRep);
+            nodeVector_[adjToDeadNodeId].eraseFromAdjacency(newNodeRep);
+            nodeVector_[adjToDeadNodeId].insert(newNodeRep,edgeR);
+            mergedAdjacency_.push_back(typename NodeStorage::AdjacencyElement(adjToDeadNodeId,edgeR));
+
+            doubleEdges_[nDoubleEdges_]=std::pair<index_type,index_type>(edgeR,edgeNR );
+            ++nDoubleEdges_;
+            ++newIter;
+            ++deadIter;
         }
     }
-
-    //nodeVector_[newNodeRep].merge(nodeVector_[notNewNodeRep]);
-    nodeVector_[newNodeRep].eraseFromAdjacency(notNewNodeRep);
-    //nodeVector_[newNodeRep].eraseFromAdjacency(newNodeRep); // no self adjacecy
-    nodeVector_[notNewNodeRep].clear();
+    newNode.assignSorted(mergedAdjacency_.begin(),mergedAdjacency_.end());
+    deadNode.clear();
     
     edgeUfd_.eraseElement(toDeleteEdgeIndex);
 
@@ -60,6 +60,9 @@
 #include "random_forest/rf_online_prediction_set.hxx"
 #include "random_forest/rf_earlystopping.hxx"
 #include "random_forest/rf_ridge_split.hxx"
+#include "random_forest/rf_compiled.hxx"
+#include "random_forest/rf_binning.hxx"
+#include "threadpool.hxx"
 namespace vigra
 {
 
@@ -86,6 +89,199 @@ inline SamplerOptions make_sampler_opt ( RandomForestOptions     & RF_opt)
     return_opt.stratified(RF_opt.stratification_method_ == RF_EQUAL);
     return return_opt;
 }
+
+/* \brief visitor adaptor that serializes calls to visit_after_split() 
+ * when several trees are learned concurrently.
+ */
+template <class Visitor>
+class RF_SynchronizedVisitor
+{
+  public:
+    Visitor &           visitor_;
+    threading::mutex &  mutex_;
+
+    RF_SynchronizedVisitor(Visitor & visitor, threading::mutex & mutex)
+    : visitor_(visitor),
+      mutex_(mutex)
+    {}
+
+    template<class Tree, class Split, class Region, class Feature_t, class Label_t>
+    void visit_after_split( Tree          & tree, 
+                            Split         & split,
+                            Region        & parent,
+                            Region        & leftChild,
+                            Region        & rightChild,
+                            Feature_t     & features,
+                            Label_t       & labels)
+    {
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        visitor_.visit_after_split(tree, split, parent, leftChild, rightChild,
+                                   features, labels);
+    }
+};
+
+/* \brief can the split functor be used with RandomForestOptions::feature_bins()?
+ */
+template <class Split>
+struct RF_SupportsFeatureBinning
+{
+    typedef VigraFalseType type;
+};
+
+template <>
+struct RF_SupportsFeatureBinning<RF_DEFAULT>
+{
+    typedef VigraTrueType type;
+};
+
+template <class ColumnDecisionFunctor, class Tag>
+struct RF_SupportsFeatureBinning<ThresholdSplit<ColumnDecisionFunctor, Tag> >
+{
+    typedef VigraTrueType type;
+};
+
+/* \brief learn one tree (used by RandomForest::learn() in multi-threaded 
+ * mode). The trees are distributed dynamically over the threads, and each
+ * thread has its own random number generator and sampler. visit_after_split() 
+ * and visit_after_tree() are serialized by separate mutexes, and 
+ * visit_after_tree() is called in the order in which the trees are finished.
+ */
+template <class RF, class Preprocessor, class Split, class Stop, 
+          class Visitor, class Random, class StackEntry>
+struct RF_LearnTreeFunctor
+{
+    RF &                                rf_;
+    Preprocessor &                      preprocessor_;
+    Split const &                       split_;
+    Stop const &                        stop_;
+    Visitor &                           visitor_;
+    threading::mutex &                  split_mutex_;
+    threading::mutex &                  tree_mutex_;
+    ArrayVector<UInt32> const &         seeds_;
+    std::vector<Random> &               randoms_;
+    std::vector<Sampler<Random> > &     samplers_;
+
+    RF_LearnTreeFunctor(RF & rf, Preprocessor & preprocessor,
+                        Split const & split, Stop const & stop, Visitor & visitor, 
+                        threading::mutex & split_mutex, threading::mutex & tree_mutex,
+                        ArrayVector<UInt32> const & seeds,
+                        std::vector<Random> & randoms,
+                        std::vector<Sampler<Random> > & samplers)
+    : rf_(rf), preprocessor_(preprocessor), split_(split), stop_(stop),
+      visitor_(visitor), split_mutex_(split_mutex), tree_mutex_(tree_mutex), 
+      seeds_(seeds), randoms_(randoms), samplers_(samplers)
+    {}
+
+    void operator()(int thread_id, MultiArrayIndex k)
+    {
+        int tree = (int)k;
+        randoms_[thread_id].seed(seeds_[tree]);
+        UniformIntRandomFunctor<Random> randint(randoms_[thread_id]);
+
+        Sampler<Random> & sampler = samplers_[thread_id];
+        sampler.sample();
+        StackEntry first_stack_entry(sampler.sampledIndices().begin(),
+                                     sampler.sampledIndices().end(),
+                                     rf_.ext_param_.class_count_);
+        first_stack_entry.set_oob_range(sampler.oobIndices().begin(),
+                                        sampler.oobIndices().end());
+        RF_SynchronizedVisitor<Visitor> split_visitor(visitor_, split_mutex_);
+        rf_.trees_[tree].learn(preprocessor_.features(),
+                               preprocessor_.response(),
+                               first_stack_entry,
+                               split_,
+                               stop_,
+                               split_visitor,
+                               randint);
+
+        threading::lock_guard<threading::mutex> lock(tree_mutex_);
+        visitor_.visit_after_tree(rf_, preprocessor_, sampler, first_stack_entry, tree);
+    }
+};
+
+/* \brief predict the probabilities of one block of rows (used by
+ * RandomForest::predictProbabilities() in multi-threaded mode).
+ * Blocks are disjoint, so the threads never write to the same row.
+ */
+template <class RF, class U, class C1, class T, class C2>
+struct RF_PredictProbabilitiesFunctor
+{
+    RF const &                          rf_;
+    MultiArrayView<2, U, C1> const &    features_;
+    MultiArrayView<2, T, C2> &          prob_;
+    MultiArrayIndex                     block_size_;
+
+    RF_PredictProbabilitiesFunctor(RF const & rf,
+                                   MultiArrayView<2, U, C1> const & features,
+                                   MultiArrayView<2, T, C2> & prob,
+                                   MultiArrayIndex block_size)
+    : rf_(rf), features_(features), prob_(prob), block_size_(block_size)
+    {}
+
+    void operator()(int /* thread_id */, MultiArrayIndex block)
+    {
+        MultiArrayIndex begin = block*block_size_,
+                        end   = std::min(begin + block_size_, rowCount(features_));
+        ArrayVector<bool> valid(end - begin);
+        rf_.predictProbabilitiesBlock(
+                features_.subarray(Shape2(begin, 0), Shape2(end, columnCount(features_))),
+                prob_.subarray(Shape2(begin, 0), Shape2(end, columnCount(prob_))),
+                valid);
+    }
+};
+
+/* \brief predict the labels of one block of rows (used by
+ * RandomForest::predictLabels()). When nan_is_error_ is true,
+ * rows containing NaN raise a precondition error, otherwise they
+ * get nan_label_.
+ */
+template <class RF, class U, class C1, class T, class C2>
+struct RF_PredictLabelsFunctor
+{
+    typedef typename RF::LabelT LabelType;
+
+    RF const &                          rf_;
+    MultiArrayView<2, U, C1> const &    features_;
+    MultiArrayView<2, T, C2> &          labels_;
+    MultiArrayIndex                     block_size_;
+    bool                                nan_is_error_;
+    LabelType                           nan_label_;
+
+    RF_PredictLabelsFunctor(RF const & rf,
+                            MultiArrayView<2, U, C1> const & features,
+                            MultiArrayView<2, T, C2> & labels,
+                            MultiArrayIndex block_size,
+                            bool nan_is_error,
+                            LabelType nan_label)
+    : rf_(rf), features_(features), labels_(labels), block_size_(block_size),
+      nan_is_error_(nan_is_error), nan_label_(nan_label)
+    {}
+
+    void operator()(int /* thread_id */, MultiArrayIndex block)
+    {
+        MultiArrayIndex begin = block*block_size_,
+                        end   = std::min(begin + block_size_, rowCount(features_));
+        MultiArray<2, double> prob(Shape2(end - begin, rf_.ext_param_.class_count_));
+        ArrayVector<bool> valid(end - begin);
+        rf_.predictProbabilitiesBlock(
+                features_.subarray(Shape2(begin, 0), Shape2(end, columnCount(features_))),
+                prob, valid);
+        for(MultiArrayIndex row = 0; row < end - begin; ++row)
+        {
+            if(!valid[row])
+            {
+                vigra_precondition(!nan_is_error_,
+                    "RandomForest::predictLabels(): NaN in feature matrix.");
+                labels_(begin + row, 0) = nan_label_;
+                continue;
+            }
+            LabelType d;
+            rf_.ext_param_.to_classlabel(argMax(rowVector(prob, row)), d);
+            labels_(begin + row, 0) = RequiresExplicitCast<T>::cast(d);
+        }
+    }
+};
+
 }//namespace detail
 
 /** Random Forest class
@@ -139,6 +335,10 @@ inline SamplerOptions make_sampler_opt ( RandomForestOptions     & RF_opt)
  *  via Visitors defined in rf::visitors. 
  *  Have a look at rf::split for other splitting methods.
  *
+ *  When a trained forest is used for many predictions, convert it into a 
+ *  \ref vigra::CompiledRandomForest, which predicts the same labels 
+ *  and probabilities several times faster.
+ *
 */
 template <class LabelType = double , class PreprocessorTag = ClassificationTag >
 class RandomForest
@@ -418,7 +618,11 @@ class RandomForest
     /**\brief learn on data with custom config and random number generator
      *
      * \param features  a N x M matrix containing N samples with M
-     *                  features
+     *                  features. The matrix is used in place, i.e. 
+     *                  it is neither copied nor converted to another
+     *                  value type. Any view (e.g. float32, strided,
+     *                  or on memory-mapped data) can be passed and must
+     *                  remain valid until learn() returns.
      * \param response  a N x D matrix containing the corresponding
      *                  response. Current split functors assume D to
      *                  be 1 and ignore any additional columns.
@@ -504,6 +708,39 @@ class RandomForest
                 rf_default());
     }
 
+    /* learn on features quantized by FeatureBinning 
+     * (RandomForestOptions::feature_bins()), if the split functor supports it
+     */
+    template <class U, class C1,
+             class U2,class C2,
+             class Split_t,
+             class Stop_t,
+             class Visitor_t,
+             class Random_t>
+    void learnBinned(MultiArrayView<2, U, C1> const  &   features,
+                     MultiArrayView<2, U2,C2> const  &   response,
+                     Visitor_t                           visitor,
+                     Split_t                             split,
+                     Stop_t                              stop,
+                     Random_t                 const  &   random,
+                     VigraTrueType);
+
+    template <class U, class C1,
+             class U2,class C2,
+             class Split_t,
+             class Stop_t,
+             class Visitor_t,
+             class Random_t>
+    void learnBinned(MultiArrayView<2, U, C1> const  &,
+                     MultiArrayView<2, U2,C2> const  &,
+                     Visitor_t, Split_t, Stop_t,
+                     Random_t                 const  &,
+                     VigraFalseType)
+    {
+        vigra_precondition(false,
+            "RandomForest::learn(): feature binning requires a ThresholdSplit functor.");
+    }
+
     /**\brief learn on data with default configuration
      *
      * \param features  a N x M matrix containing N samples with M
@@ -577,6 +814,9 @@ class RandomForest
      *        output.
      *
      * If the input contains an NaN value, an precondition exception is thrown.
+     *
+     * The rows are processed in blocks, using
+     * <tt>options_.n_threads_</tt> threads (see RandomForestOptions::n_threads()).
      */
     template <class U, class C1, class T, class C2>
     void predictLabels(MultiArrayView<2, U, C1>const & features,
@@ -584,12 +824,9 @@ class RandomForest
     {
         vigra_precondition(features.shape(0) == labels.shape(0),
             "RandomForest::predictLabels(): Label array has wrong size.");
-        for(int k=0; k<features.shape(0); ++k)
-        {
-            vigra_precondition(!detail::contains_nan(rowVector(features, k)),
-                "RandomForest::predictLabels(): NaN in feature matrix.");
-            labels(k,0) = detail::RequiresExplicitCast<T>::cast(predictLabel(rowVector(features, k), rf_default()));
-        }
+        vigra_precondition(columnCount(features) >= ext_param_.column_count_,
+            "RandomForest::predictLabels(): Too few columns in feature matrix.");
+        predictLabelsImpl(features, labels, true, LabelType());
     }
 
     /** \brief predict multiple labels with given features
@@ -609,13 +846,9 @@ class RandomForest
     {
         vigra_precondition(features.shape(0) == labels.shape(0),
             "RandomForest::predictLabels(): Label array has wrong size.");
-        for(int k=0; k<features.shape(0); ++k)
-        {
-            if(detail::contains_nan(rowVector(features, k)))
-                labels(k,0) = nanLabel;
-            else
-                labels(k,0) = detail::RequiresExplicitCast<T>::cast(predictLabel(rowVector(features, k), rf_default()));
-        }
+        vigra_precondition(columnCount(features) >= ext_param_.column_count_,
+            "RandomForest::predictLabels(): Too few columns in feature matrix.");
+        predictLabelsImpl(features, labels, false, nanLabel);
     }
 
     /** \brief predict multiple labels with given features
@@ -667,8 +900,62 @@ class RandomForest
     void predictProbabilities(MultiArrayView<2, U, C1>const &   features,
                               MultiArrayView<2, T, C2> &        prob)  const
     {
-        predictProbabilities(features, prob, rf_default()); 
-    }   
+        predictProbabilities(features, prob, rf_default());
+    }
+
+    /** \brief predict the class probabilities for multiple labels
+     *         with the default stopping criterion
+     *
+     *  The default criterion never stops early, so the rows can be
+     *  processed in independent blocks. The trees are traversed
+     *  tree-by-tree within each block (which keeps the current tree
+     *  in cache), and the blocks are distributed over
+     *  <tt>options_.n_threads_</tt> threads (see RandomForestOptions::n_threads()).
+     *  The result is identical to the row-by-row computation.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilities(MultiArrayView<2, U, C1>const &   features,
+                              MultiArrayView<2, T, C2> &        prob,
+                              detail::RF_DEFAULT &)  const;
+
+  private:
+    template <class, class, class, class, class>
+    friend struct detail::RF_PredictProbabilitiesFunctor;
+    template <class, class, class, class, class>
+    friend struct detail::RF_PredictLabelsFunctor;
+    template <class RF, unsigned int N, class U, class S1, class T, class S2>
+    friend void rf_blockwise_detail::predictTile(RF const &,
+                                                 MultiArrayView<N, U, S1> const &,
+                                                 MultiArrayView<N, T, S2> &,
+                                                 MultiArrayIndex, MultiArrayIndex);
+
+    /* \brief compute the probabilities of a block of rows.
+     * valid[row] is set to false for rows containing NaN, whose
+     * probabilities are zero.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilitiesBlock(MultiArrayView<2, U, C1> const & features,
+                                   MultiArrayView<2, T, C2>         prob,
+                                   ArrayVector<bool> &              valid) const;
+
+    template <class U, class C1, class T, class C2>
+    void predictLabelsImpl(MultiArrayView<2, U, C1> const & features,
+                           MultiArrayView<2, T, C2> &       labels,
+                           bool nanIsError, LabelType nanLabel) const
+    {
+        MultiArrayIndex blockSize = predictionBlockSize,
+                        blockCount = (rowCount(features) + blockSize - 1) / blockSize;
+        parallel_foreach(ParallelOptions().numThreads(options_.n_threads_), blockCount,
+            detail::RF_PredictLabelsFunctor<RandomForest, U, C1, T, C2>(
+                        *this, features, labels, blockSize, nanIsError, nanLabel));
+    }
+
+  public:
+
+    /* number of rows that are passed through the trees together
+     * in predictProbabilities() and predictLabels()
+     */
+    static const int predictionBlockSize = 128;
 
     template <class U, class C1, class T, class C2>
     void predictRaw(MultiArrayView<2, U, C1>const &   features,
@@ -922,6 +1209,35 @@ void RandomForest<LabelType, PreprocessorTag>::reLearnTree(MultiArrayView<2,U,C1
     online_visitor_.deactivate();
 }
 
+template <class LabelType, class PreprocessorTag>
+template <class U, class C1,
+         class U2,class C2,
+         class Split_t,
+         class Stop_t,
+         class Visitor_t,
+         class Random_t>
+void RandomForest<LabelType, PreprocessorTag>::
+                     learnBinned(MultiArrayView<2, U, C1> const  &   features,
+                                 MultiArrayView<2, U2,C2> const  &   response,
+                                 Visitor_t                           visitor,
+                                 Split_t                             split,
+                                 Stop_t                              stop,
+                                 Random_t                 const  &   random,
+                                 VigraTrueType)
+{
+    // learn on quantized features, then map the thresholds back
+    vigra_precondition(!options_.prepare_online_learning_,
+        "RandomForest::learn(): feature binning cannot be combined with online learning.");
+    vigra_precondition(!detail::contains_nan(features), 
+        "RandomForest::learn(): Feature matrix contains NaNs");
+    FeatureBinning binning(options_.feature_bins_);
+    binning.learn(features);
+    MultiArray<2, UInt8> binned(features.shape());
+    binning.transform(features, binned);
+    learn(binned, response, visitor, split, stop, random);
+    binning.convertThresholds(*this);
+}
+
 template <class LabelType, class PreprocessorTag>
 template <class U, class C1,
          class U2,class C2,
@@ -948,6 +1264,13 @@ void RandomForest<LabelType, PreprocessorTag>::
 
     vigra_precondition(features.shape(0) == response.shape(0),
         "RandomForest::learn(): shape mismatch between features and response.");
+
+    if(options_.feature_bins_ > 0 && !IsSameType<U, UInt8>::value)
+    {
+        learnBinned(features, response, visitor_, split_, stop_, random,
+                    typename detail::RF_SupportsFeatureBinning<Split_t>::type());
+        return;
+    }
     
     // default values and initialization
     // Value Chooser chooses second argument as value if first argument
@@ -967,6 +1290,8 @@ void RandomForest<LabelType, PreprocessorTag>::
                 typename RF_CHOOSER(Visitor_t)::type> IntermedVis; 
     IntermedVis
         visitor(online_visitor_, RF_CHOOSER(Visitor_t)::choose(visitor_, stopvisiting));
+    typedef typename RF_CHOOSER(Split_t)::type  ActualSplit_t;
+    typedef typename RF_CHOOSER(Stop_t)::type   ActualStop_t;
     #undef RF_CHOOSER
     if(options_.prepare_online_learning_)
         online_visitor_.activate();
@@ -1000,34 +1325,70 @@ void RandomForest<LabelType, PreprocessorTag>::
                                &random);
 
     visitor.visit_at_beginning(*this, preprocessor);
-    // THE MAIN EFFING RF LOOP - YEAY DUDE!
-    
-    for(int ii = 0; ii < static_cast<int>(trees_.size()); ++ii)
+
+    ParallelOptions parallel_options = ParallelOptions().numThreads(options_.n_threads_);
+    if(parallel_options.getNumThreads() > 1)
     {
-        //initialize First region/node/stack entry
-        sampler
-            .sample();  
-        StackEntry_t
-            first_stack_entry(  sampler.sampledIndices().begin(),
-                                sampler.sampledIndices().end(),
-                                ext_param_.class_count_);
-        first_stack_entry
-            .set_oob_range(     sampler.oobIndices().begin(),
-                                sampler.oobIndices().end());
-        trees_[ii]
-            .learn(             preprocessor.features(),
-                                preprocessor.response(),
-                                first_stack_entry,
-                                split,
-                                stop,
-                                visitor,
-                                randint);
-        visitor
-            .visit_after_tree(  *this,
-                                preprocessor,
-                                sampler,
-                                first_stack_entry,
-                                ii);
+        vigra_precondition(!options_.prepare_online_learning_,
+            "RandomForest::learn(): online learning requires n_threads(1).");
+
+        int tree_count   = static_cast<int>(trees_.size());
+        int thread_count = std::min(tree_count, parallel_options.getActualNumThreads());
+
+        // draw one seed per tree, so that the result doesn't depend on thread_count
+        ArrayVector<UInt32> seeds(tree_count);
+        for(int ii = 0; ii < tree_count; ++ii)
+            seeds[ii] = random();
+
+        std::vector<Random_t> randoms(thread_count);
+        std::vector<Sampler<Random_t> > samplers;
+        samplers.reserve(thread_count);
+        for(int k = 0; k < thread_count; ++k)
+            samplers.push_back(Sampler<Random_t>(preprocessor.strata().begin(),
+                                                 preprocessor.strata().end(),
+                                                 detail::make_sampler_opt(options_)
+                                                      .sampleSize(ext_param().actual_msample_),
+                                                 &randoms[k]));
+
+        typedef detail::RF_LearnTreeFunctor<RandomForest, Preprocessor_t, 
+                                            ActualSplit_t, ActualStop_t, IntermedVis, 
+                                            Random_t, StackEntry_t> LearnTreeFunctor;
+        threading::mutex split_mutex, tree_mutex;
+        parallel_foreach(parallel_options.numThreads(thread_count), tree_count,
+            LearnTreeFunctor(*this, preprocessor, split, stop, visitor, 
+                             split_mutex, tree_mutex, seeds, randoms, samplers));
+    }
+    else
+    {
+        // THE MAIN EFFING RF LOOP - YEAY DUDE!
+    
+        for(int ii = 0; ii < static_cast<int>(trees_.size()); ++ii)
+        {
+            //initialize First region/node/stack entry
+            sampler
+                .sample();  
+            StackEntry_t
+                first_stack_entry(  sampler.sampledIndices().begin(),
+                                    sampler.sampledIndices().end(),
+                                    ext_param_.class_count_);
+            first_stack_entry
+                .set_oob_range(     sampler.oobIndices().begin(),
+                                    sampler.oobIndices().end());
+            trees_[ii]
+                .learn(             preprocessor.features(),
+                                    preprocessor.response(),
+                                    first_stack_entry,
+                                    split,
+                                    stop,
+                                    visitor,
+                                    randint);
+            visitor
+                .visit_after_tree(  *this,
+                                    preprocessor,
+                                    sampler,
+                                    first_stack_entry,
+                                    ii);
+        }
     }
 
     visitor.visit_at_end(*this, preprocessor);
@@ -1250,7 +1611,7 @@ void RandomForest<LabelType, PreprocessorTag>
     typename RF_CHOOSER(Stop_t)::type & stop
             = RF_CHOOSER(Stop_t)::choose(stop_, default_stop); 
     #undef RF_CHOOSER 
-    stop.set_external_parameters(ext_param_, tree_count());
+    stop.set_external_parameters(ext_param_, tree_count(), options_.predict_weighted_);
     prob.init(NumericTraits<T>::zero());
     /* This code was originally there for testing early stopping
      * - we wanted the order of the trees to be randomized
@@ -1312,6 +1673,83 @@ void RandomForest<LabelType, PreprocessorTag>
 
 }
 
+template <class LabelType, class PreprocessorTag>
+template <class U, class C1, class T, class C2>
+void RandomForest<LabelType, PreprocessorTag>
+    ::predictProbabilities(MultiArrayView<2, U, C1>const &  features,
+                           MultiArrayView<2, T, C2> &       prob,
+                           detail::RF_DEFAULT &) const
+{
+    vigra_precondition(rowCount(features) == rowCount(prob),
+      "RandomForestn::predictProbabilities():"
+        " Feature matrix and probability matrix size mismatch.");
+    vigra_precondition( columnCount(features) >= ext_param_.column_count_,
+      "RandomForestn::predictProbabilities():"
+        " Too few columns in feature matrix.");
+    vigra_precondition( columnCount(prob)
+                        == static_cast<MultiArrayIndex>(ext_param_.class_count_),
+      "RandomForestn::predictProbabilities():"
+      " Probability matrix must have as many columns as there are classes.");
+
+    MultiArrayIndex blockSize = predictionBlockSize,
+                    blockCount = (rowCount(features) + blockSize - 1) / blockSize;
+    parallel_foreach(ParallelOptions().numThreads(options_.n_threads_), blockCount,
+        detail::RF_PredictProbabilitiesFunctor<RandomForest, U, C1, T, C2>(
+                                              *this, features, prob, blockSize));
+}
+
+template <class LabelType, class PreprocessorTag>
+template <class U, class C1, class T, class C2>
+void RandomForest<LabelType, PreprocessorTag>
+    ::predictProbabilitiesBlock(MultiArrayView<2, U, C1> const & features,
+                                MultiArrayView<2, T, C2>         prob,
+                                ArrayVector<bool> &              valid) const
+{
+    vigra_precondition(columnCount(features) >= ext_param_.column_count_,
+        "RandomForest::predictProbabilitiesBlock(): Too few columns in feature matrix.");
+    int rows = rowCount(features);
+    prob.init(NumericTraits<T>::zero());
+
+    // when the features contain an NaN, the instance doesn't belong to any class
+    // => indicate this by returning a zero probability array.
+    for(int row=0; row < rows; ++row)
+        valid[row] = !detail::contains_nan(rowVector(features, row));
+
+    //totalWeight == totalVoteCount!
+    ArrayVector<double> totalWeight(rows, 0.0);
+    int weighted = options_.predict_weighted_;
+
+    // Let each tree classify all rows of the block before moving
+    // to the next tree. The accumulation order per row is the same
+    // as in the row-by-row version, so the results are identical.
+    for(int k=0; k<options_.tree_count_; ++k)
+    {
+        for(int row=0; row < rows; ++row)
+        {
+            if(!valid[row])
+                continue;
+            ArrayVector<double>::const_iterator weights
+                = trees_[k].predict(rowVector(features, row));
+            for(int l=0; l<ext_param_.class_count_; ++l)
+            {
+                double cur_w = weights[l] * (weighted * (*(weights-1))
+                                           + (1-weighted));
+                prob(row, l) += static_cast<T>(cur_w);
+                totalWeight[row] += cur_w;
+            }
+        }
+    }
+
+    //Normalise votes in each row by total VoteCount (totalWeight
+    for(int row=0; row < rows; ++row)
+    {
+        if(!valid[row])
+            continue;
+        for(int l=0; l< ext_param_.class_count_; ++l)
+            prob(row, l) /= detail::RequiresExplicitCast<T>::cast(totalWeight[row]);
+    }
+}
+
 template <class LabelType, class PreprocessorTag>
 template <class U, class C1, class T, class C2>
 void RandomForest<LabelType, PreprocessorTag>
@@ -0,0 +1,250 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2015 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_RF_BINNING_HXX
+#define VIGRA_RF_BINNING_HXX
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "../multi_array.hxx"
+#include "../array_vector.hxx"
+#include "../sized_int.hxx"
+#include "rf_nodeproxy.hxx"
+
+namespace vigra
+{
+
+/** \brief Quantize the columns of a feature matrix into at most 256 bins.
+
+    <b>\#include</b> \<vigra/random_forest.hxx\><br>
+    Namespace: vigra
+
+    The standard split search of the \ref vigra::RandomForest sorts the samples of 
+    each node along every candidate feature. When the features are stored as 
+    <tt>UInt8</tt>, the split search (\ref vigra::BestGiniOfColumn) instead 
+    accumulates a class histogram over the 256 possible values in a single pass, 
+    which removes the sort and makes training on large data sets much faster. 
+    FeatureBinning converts arbitrary features into this representation:
+    
+    <ul>
+    <li> learn() determines the bin boundaries of each column from the data.
+         If a column has at most <tt>maxBins</tt> distinct values, each value gets 
+         its own bin, and the boundaries are the midpoints between consecutive 
+         values. The forest then has the same structure as one learned on the
+         original features.
+         Otherwise, the boundaries are placed such that the bins contain 
+         approximately equal numbers of samples.
+    <li> transform() replaces each feature with the index of its bin.
+    <li> After a forest has been learned on the transformed features, 
+         convertThresholds() maps the split thresholds back into the original 
+         feature space, so that the forest can be applied to raw features.
+    </ul>
+    
+    This is done automatically by RandomForest::learn() when
+    RandomForestOptions::feature_bins() is set.
+    
+    <b>Usage:</b>
+    
+    \code
+    FeatureBinning binning(256);
+    binning.learn(features);
+    MultiArray<2, UInt8> binned(features.shape());
+    binning.transform(features, binned);
+    
+    RandomForest<int> rf;
+    rf.learn(binned, labels);
+    binning.convertThresholds(rf);
+    
+    rf.predictLabels(test_features, predicted_labels);
+    \endcode
+*/
+class FeatureBinning
+{
+  public:
+    /** \brief Create a binning with at most \a maxBins bins per 
+               column (2 <= \a maxBins <= 256).
+     */
+    explicit FeatureBinning(int maxBins = 256)
+    : max_bins_(maxBins)
+    {
+        vigra_precondition(maxBins >= 2 && maxBins <= 256,
+            "FeatureBinning(): maxBins must be in [2, 256].");
+    }
+
+    /** \brief Determine the bin boundaries of every column of \a features.
+     */
+    template <class U, class C>
+    void learn(MultiArrayView<2, U, C> const & features)
+    {
+        MultiArrayIndex rows = features.shape(0);
+        edges_.clear();
+        edges_.resize(features.shape(1));
+        ArrayVector<double> values(rows);
+        for(MultiArrayIndex k=0; k<features.shape(1); ++k)
+        {
+            for(MultiArrayIndex i=0; i<rows; ++i)
+                values[i] = features(i, k);
+            std::sort(values.begin(), values.end());
+            
+            MultiArrayIndex distinct = std::unique(values.begin(), values.end()) - values.begin();
+            ArrayVector<double> & edges = edges_[k];
+            if(distinct <= max_bins_)
+            {
+                for(MultiArrayIndex i=1; i<distinct; ++i)
+                    edges.push_back((values[i-1] + values[i]) / 2.0);
+                continue;
+            }
+            
+            // equal frequency binning: start a new bin when the current one
+            // has received its share of the remaining samples
+            for(MultiArrayIndex i=0; i<rows; ++i)
+                values[i] = features(i, k);
+            std::sort(values.begin(), values.end());
+            MultiArrayIndex binStart = 0;
+            for(MultiArrayIndex i=1; i<rows && (int)edges.size() < max_bins_-1; ++i)
+            {
+                if(values[i] == values[i-1])
+                    continue;
+                double share = double(rows - binStart) / (max_bins_ - edges.size());
+                if(i - binStart >= share)
+                {
+                    edges.push_back((values[i-1] + values[i]) / 2.0);
+                    binStart = i;
+                }
+            }
+        }
+    }
+
+    /** \brief Replace each feature with its bin index.
+     
+        \a binned must have the same shape as \a features, and the 
+        number of columns must equal the one passed to learn().
+     */
+    template <class U, class C1, class C2>
+    void transform(MultiArrayView<2, U, C1> const & features,
+                   MultiArrayView<2, UInt8, C2> binned) const
+    {
+        vigra_precondition(features.shape() == binned.shape(),
+            "FeatureBinning::transform(): shape mismatch.");
+        vigra_precondition(features.shape(1) == columnCount(),
+            "FeatureBinning::transform(): wrong number of columns.");
+        for(MultiArrayIndex k=0; k<features.shape(1); ++k)
+        {
+            ArrayVector<double> const & edges = edges_[k];
+            for(MultiArrayIndex i=0; i<features.shape(0); ++i)
+                binned(i, k) = UInt8(std::upper_bound(edges.begin(), edges.end(), 
+                                                      double(features(i, k))) - edges.begin());
+        }
+    }
+
+    /** \brief Convert the thresholds of a forest learned on binned features
+               such that it can be applied to the original features.
+               
+        The forest must only consist of threshold splits.
+     */
+    template <class RF>
+    void convertThresholds(RF & rf) const
+    {
+        for(unsigned int k=0; k<rf.trees_.size(); ++k)
+        {
+            ArrayVector<Int32> & topology   = rf.trees_[k].topology_;
+            ArrayVector<double> & parameters = rf.trees_[k].parameters_;
+            // a tree starts with two header entries, followed by the nodes in pre-order
+            ArrayVector<Int32> stack(1, 2);
+            while(stack.size() > 0)
+            {
+                Int32 index = stack.back();
+                stack.pop_back();
+                if((topology[index] & LeafNodeTag) == LeafNodeTag)
+                    continue;
+                vigra_precondition(topology[index] == i_ThresholdNode,
+                    "FeatureBinning::convertThresholds(): only threshold splits are supported.");
+                Node<i_ThresholdNode> node(topology, parameters, index);
+                node.threshold() = threshold(node.column(), node.threshold());
+                stack.push_back(node.child(0));
+                stack.push_back(node.child(1));
+            }
+        }
+    }
+
+    /** \brief Threshold in the original feature space that is equivalent to 
+               the threshold \a binThreshold on the bin indices of column \a column.
+               
+        <tt>bin(x) < binThreshold</tt> holds iff <tt>x < threshold(column, binThreshold)</tt>.
+     */
+    double threshold(int column, double binThreshold) const
+    {
+        ArrayVector<double> const & edges = edges_[column];
+        // bin(x) < t  <=>  bin(x) <= ceil(t) - 1  <=>  x < edges[ceil(t) - 1]
+        double b = std::ceil(binThreshold) - 1.0;
+        if(b < 0.0)
+            return -std::numeric_limits<double>::infinity();
+        if(b >= (double)edges.size())
+            return std::numeric_limits<double>::infinity();
+        return edges[(int)b];
+    }
+
+    /** \brief Number of columns passed to learn().
+     */
+    int columnCount() const
+    {
+        return edges_.size();
+    }
+
+    /** \brief Number of bins of column \a column.
+     */
+    int binCount(int column) const
+    {
+        return edges_[column].size() + 1;
+    }
+
+    /** \brief Bin boundaries of column \a column (bin b contains the values
+               between <tt>edges(column)[b-1]</tt> (inclusive) and 
+               <tt>edges(column)[b]</tt> (exclusive)).
+     */
+    ArrayVector<double> const & edges(int column) const
+    {
+        return edges_[column];
+    }
+
+  private:
+    int max_bins_;
+    ArrayVector<ArrayVector<double> > edges_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA_RF_BINNING_HXX
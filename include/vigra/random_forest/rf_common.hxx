@@ -198,6 +198,8 @@ class RandomForestOptions
     int tree_count_;
     int min_split_node_size_;
     bool prepare_online_learning_;
+    int n_threads_;
+    int feature_bins_;
     /*\}*/
 
     typedef ArrayVector<double> double_array;
@@ -357,7 +359,9 @@ class RandomForestOptions
         predict_weighted_(false),
         tree_count_(256),
         min_split_node_size_(1),
-        prepare_online_learning_(false)
+        prepare_online_learning_(false),
+        n_threads_(1),
+        feature_bins_(0)
     {}
 
     /**\brief specify stratification strategy
@@ -498,6 +502,58 @@ class RandomForestOptions
         return *this;
     }
 
+    /**\brief How many threads to use for learning and prediction?
+     *
+     * n is interpreted as in ParallelOptions::numThreads(), i.e. n = -1 
+     * uses all cores, and n = 0 means no threads. If this results in a 
+     * single thread, the trees are learned one after another, and all of 
+     * them draw from the random number generator passed to 
+     * RandomForest::learn(). Otherwise, the trees are distributed dynamically
+     * over the threads, and each tree gets its own random number generator 
+     * seeded from the given one, so that the resulting forest does not depend
+     * on the number of threads (but differs from the sequential one). 
+     * Calls to visit_after_split() and to visit_after_tree() are serialized
+     * by two separate mutexes, and visit_after_tree() is called in the order
+     * in which the trees are finished. Visitors must therefore not depend on 
+     * the order of the trees. The results of the built-in visitors (e.g. 
+     * rf::visitors::OOB_Error) only differ by round-off then.
+     *
+     * RandomForest::predictLabels() and RandomForest::predictProbabilities()
+     * (with the default stopping criterion) distribute blocks of rows over
+     * n threads. Their results do not depend on n. The same holds for the
+     * permutation importance computed by rf::visitors::VariableImportanceVisitor
+     * (columns are processed in parallel) and the OOB statistics of 
+     * rf::visitors::CompleteOOBInfo.
+     *
+     * <br> Default: 1.
+     */
+    RandomForestOptions & n_threads(int n)
+    {
+        n_threads_ = n;
+        return *this;
+    }
+
+    /**\brief Learn on features quantized into at most n bins?
+     *
+     * If n > 0, RandomForest::learn() quantizes each feature into at most
+     * n <= 256 bins (see FeatureBinning), learns the forest on the 
+     * resulting <tt>UInt8</tt> matrix, where the split search uses class 
+     * histograms instead of sorting, and finally converts the split 
+     * thresholds back into the original feature space. This is much faster 
+     * for large training sets. Features with at most n distinct values
+     * give the same tree structure as without binning. Visitors see the 
+     * binned features.
+     *
+     * <br> Default: 0 (no binning)
+     */
+    RandomForestOptions & feature_bins(int n)
+    {
+        vigra_precondition(n == 0 || (n >= 2 && n <= 256),
+            "RandomForestOptions::feature_bins(): n must be 0 or in [2, 256].");
+        feature_bins_ = n;
+        return *this;
+    }
+
     /**\brief Number of examples required for a node to be split.
      *
      *  When the number of examples in a node is below this number,
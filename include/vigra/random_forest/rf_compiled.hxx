@@ -0,0 +1,1081 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2015 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_RF_COMPILED_HXX
+#define VIGRA_RF_COMPILED_HXX
+
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "../config.hxx"
+#include "../sized_int.hxx"
+#include "../multi_array.hxx"
+#include "../array_vector.hxx"
+#include "../matrix.hxx"
+#include "../tinyvector.hxx"
+#include "../threadpool.hxx"
+#include "rf_common.hxx"
+#include "rf_nodeproxy.hxx"
+#include "rf_preprocessing.hxx"
+
+#ifdef _WIN32
+# include "windows.h"
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+#endif
+
+namespace vigra
+{
+
+namespace detail
+{
+
+/* \brief convert a double threshold into the threshold type of a
+ * CompiledRandomForest, rounding up to the next representable value.
+ * Then <tt>x < threshold</tt> gives the same result for the original 
+ * and the converted threshold, provided that x itself is representable 
+ * in the threshold type.
+ */
+template <class T>
+struct RF_ThresholdCast;
+
+template <>
+struct RF_ThresholdCast<double>
+{
+    static double cast(double t)
+    {
+        return t;
+    }
+};
+
+template <>
+struct RF_ThresholdCast<float>
+{
+    static float cast(double t)
+    {
+        float res = static_cast<float>(t);
+        if(res < t)
+            res = std::nextafter(res, std::numeric_limits<float>::infinity());
+        return res;
+    }
+};
+
+/* \brief node of a CompiledRandomForest. For internal nodes, 
+ * child_ is the index of the left child, and the right child
+ * immediately follows it. Leaves point back to themselves: their
+ * threshold is -infinity, so that the comparison always selects
+ * child_ + 1, the leaf's own index. Leaves are thus recognized by 
+ * child_ being smaller than their own index.
+ */
+template <class ThresholdType>
+struct RF_CompiledNode
+{
+    Int32           feature_;
+    ThresholdType   threshold_;
+    Int32           child_;
+
+    RF_CompiledNode(Int32 feature = 0, ThresholdType threshold = ThresholdType(), Int32 child = 0)
+    : feature_(feature),
+      threshold_(threshold),
+      child_(child)
+    {}
+};
+
+/* \brief header of the flat binary representation of a 
+ * CompiledRandomForest. The header is followed by the arrays of 
+ * the forest, each starting at an offset that is a multiple of 8 
+ * bytes. All data are stored in native byte order.
+ */
+struct RF_CompiledHeader
+{
+    char    magic_[8];          // "VIGRACRF"
+    UInt32  version_;
+    UInt32  byte_order_;        // 0x01020304 in the byte order of the writer
+    UInt32  threshold_size_;    // sizeof(ThresholdType)
+    UInt32  node_size_;         // sizeof(RF_CompiledNode<ThresholdType>)
+    UInt64  size_;              // total size in bytes (header included)
+    UInt64  tree_count_;
+    UInt64  node_count_;
+    UInt64  leaf_value_count_;
+    UInt64  ext_param_count_;
+    UInt64  ext_param_offset_;  // serialized ProblemSpec (double)
+    UInt64  roots_offset_;      // Int32 per tree
+    UInt64  depths_offset_;     // Int32 per tree
+    UInt64  nodes_offset_;      // RF_CompiledNode per node
+    UInt64  leaf_index_offset_; // Int32 per node
+    UInt64  leaves_offset_;     // double per leaf value
+
+    static const char * magic()
+    {
+        return "VIGRACRF";
+    }
+
+    static UInt32 currentVersion()
+    {
+        return 1;
+    }
+
+    static UInt32 byteOrderTag()
+    {
+        return 0x01020304;
+    }
+};
+
+/* \brief read-only memory holding the flat representation of a 
+ * CompiledRandomForest. It is shared by all copies of a forest.
+ */
+class RF_CompiledStorage
+{
+  public:
+    RF_CompiledStorage()
+    : data_(0),
+      size_(0)
+    {}
+
+    virtual ~RF_CompiledStorage()
+    {}
+
+    char const * data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+  protected:
+    char const *  data_;
+    std::size_t   size_;
+};
+
+/* \brief storage on the heap (aligned to 8 bytes)
+ */
+class RF_CompiledMemoryStorage
+: public RF_CompiledStorage
+{
+  public:
+    explicit RF_CompiledMemoryStorage(std::size_t size)
+    : buffer_((size + sizeof(UInt64) - 1) / sizeof(UInt64), UInt64(0))
+    {
+        data_ = reinterpret_cast<char const *>(buffer_.data());
+        size_ = size;
+    }
+
+    char * data()
+    {
+        return reinterpret_cast<char *>(buffer_.data());
+    }
+
+  private:
+    ArrayVector<UInt64> buffer_;
+};
+
+/* \brief storage in a read-only memory-mapped file. Processes 
+ * mapping the same file share its pages.
+ */
+class RF_CompiledMappedStorage
+: public RF_CompiledStorage
+{
+  public:
+    explicit RF_CompiledMappedStorage(std::string const & filename)
+    {
+    #ifdef _WIN32
+        file_ = ::CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, 
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        vigra_precondition(file_ != INVALID_HANDLE_VALUE,
+            "CompiledRandomForest::load(): unable to open file '" + filename + "'.");
+        LARGE_INTEGER size;
+        if(!::GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+        {
+            ::CloseHandle(file_);
+            vigra_precondition(false,
+                "CompiledRandomForest::load(): file '" + filename + "' is empty.");
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+        mappedFile_ = ::CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(!mappedFile_)
+        {
+            ::CloseHandle(file_);
+            throw std::runtime_error("CompiledRandomForest::load(): CreateFileMapping() failed.");
+        }
+        data_ = (char const *)::MapViewOfFile(mappedFile_, FILE_MAP_READ, 0, 0, 0);
+        if(!data_)
+        {
+            ::CloseHandle(mappedFile_);
+            ::CloseHandle(file_);
+            throw std::runtime_error("CompiledRandomForest::load(): MapViewOfFile() failed.");
+        }
+    #else
+        int file = ::open(filename.c_str(), O_RDONLY);
+        vigra_precondition(file != -1,
+            "CompiledRandomForest::load(): unable to open file '" + filename + "'.");
+        struct stat info;
+        if(::fstat(file, &info) == -1 || info.st_size == 0)
+        {
+            ::close(file);
+            vigra_precondition(false,
+                "CompiledRandomForest::load(): file '" + filename + "' is empty.");
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        void * data = ::mmap(0, size_, PROT_READ, MAP_SHARED, file, 0);
+        ::close(file); // the mapping remains valid
+        if(data == MAP_FAILED)
+            throw std::runtime_error("CompiledRandomForest::load(): mmap() failed.");
+        data_ = static_cast<char const *>(data);
+    #endif
+    }
+
+    ~RF_CompiledMappedStorage()
+    {
+    #ifdef _WIN32
+        ::UnmapViewOfFile(data_);
+        ::CloseHandle(mappedFile_);
+        ::CloseHandle(file_);
+    #else
+        ::munmap(const_cast<char *>(data_), size_);
+    #endif
+    }
+
+  private:
+    RF_CompiledMappedStorage(RF_CompiledMappedStorage const &);
+    RF_CompiledMappedStorage & operator=(RF_CompiledMappedStorage const &);
+
+  #ifdef _WIN32
+    HANDLE file_, mappedFile_;
+  #endif
+};
+
+template <class CRF, class U, class C1, class T, class C2>
+struct RF_CompiledPredictFunctor;
+
+} // namespace detail
+
+/** \brief Read-only random forest optimized for fast prediction.
+
+    <b>\#include</b> \<vigra/random_forest.hxx\><br>
+    Namespace: vigra
+
+    A trained \ref vigra::RandomForest stores each tree in a generic
+    node format that supports all split and leaf types. Prediction has
+    to decode this format at every node, which dominates the inference
+    time. A CompiledRandomForest converts the trees of a trained forest into 
+    a compact layout tailored to prediction:
+    
+    <ul>
+    <li> All nodes of all trees reside in one contiguous array. Each tree 
+         is stored in breadth-first order, and the two children of a node 
+         are adjacent, so that a node only holds a feature index 
+         (<tt>Int32</tt>), a threshold (<tt>ThresholdType</tt>), and the 
+         index of its left child.
+    <li> The class probabilities of the leaves reside in a separate table, 
+         already multiplied with the leaf weight when the forest was learned
+         with <tt>RandomForestOptions::predict_weighted()</tt>.
+    <li> Traversal needs no type dispatch and computes the next node
+         index arithmetically from the comparison result. Since leaves
+         point back to themselves, a group of rows can be pushed through 
+         a tree in lockstep for as many steps as the tree is deep, without
+         any data-dependent branches. This hides the latency of the
+         node lookups, which otherwise dominates prediction time.
+    <li> The rows are processed in blocks, each tree being applied to all 
+         rows of a block before the next tree is considered. Blocks
+         are distributed over <tt>n_threads()</tt> threads.
+    </ul>
+    
+    The default <tt>ThresholdType = float</tt> halves the size of the nodes.
+    The thresholds are rounded up to the next <tt>float</tt>, so that
+    predictions remain exactly the same as those of the original forest
+    whenever the features are exactly representable as <tt>float</tt> (e.g.
+    when the forest was learned and is applied on <tt>float</tt> data). Use
+    <tt>ThresholdType = double</tt> to get identical results for
+    arbitrary <tt>double</tt> features.
+    
+    A compiled forest can be saved in a flat binary file with save(). 
+    load() maps such a file into memory (read-only) and uses its contents 
+    directly, without parsing or copying the arrays. Loading is thus 
+    fast (only the indices are validated), and processes loading the same file share 
+    the physical memory. The file is written in native byte order and 
+    can only be loaded by a CompiledRandomForest with the same 
+    <tt>ThresholdType</tt> on a platform with the same byte order. Copies
+    of a CompiledRandomForest share the (immutable) data.
+
+    Only forests consisting of threshold splits (i.e. the default \ref vigra::GiniSplit
+    and related axis-parallel splits) and constant probability leaves 
+    can be compiled.
+
+    <b>Usage:</b>
+
+    \code
+    RandomForest<int> rf;
+    rf.learn(train_features, train_labels);
+
+    CompiledRandomForest<int> crf(rf);
+    crf.n_threads(-1);  // use all cores
+    crf.predictLabels(test_features, test_labels);
+
+    crf.save("forest.crf");
+    ...
+    // e.g. in a worker process
+    CompiledRandomForest<int> crf2;
+    crf2.load("forest.crf");
+    \endcode
+*/
+namespace detail {
+
+template <class CRF, class U, class C1, class T, class C2>
+struct RF_CompiledPredictFunctor;
+
+} // namespace detail
+
+namespace rf_blockwise_detail {
+
+    // (defined in random_forest_blockwise.hxx)
+template <class RF, unsigned int N, class U, class S1, class T, class S2>
+void
+predictTile(RF const & rf,
+            MultiArrayView<N, U, S1> const & features,
+            MultiArrayView<N, T, S2> & prob,
+            MultiArrayIndex begin, MultiArrayIndex end);
+
+} // namespace rf_blockwise_detail
+
+template <class LabelType = double, class ThresholdType = float>
+class CompiledRandomForest
+{
+  public:
+    typedef LabelType                                   LabelT;
+    typedef ThresholdType                               ThresholdT;
+    typedef detail::RF_CompiledNode<ThresholdType>      NodeType;
+
+    /* number of rows that are passed through the trees together
+     */
+    static const int predictionBlockSize = 128;
+
+    /* number of rows that traverse a tree in lockstep
+     */
+    static const int traversalGroupSize = 16;
+
+    // the arrays point into storage_
+    VIGRA_SHARED_PTR<detail::RF_CompiledStorage> storage_;
+    NodeType const *            nodes_;
+    Int32 const *               leaf_index_;  // per node, -1 for internal nodes
+    Int32 const *               roots_;
+    Int32 const *               depths_;      // number of internal nodes on the longest path
+    double const *              leaves_;
+    int                         tree_count_;
+    int                         node_count_;
+    int                         leaf_value_count_;
+    ProblemSpec<LabelType>      ext_param_;
+    int                         n_threads_;
+
+    /** \brief Create an empty forest (use compile() or load() to fill it).
+     */
+    CompiledRandomForest()
+    : nodes_(0), leaf_index_(0), roots_(0), depths_(0), leaves_(0),
+      tree_count_(0), node_count_(0), leaf_value_count_(0),
+      n_threads_(1)
+    {}
+
+    /** \brief Compile the given forest.
+    
+        The number of threads is initialized with <tt>rf.options().n_threads_</tt>.
+     */
+    template <class RF>
+    explicit CompiledRandomForest(RF const & rf)
+    : nodes_(0), leaf_index_(0), roots_(0), depths_(0), leaves_(0),
+      tree_count_(0), node_count_(0), leaf_value_count_(0),
+      n_threads_(1)
+    {
+        compile(rf);
+    }
+
+    /** \brief Replace the contents of this forest with the compiled 
+               version of \a rf.
+     */
+    template <class RF>
+    void compile(RF const & rf);
+
+    /** \brief Write the forest into a flat binary file.
+     */
+    void save(std::string const & filename) const;
+
+    /** \brief Replace the contents of this forest with the forest
+               stored in the given file (written by save()).
+
+        When \a memoryMap is <tt>true</tt> (default), the file is mapped
+        into memory, and the forest uses the mapped data directly. 
+        Otherwise, the file is read into memory. The number of threads
+        is not stored in the file and remains unchanged. All node, child, 
+        and leaf indices are checked once at load time (in time linear in 
+        the number of nodes), and a <tt>PreconditionViolation</tt> is thrown 
+        if the file is corrupted.
+     */
+    void load(std::string const & filename, bool memoryMap = true);
+
+    /** \brief Set the number of threads used for prediction.
+    
+        \a n is interpreted as in ParallelOptions::numThreads(), i.e.
+        n = -1 uses all cores. The result does not depend on \a n.
+     */
+    CompiledRandomForest & n_threads(int n)
+    {
+        n_threads_ = n;
+        return *this;
+    }
+
+    /** \brief Number of threads used for prediction.
+     */
+    int n_threads() const
+    {
+        return n_threads_;
+    }
+
+    int tree_count() const
+    {
+        return tree_count_;
+    }
+
+    int class_count() const
+    {
+        return ext_param_.class_count_;
+    }
+
+    int feature_count() const
+    {
+        return ext_param_.column_count_;
+    }
+
+    /** \brief Total number of nodes (including leaves) in all trees.
+     */
+    int node_count() const
+    {
+        return node_count_;
+    }
+
+    /** \brief Total number of leaves in all trees.
+     */
+    int leaf_count() const
+    {
+        return class_count() == 0
+                   ? 0
+                   : leaf_value_count_ / class_count();
+    }
+
+    /** \brief Index of the leaf reached by \a row in tree \a tree.
+    
+        \a row must point to the first feature, and consecutive 
+        features are \a stride elements apart.
+     */
+    template <class U>
+    Int32 leafIndex(int tree, U const * row, MultiArrayIndex stride) const
+    {
+        NodeType const * nodes = nodes_;
+        Int32 n = roots_[tree];
+        while(nodes[n].child_ > n)
+        {
+            NodeType const & node = nodes[n];
+            // NaN goes to the right, as in the original forest
+            n = node.child_ + !(row[node.feature_*stride] < node.threshold_);
+        }
+        return leaf_index_[n];
+    }
+
+    /** \brief Weighted class votes of leaf \a leaf 
+               (<tt>class_count()</tt> consecutive values).
+     */
+    double const * leafValues(Int32 leaf) const
+    {
+        return leaves_ + leaf*class_count();
+    }
+
+    /** \brief predict the class probabilities for multiple rows
+    
+        \a features must have <tt>feature_count()</tt> or more columns, 
+        and \a prob must have one row per feature row and 
+        <tt>class_count()</tt> columns. Rows containing NaN get 
+        zero probability.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilities(MultiArrayView<2, U, C1> const & features,
+                              MultiArrayView<2, T, C2>         prob) const;
+
+    /** \brief predict the labels of multiple rows
+
+        \a labels must have one row per feature row. If a row contains 
+        NaN, a precondition exception is thrown.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictLabels(MultiArrayView<2, U, C1> const & features,
+                       MultiArrayView<2, T, C2>         labels) const
+    {
+        predictLabelsImpl(features, labels, true, LabelType());
+    }
+
+    /** \brief predict the labels of multiple rows, returning
+               \a nanLabel for rows that contain NaN.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictLabels(MultiArrayView<2, U, C1> const & features,
+                       MultiArrayView<2, T, C2>         labels,
+                       LabelType                        nanLabel) const
+    {
+        predictLabelsImpl(features, labels, false, nanLabel);
+    }
+
+    /** \brief predict the label of a single row
+     */
+    template <class U, class C>
+    LabelType predictLabel(MultiArrayView<2, U, C> const & features) const
+    {
+        vigra_precondition(rowCount(features) == 1,
+            "CompiledRandomForest::predictLabel(): Feature matrix must have a single row.");
+        MultiArray<2, double> prob(Shape2(1, class_count()));
+        predictProbabilities(features, prob);
+        LabelType d;
+        ext_param_.to_classlabel(argMax(prob), d);
+        return d;
+    }
+
+  private:
+    template <class, class, class, class, class>
+    friend struct detail::RF_CompiledPredictFunctor;
+    template <class RF, unsigned int N, class U, class S1, class T, class S2>
+    friend void rf_blockwise_detail::predictTile(RF const &,
+                                                 MultiArrayView<N, U, S1> const &,
+                                                 MultiArrayView<N, T, S2> &,
+                                                 MultiArrayIndex, MultiArrayIndex);
+
+    /* compute the probabilities of a block of rows. valid[row] 
+     * is set to false for rows containing NaN.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilitiesBlock(MultiArrayView<2, U, C1> const & features,
+                                   MultiArrayView<2, T, C2>         prob,
+                                   ArrayVector<bool> &              valid) const;
+
+    // store the given arrays in a new flat memory block and attach to it
+    void assign(ProblemSpec<LabelType> const & ext_param,
+                ArrayVector<Int32> const & roots,
+                ArrayVector<Int32> const & depths,
+                ArrayVector<NodeType> const & nodes,
+                ArrayVector<Int32> const & leaf_index,
+                ArrayVector<double> const & leaves);
+
+    // check the header of the given storage and set the array pointers
+    void attach(VIGRA_SHARED_PTR<detail::RF_CompiledStorage> const & storage);
+
+    // throw if any index stored in the forest is out of range
+    static void validate(detail::RF_CompiledHeader const & header,
+                         ProblemSpec<LabelType> const & spec,
+                         Int32 const * roots, Int32 const * depths,
+                         NodeType const * nodes, Int32 const * leaf_index);
+
+    template <class U, class C1, class T, class C2>
+    void checkShapes(MultiArrayView<2, U, C1> const & features,
+                     MultiArrayView<2, T, C2> const & out,
+                     MultiArrayIndex                  outColumns) const
+    {
+        vigra_precondition(tree_count() > 0,
+            "CompiledRandomForest::predict...(): Forest is empty.");
+        vigra_precondition(rowCount(features) == rowCount(out),
+            "CompiledRandomForest::predict...(): Feature matrix and result matrix size mismatch.");
+        vigra_precondition(columnCount(features) >= feature_count(),
+            "CompiledRandomForest::predict...(): Too few columns in feature matrix.");
+        vigra_precondition(columnCount(out) == outColumns,
+            "CompiledRandomForest::predict...(): Result matrix has wrong number of columns.");
+    }
+
+    template <class U, class C1, class T, class C2>
+    void predictLabelsImpl(MultiArrayView<2, U, C1> const & features,
+                           MultiArrayView<2, T, C2>         labels,
+                           bool nanIsError, LabelType nanLabel) const;
+};
+
+template <class LabelType, class ThresholdType>
+template <class RF>
+void CompiledRandomForest<LabelType, ThresholdType>::compile(RF const & rf)
+{
+    typedef Int32 TreeInt;
+
+    ArrayVector<NodeType>   nodes;
+    ArrayVector<Int32>      leafIndex, roots, depths;
+    ArrayVector<double>     leaves;
+    n_threads_ = rf.options_.n_threads_;
+
+    int classCount = rf.ext_param_.class_count_,
+        weighted = rf.options_.predict_weighted_;
+
+    for(int k=0; k<(int)rf.trees_.size(); ++k)
+    {
+        ArrayVector<TreeInt> const & topology   = rf.trees_[k].topology_;
+        ArrayVector<double>  const & parameters = rf.trees_[k].parameters_;
+
+        // breadth-first traversal, the queue holds 
+        // (index in topology, index in nodes, depth)
+        std::deque<TinyVector<Int32, 3> > queue;
+        roots.push_back(nodes.size());
+        depths.push_back(0);
+        nodes.push_back(NodeType());
+        leafIndex.push_back(-1);
+        queue.push_back(TinyVector<Int32, 3>(2, roots.back(), 0));
+        while(!queue.empty())
+        {
+            TreeInt index = queue.front()[0];
+            Int32 slot    = queue.front()[1],
+                  depth   = queue.front()[2];
+            queue.pop_front();
+            switch(topology[index])
+            {
+                case i_ThresholdNode:
+                {
+                    Node<i_ThresholdNode> node(topology, parameters, index);
+                    Int32 child = nodes.size();
+                    nodes[slot] = NodeType(node.column(), 
+                                       detail::RF_ThresholdCast<ThresholdType>::cast(node.threshold()),
+                                       child);
+                    nodes.push_back(NodeType());
+                    nodes.push_back(NodeType());
+                    leafIndex.push_back(-1);
+                    leafIndex.push_back(-1);
+                    queue.push_back(TinyVector<Int32, 3>(node.child(0), child, depth+1));
+                    queue.push_back(TinyVector<Int32, 3>(node.child(1), child+1, depth+1));
+                    depths.back() = std::max(depths.back(), depth+1);
+                    break;
+                }
+                case e_ConstProbNode:
+                {
+                    Node<e_ConstProbNode> node(topology, parameters, index);
+                    ArrayVector<double>::const_iterator weights = node.prob_begin();
+                    nodes[slot] = NodeType(0, -std::numeric_limits<ThresholdType>::infinity(), slot-1);
+                    leafIndex[slot] = leaves.size() / classCount;
+                    // same expression as in RandomForest::predictProbabilities()
+                    for(int l=0; l<classCount; ++l)
+                        leaves.push_back(weights[l] * (weighted * (*(weights-1))
+                                                      + (1-weighted)));
+                    break;
+                }
+                default:
+                    vigra_precondition(false,
+                        "CompiledRandomForest::compile(): only threshold splits and "
+                        "constant probability leaves are supported.");
+            }
+        }
+    }
+    assign(rf.ext_param_, roots, depths, nodes, leafIndex, leaves);
+}
+
+namespace detail {
+
+inline UInt64 rf_compiledAlign(UInt64 offset)
+{
+    return (offset + 7) & ~UInt64(7);
+}
+
+} // namespace detail
+
+template <class LabelType, class ThresholdType>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::assign(ProblemSpec<LabelType> const & ext_param,
+             ArrayVector<Int32> const & roots,
+             ArrayVector<Int32> const & depths,
+             ArrayVector<NodeType> const & nodes,
+             ArrayVector<Int32> const & leaf_index,
+             ArrayVector<double> const & leaves)
+{
+    detail::RF_CompiledHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic_, detail::RF_CompiledHeader::magic(), sizeof(header.magic_));
+    header.version_           = detail::RF_CompiledHeader::currentVersion();
+    header.byte_order_        = detail::RF_CompiledHeader::byteOrderTag();
+    header.threshold_size_    = sizeof(ThresholdType);
+    header.node_size_         = sizeof(NodeType);
+    header.tree_count_        = roots.size();
+    header.node_count_        = nodes.size();
+    header.leaf_value_count_  = leaves.size();
+    header.ext_param_count_   = ext_param.serialized_size();
+    header.ext_param_offset_  = detail::rf_compiledAlign(sizeof(header));
+    header.roots_offset_      = detail::rf_compiledAlign(header.ext_param_offset_ 
+                                                  + header.ext_param_count_*sizeof(double));
+    header.depths_offset_     = detail::rf_compiledAlign(header.roots_offset_ 
+                                                  + header.tree_count_*sizeof(Int32));
+    header.nodes_offset_      = detail::rf_compiledAlign(header.depths_offset_ 
+                                                  + header.tree_count_*sizeof(Int32));
+    header.leaf_index_offset_ = detail::rf_compiledAlign(header.nodes_offset_ 
+                                                  + header.node_count_*sizeof(NodeType));
+    header.leaves_offset_     = detail::rf_compiledAlign(header.leaf_index_offset_ 
+                                                  + header.node_count_*sizeof(Int32));
+    header.size_              = header.leaves_offset_ + header.leaf_value_count_*sizeof(double);
+
+    detail::RF_CompiledMemoryStorage * storage = 
+                      new detail::RF_CompiledMemoryStorage(header.size_);
+    VIGRA_SHARED_PTR<detail::RF_CompiledStorage> holder(storage);
+    char * data = storage->data();
+    std::memcpy(data, &header, sizeof(header));
+    ext_param.serialize(reinterpret_cast<double *>(data + header.ext_param_offset_),
+                        reinterpret_cast<double *>(data + header.ext_param_offset_) 
+                                                          + header.ext_param_count_);
+    std::copy(roots.begin(), roots.end(), 
+              reinterpret_cast<Int32 *>(data + header.roots_offset_));
+    std::copy(depths.begin(), depths.end(), 
+              reinterpret_cast<Int32 *>(data + header.depths_offset_));
+    std::copy(nodes.begin(), nodes.end(), 
+              reinterpret_cast<NodeType *>(data + header.nodes_offset_));
+    std::copy(leaf_index.begin(), leaf_index.end(), 
+              reinterpret_cast<Int32 *>(data + header.leaf_index_offset_));
+    std::copy(leaves.begin(), leaves.end(), 
+              reinterpret_cast<double *>(data + header.leaves_offset_));
+    attach(holder);
+}
+
+template <class LabelType, class ThresholdType>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::attach(VIGRA_SHARED_PTR<detail::RF_CompiledStorage> const & storage)
+{
+    char const * data = storage->data();
+    std::size_t size  = storage->size();
+    detail::RF_CompiledHeader header;
+    vigra_precondition(size >= sizeof(header),
+        "CompiledRandomForest::load(): file is too small.");
+    std::memcpy(&header, data, sizeof(header));
+    vigra_precondition(std::memcmp(header.magic_, detail::RF_CompiledHeader::magic(), 
+                                   sizeof(header.magic_)) == 0,
+        "CompiledRandomForest::load(): not a compiled random forest file.");
+    vigra_precondition(header.version_ == detail::RF_CompiledHeader::currentVersion(),
+        "CompiledRandomForest::load(): unsupported file version.");
+    vigra_precondition(header.byte_order_ == detail::RF_CompiledHeader::byteOrderTag(),
+        "CompiledRandomForest::load(): file was written with a different byte order.");
+    vigra_precondition(header.threshold_size_ == sizeof(ThresholdType) &&
+                       header.node_size_ == sizeof(NodeType),
+        "CompiledRandomForest::load(): file was written with a different ThresholdType.");
+    vigra_precondition(header.size_ == size &&
+                       header.ext_param_offset_  >= sizeof(header) &&
+                       header.roots_offset_      >= header.ext_param_offset_ + header.ext_param_count_*sizeof(double) &&
+                       header.depths_offset_     >= header.roots_offset_ + header.tree_count_*sizeof(Int32) &&
+                       header.nodes_offset_      >= header.depths_offset_ + header.tree_count_*sizeof(Int32) &&
+                       header.leaf_index_offset_ >= header.nodes_offset_ + header.node_count_*sizeof(NodeType) &&
+                       header.leaves_offset_     >= header.leaf_index_offset_ + header.node_count_*sizeof(Int32) &&
+                       header.size_              >= header.leaves_offset_ + header.leaf_value_count_*sizeof(double) &&
+                       (header.ext_param_offset_ | header.roots_offset_ | header.depths_offset_ | 
+                        header.nodes_offset_ | header.leaf_index_offset_ | header.leaves_offset_) % 8 == 0,
+        "CompiledRandomForest::load(): file is corrupted.");
+
+    double const * ext_param = reinterpret_cast<double const *>(data + header.ext_param_offset_);
+    ProblemSpec<LabelType> spec;
+    spec.unserialize(ext_param, ext_param + header.ext_param_count_);
+
+    Int32 const    * roots      = reinterpret_cast<Int32 const *>(data + header.roots_offset_);
+    Int32 const    * depths     = reinterpret_cast<Int32 const *>(data + header.depths_offset_);
+    NodeType const * nodes      = reinterpret_cast<NodeType const *>(data + header.nodes_offset_);
+    Int32 const    * leaf_index = reinterpret_cast<Int32 const *>(data + header.leaf_index_offset_);
+    validate(header, spec, roots, depths, nodes, leaf_index);
+
+    storage_          = storage;
+    ext_param_        = spec;
+    tree_count_       = static_cast<int>(header.tree_count_);
+    node_count_       = static_cast<int>(header.node_count_);
+    leaf_value_count_ = static_cast<int>(header.leaf_value_count_);
+    roots_      = roots;
+    depths_     = depths;
+    nodes_      = nodes;
+    leaf_index_ = leaf_index;
+    leaves_     = reinterpret_cast<double const *>(data + header.leaves_offset_);
+}
+
+template <class LabelType, class ThresholdType>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::validate(detail::RF_CompiledHeader const & header,
+               ProblemSpec<LabelType> const & spec,
+               Int32 const * roots, Int32 const * depths,
+               NodeType const * nodes, Int32 const * leaf_index)
+{
+    // prediction follows the indices stored in the file without further 
+    // checks, so every node must be reachable from exactly one root, and
+    // all indices must be in range
+    vigra_precondition(header.tree_count_ <= (UInt64)NumericTraits<Int32>::max() &&
+                       header.node_count_ <= (UInt64)NumericTraits<Int32>::max() - 1 &&
+                       header.leaf_value_count_ <= (UInt64)NumericTraits<Int32>::max() &&
+                       spec.class_count_ > 0 && spec.column_count_ >= 0 &&
+                       header.leaf_value_count_ % spec.class_count_ == 0,
+        "CompiledRandomForest::load(): file is corrupted (invalid array sizes).");
+
+    Int32 nodeCount = static_cast<Int32>(header.node_count_),
+          leafCount = static_cast<Int32>(header.leaf_value_count_ / spec.class_count_);
+    ArrayVector<UInt8> visited(nodeCount, 0);
+    ArrayVector<TinyVector<Int32, 2> > stack;   // (node index, depth)
+    for(UInt64 k=0; k<header.tree_count_; ++k)
+    {
+        vigra_precondition(roots[k] >= 0 && roots[k] < nodeCount,
+            "CompiledRandomForest::load(): file is corrupted (root index out of range).");
+        Int32 maxDepth = 0;
+        stack.push_back(TinyVector<Int32, 2>(roots[k], 0));
+        while(stack.size() > 0)
+        {
+            Int32 n     = stack.back()[0],
+                  depth = stack.back()[1];
+            stack.pop_back();
+            NodeType const & node = nodes[n];
+            vigra_precondition(!visited[n],
+                "CompiledRandomForest::load(): file is corrupted (node reached twice).");
+            visited[n] = 1;
+            vigra_precondition(node.feature_ >= 0 && node.feature_ < spec.column_count_,
+                "CompiledRandomForest::load(): file is corrupted (feature index out of range).");
+            if(node.child_ > n)
+            {
+                vigra_precondition(node.child_ < nodeCount - 1,
+                    "CompiledRandomForest::load(): file is corrupted (child index out of range).");
+                stack.push_back(TinyVector<Int32, 2>(node.child_, depth+1));
+                stack.push_back(TinyVector<Int32, 2>(node.child_+1, depth+1));
+                maxDepth = std::max(maxDepth, depth+1);
+            }
+            else
+            {
+                // a leaf must select itself in every comparison
+                vigra_precondition(node.child_ == n - 1 &&
+                                   node.threshold_ == -std::numeric_limits<ThresholdType>::infinity(),
+                    "CompiledRandomForest::load(): file is corrupted (invalid leaf node).");
+                vigra_precondition(leaf_index[n] >= 0 && leaf_index[n] < leafCount,
+                    "CompiledRandomForest::load(): file is corrupted (leaf index out of range).");
+            }
+        }
+        // the lockstep traversal in predictProbabilities() takes exactly depths[k] steps
+        vigra_precondition(depths[k] == maxDepth,
+            "CompiledRandomForest::load(): file is corrupted (wrong tree depth).");
+    }
+}
+
+template <class LabelType, class ThresholdType>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::save(std::string const & filename) const
+{
+    vigra_precondition(storage_.get() != 0,
+        "CompiledRandomForest::save(): Forest is empty.");
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    vigra_precondition(out.good(),
+        "CompiledRandomForest::save(): unable to open file '" + filename + "'.");
+    out.write(storage_->data(), storage_->size());
+    out.close();
+    vigra_postcondition(!out.fail(),
+        "CompiledRandomForest::save(): write to file '" + filename + "' failed.");
+}
+
+template <class LabelType, class ThresholdType>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::load(std::string const & filename, bool memoryMap)
+{
+    if(memoryMap)
+    {
+        attach(VIGRA_SHARED_PTR<detail::RF_CompiledStorage>(
+                          new detail::RF_CompiledMappedStorage(filename)));
+        return;
+    }
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    vigra_precondition(in.good(),
+        "CompiledRandomForest::load(): unable to open file '" + filename + "'.");
+    in.seekg(0, std::ios::end);
+    std::size_t size = static_cast<std::size_t>(in.tellg());
+    in.seekg(0, std::ios::beg);
+    detail::RF_CompiledMemoryStorage * storage = new detail::RF_CompiledMemoryStorage(size);
+    VIGRA_SHARED_PTR<detail::RF_CompiledStorage> holder(storage);
+    in.read(storage->data(), size);
+    vigra_precondition(!in.fail(),
+        "CompiledRandomForest::load(): read from file '" + filename + "' failed.");
+    attach(holder);
+}
+
+template <class LabelType, class ThresholdType>
+template <class U, class C1, class T, class C2>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::predictProbabilitiesBlock(MultiArrayView<2, U, C1> const & features,
+                                MultiArrayView<2, T, C2>         prob,
+                                ArrayVector<bool> &              valid) const
+{
+    int rows = rowCount(features),
+        classCount = class_count();
+    MultiArrayIndex stride = features.stride(1);
+    prob.init(NumericTraits<T>::zero());
+    
+    for(int row=0; row < rows; ++row)
+        valid[row] = !detail::contains_nan(rowVector(features, row));
+
+    ArrayVector<double> totalWeight(rows, 0.0);
+    NodeType const * nodes = nodes_;
+    U const * rowPtr[traversalGroupSize];
+    Int32 n[traversalGroupSize];
+    for(int k=0; k<tree_count(); ++k)
+    {
+        for(int first=0; first < rows; first += traversalGroupSize)
+        {
+            int count = std::min(int(traversalGroupSize), rows - first);
+            for(int g=0; g<count; ++g)
+            {
+                rowPtr[g] = &features(first+g, 0);
+                n[g] = roots_[k];
+            }
+            // the rows traverse the tree in lockstep, rows that have 
+            // reached a leaf stay there
+            for(int d=0; d<depths_[k]; ++d)
+            {
+                for(int g=0; g<count; ++g)
+                {
+                    NodeType const & node = nodes[n[g]];
+                    n[g] = node.child_ + !(rowPtr[g][node.feature_*stride] < node.threshold_);
+                }
+            }
+            for(int g=0; g<count; ++g)
+            {
+                int row = first + g;
+                if(!valid[row])
+                    continue;
+                double const * weights = leafValues(leaf_index_[n[g]]);
+                for(int l=0; l<classCount; ++l)
+                {
+                    prob(row, l) += static_cast<T>(weights[l]);
+                    totalWeight[row] += weights[l];
+                }
+            }
+        }
+    }
+    
+    for(int row=0; row < rows; ++row)
+    {
+        if(!valid[row])
+            continue;
+        for(int l=0; l<classCount; ++l)
+            prob(row, l) /= detail::RequiresExplicitCast<T>::cast(totalWeight[row]);
+    }
+}
+
+namespace detail {
+
+/* \brief predict one block of rows with a CompiledRandomForest. If
+ * labels_ is true, the result array receives labels, otherwise 
+ * probabilities.
+ */
+template <class CRF, class U, class C1, class T, class C2>
+struct RF_CompiledPredictFunctor
+{
+    typedef typename CRF::LabelT LabelType;
+
+    CRF const &                         rf_;
+    MultiArrayView<2, U, C1> const &    features_;
+    MultiArrayView<2, T, C2> &          result_;
+    bool                                labels_;
+    bool                                nan_is_error_;
+    LabelType                           nan_label_;
+
+    RF_CompiledPredictFunctor(CRF const & rf,
+                              MultiArrayView<2, U, C1> const & features,
+                              MultiArrayView<2, T, C2> & result,
+                              bool labels, bool nan_is_error = true,
+                              LabelType nan_label = LabelType())
+    : rf_(rf), features_(features), result_(result), labels_(labels),
+      nan_is_error_(nan_is_error), nan_label_(nan_label)
+    {}
+
+    void operator()(int /* thread_id */, MultiArrayIndex block)
+    {
+        MultiArrayIndex begin = block*CRF::predictionBlockSize,
+                        end   = std::min<MultiArrayIndex>(begin + CRF::predictionBlockSize, 
+                                                          rowCount(features_));
+        MultiArrayView<2, U, C1> features = 
+            features_.subarray(Shape2(begin, 0), Shape2(end, columnCount(features_)));
+        ArrayVector<bool> valid(end - begin);
+        if(!labels_)
+        {
+            rf_.predictProbabilitiesBlock(features,
+                         result_.subarray(Shape2(begin, 0), Shape2(end, columnCount(result_))),
+                         valid);
+            return;
+        }
+        MultiArray<2, double> prob(Shape2(end - begin, rf_.class_count()));
+        rf_.predictProbabilitiesBlock(features, prob, valid);
+        for(MultiArrayIndex row = 0; row < end - begin; ++row)
+        {
+            if(!valid[row])
+            {
+                vigra_precondition(!nan_is_error_,
+                    "CompiledRandomForest::predictLabels(): NaN in feature matrix.");
+                result_(begin + row, 0) = nan_label_;
+                continue;
+            }
+            LabelType d;
+            rf_.ext_param_.to_classlabel(argMax(rowVector(prob, row)), d);
+            result_(begin + row, 0) = RequiresExplicitCast<T>::cast(d);
+        }
+    }
+};
+
+} // namespace detail
+
+template <class LabelType, class ThresholdType>
+template <class U, class C1, class T, class C2>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::predictProbabilities(MultiArrayView<2, U, C1> const & features,
+                           MultiArrayView<2, T, C2>         prob) const
+{
+    checkShapes(features, prob, class_count());
+    MultiArrayIndex blockCount = (rowCount(features) + predictionBlockSize - 1) / predictionBlockSize;
+    parallel_foreach(ParallelOptions().numThreads(n_threads_), blockCount,
+        detail::RF_CompiledPredictFunctor<CompiledRandomForest, U, C1, T, C2>(
+                                                    *this, features, prob, false));
+}
+
+template <class LabelType, class ThresholdType>
+template <class U, class C1, class T, class C2>
+void CompiledRandomForest<LabelType, ThresholdType>
+    ::predictLabelsImpl(MultiArrayView<2, U, C1> const & features,
+                        MultiArrayView<2, T, C2>         labels,
+                        bool nanIsError, LabelType nanLabel) const
+{
+    checkShapes(features, labels, 1);
+    MultiArrayIndex blockCount = (rowCount(features) + predictionBlockSize - 1) / predictionBlockSize;
+    parallel_foreach(ParallelOptions().numThreads(n_threads_), blockCount,
+        detail::RF_CompiledPredictFunctor<CompiledRandomForest, U, C1, T, C2>(
+                                    *this, features, labels, true, nanIsError, nanLabel));
+}
+
+} // namespace vigra
+
+#endif // VIGRA_RF_COMPILED_HXX
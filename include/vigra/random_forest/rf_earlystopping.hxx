@@ -257,7 +257,7 @@ public:
         }
         else
         {
-            if(prob[argMax(prob)] > proportion_ * SB::tree_count_)
+            if(margin > proportion_ * SB::tree_count_)
             {
                 depths.push_back(double(k+1)/double(SB::tree_count_));
                 return true;
@@ -268,6 +268,83 @@ public:
 };
 
 
+/** Stop predicting as soon as the remaining trees can no longer change the
+ *  predicted label.
+ *
+ *  After each tree, the margin between the votes of the leading and the second 
+ *  class is compared with the maximal number of votes the remaining trees 
+ *  can cast (one per tree for unweighted voting, msample_ per tree for weighted 
+ *  voting). With the default proportion = 1.0, prediction stops when the 
+ *  margin exceeds this bound, so that the resulting label is guaranteed to 
+ *  be the same as when all trees are used (only the probabilities differ). 
+ *  A proportion < 1 trades accuracy for speed: prediction stops when the margin 
+ *  exceeds that fraction of the remaining votes, i.e. the label is considered 
+ *  stable if the remaining trees are not expected to vote almost unanimously 
+ *  against the leading class. At least min_tree_count trees are always evaluated.
+ *  
+ *  For each predicted row (except those containing NaN), the fraction of
+ *  trees that was evaluated is appended to <tt>depths</tt>, so that
+ *  <tt>depths[i]*tree_count</tt> is the number of trees used.
+ */
+class StopIfCertain : public StopBase
+{
+public:
+    double proportion_;
+    int min_tree_count_;
+    typedef StopBase SB;
+    ArrayVector<double> depths;
+
+    /** Constructor
+     * \param proportion fraction of the remaining votes that the margin 
+     *                   must exceed (1.0: the label is certain).
+     * \param min_tree_count minimal number of trees to be evaluated.
+     */
+    StopIfCertain(double proportion = 1.0, int min_tree_count = 1)
+    :
+        proportion_(proportion),
+        min_tree_count_(min_tree_count)
+    {
+        vigra_precondition(proportion >= 0.0 && proportion <= 1.0,
+            "StopIfCertain(): proportion must be in [0, 1].");
+    }
+
+    template<class WeightIter, class T, class C>
+    bool after_prediction(WeightIter,  int k, MultiArrayView<2, T, C> const & prob, double /* totalCt */)
+    {
+        if(k == SB::tree_count_ -1)
+        {
+                depths.push_back(double(k+1)/double(SB::tree_count_));
+                return false;
+        }
+        if(k+1 < min_tree_count_)
+            return false;
+
+        double first = 0.0, second = 0.0;
+        for(MultiArrayIndex l=0; l<prob.size(); ++l)
+        {
+            if(prob[l] > first)
+            {
+                second = first;
+                first = prob[l];
+            }
+            else if(prob[l] > second)
+            {
+                second = prob[l];
+            }
+        }
+        double remaining = SB::tree_count_ - k - 1;
+        if(SB::is_weighted_)
+            remaining *= SB::ext_param_.actual_msample_;
+        if(first - second > proportion_ * remaining)
+        {
+            depths.push_back(double(k+1)/double(SB::tree_count_));
+            return true;
+        }
+        return false;
+    }
+};
+
+
 /**Probabilistic Stopping criterion (binomial test)
  *
  * Can only be used in a two class setting
@@ -149,6 +149,29 @@ namespace detail
                 return true;
          return false;
     }
+
+    enum NonFiniteValue { AllFinite, ContainsNaN, ContainsInf };
+
+    /* Checks for NaNs and Infs in a single pass over the data. The array
+     * is traversed in memory order, so that large (possibly strided or
+     * memory-mapped) feature matrices are read only once and sequentially.
+     */
+    template<unsigned int N, class T, class C>
+    NonFiniteValue find_non_finite(MultiArrayView<N, T, C> const & in)
+    {
+        typedef typename MultiArrayView<N, T, StridedArrayTag>::const_iterator Iter;
+        bool has_inf = std::numeric_limits<T>::has_infinity;
+        MultiArrayView<N, T, StridedArrayTag> const view = in.permuteStridesAscending();
+        Iter i = view.begin(), end = view.end();
+        for(; i != end; ++i)
+        {
+            if(isnan(NumericTraits<T>::toRealPromote(*i)))
+                return ContainsNaN;
+            if(has_inf && abs(*i) == std::numeric_limits<T>::infinity())
+                return ContainsInf;
+        }
+        return AllFinite;
+    }
 } // namespace detail
 
 
@@ -157,6 +180,9 @@ namespace detail
  *
  * This class converts the labels int Integral labels which are used by the 
  * standard split functor to address memory in the node objects.
+ * The feature matrix is neither copied nor converted: the trees are trained
+ * directly on the caller's view, which may be float32, strided, or point to
+ * memory-mapped data. Only the (n x 1) integer label array is allocated.
  */
 template<class LabelType, class T1, class C1, class T2, class C2>
 class Processor<ClassificationTag, LabelType, T1, C1, T2, C2>
@@ -178,14 +204,16 @@ class Processor<ClassificationTag, LabelType, T1, C1, T2, C2>
     :
         features_( features) // do not touch the features. 
     {
-        vigra_precondition(!detail::contains_nan(features), "RandomForest(): Feature matrix "
-                                                           "contains NaNs");
-        vigra_precondition(!detail::contains_nan(response), "RandomForest(): Response "
-                                                           "contains NaNs");
-        vigra_precondition(!detail::contains_inf(features), "RandomForest(): Feature matrix "
-                                                           "contains inf");
-        vigra_precondition(!detail::contains_inf(response), "RandomForest(): Response "
-                                                           "contains inf");
+        detail::NonFiniteValue check = detail::find_non_finite(features);
+        vigra_precondition(check != detail::ContainsNaN, "RandomForest(): Feature matrix "
+                                                         "contains NaNs");
+        vigra_precondition(check != detail::ContainsInf, "RandomForest(): Feature matrix "
+                                                         "contains inf");
+        check = detail::find_non_finite(response);
+        vigra_precondition(check != detail::ContainsNaN, "RandomForest(): Response "
+                                                         "contains NaNs");
+        vigra_precondition(check != detail::ContainsInf, "RandomForest(): Response "
+                                                         "contains inf");
         // set some of the problem specific parameters 
         ext_param.column_count_  = features.shape(1);
         ext_param.row_count_     = features.shape(0);
@@ -206,13 +234,14 @@ class Processor<ClassificationTag, LabelType, T1, C1, T2, C2>
         }
         for(MultiArrayIndex k = 0; k < features.shape(0); ++k)
         {
-            if(std::find(ext_param.classes.begin(), ext_param.classes.end(), response(k,0)) == ext_param.classes.end())
+            typename ArrayVector<T>::const_iterator c = 
+                std::find(ext_param.classes.begin(), ext_param.classes.end(), response(k,0));
+            if(c == ext_param.classes.end())
             {
                 throw std::runtime_error("RandomForest(): invalid label in training data.");
             }
             else
-                intLabels_(k, 0) = std::find(ext_param.classes.begin(), ext_param.classes.end(), response(k,0))
-                                    - ext_param.classes.begin();
+                intLabels_(k, 0) = c - ext_param.classes.begin();
         }
         // set class weights
         if(ext_param.class_weights_.size() == 0)
@@ -297,14 +326,16 @@ public:
         ext_param.problem_type_  = REGRESSION;
         ext_param.used_          = true;
         detail::fill_external_parameters(options, ext_param);
-        vigra_precondition(!detail::contains_nan(features), "Processor(): Feature Matrix "
-                                                           "Contains NaNs");
-        vigra_precondition(!detail::contains_nan(response), "Processor(): Response "
-                                                           "Contains NaNs");
-        vigra_precondition(!detail::contains_inf(features), "Processor(): Feature Matrix "
-                                                           "Contains inf");
-        vigra_precondition(!detail::contains_inf(response), "Processor(): Response "
-                                                           "Contains inf");
+        detail::NonFiniteValue check = detail::find_non_finite(features);
+        vigra_precondition(check != detail::ContainsNaN, "Processor(): Feature Matrix "
+                                                         "Contains NaNs");
+        vigra_precondition(check != detail::ContainsInf, "Processor(): Feature Matrix "
+                                                         "Contains inf");
+        check = detail::find_non_finite(response);
+        vigra_precondition(check != detail::ContainsNaN, "Processor(): Response "
+                                                         "Contains NaNs");
+        vigra_precondition(check != detail::ContainsInf, "Processor(): Response "
+                                                         "Contains inf");
         strata_ = MultiArray<2, int> (MultiArrayShape<2>::type(response_.shape(0), 1));
         ext_param.response_size_ = response.shape(1);
         ext_param.class_count_ = response_.shape(1);
@@ -45,6 +45,7 @@
 #include "../matrix.hxx"
 #include "../random.hxx"
 #include "../functorexpression.hxx"
+#include "../metaprogramming.hxx"
 #include "rf_nodeproxy.hxx"
 //#include "rf_sampling.hxx"
 #include "rf_region.hxx"
@@ -515,8 +516,8 @@ class ImpurityLoss
     template<class Counts>
     double decrement_histogram(Counts const & counts)
     {
-        std::transform(counts.begin(), counts.end(),
-                       counts_.begin(), counts_.begin(),
+        std::transform(counts_.begin(), counts_.end(),
+                       counts.begin(), counts_.begin(),
                        std::minus<double>());
         total_counts_ = std::accumulate( counts_.begin(), 
                                          counts_.end(),
@@ -837,6 +838,7 @@ public:
     std::ptrdiff_t               min_index_;
     double                  min_threshold_;
     ProblemSpec<>           ext_param_;
+    ArrayVector<double>     bin_counts_;
 
     BestGiniOfColumn()
     {}
@@ -884,6 +886,11 @@ public:
      *                BestCirremtcounts[0] and [1] contain the 
      *                class histogram of the left and right region of 
      *                the left and right regions. 
+     *
+     *  For classification, columns of type UInt8 (see FeatureBinning) are 
+     *  not sorted. Instead, a class histogram over the 256 possible values
+     *  is computed in a single pass, and the split is searched along the 
+     *  histogram. This gives the same split as the sort-based search.
      */
     template<   class DataSourceF_t,
                 class DataSource_t, 
@@ -894,6 +901,23 @@ public:
                     I_Iter                & begin, 
                     I_Iter                & end,
                     Array           const & region_response)
+    {
+        typedef typename IfBool<IsSameType<typename DataSourceF_t::value_type, UInt8>::value &&
+                                !IsSameType<LineSearchLossTag, LSQLoss>::value,
+                                VigraTrueType, VigraFalseType>::type UseHistogram;
+        searchSplit(column, labels, begin, end, region_response, UseHistogram());
+    }
+
+    template<   class DataSourceF_t,
+                class DataSource_t, 
+                class I_Iter, 
+                class Array>
+    void searchSplit(DataSourceF_t   const & column,
+                     DataSource_t    const & labels,
+                     I_Iter                & begin, 
+                     I_Iter                & end,
+                     Array           const & region_response,
+                     VigraFalseType)
     {
         std::sort(begin, end, 
                   SortSamplesByDimensions<DataSourceF_t>(column, 0));
@@ -942,6 +966,75 @@ public:
         //std::cin >> in;
     }
 
+    template<   class DataSourceF_t,
+                class DataSource_t, 
+                class I_Iter, 
+                class Array>
+    void searchSplit(DataSourceF_t   const & column,
+                     DataSource_t    const & labels,
+                     I_Iter                & begin, 
+                     I_Iter                & end,
+                     Array           const & region_response,
+                     VigraTrueType)
+    {
+        typedef typename 
+            LossTraits<LineSearchLossTag, DataSource_t>::type LineSearchLoss;
+        int classCount = ext_param_.class_count_;
+        
+        // class histogram of each bin (bin_counts_ is kept zero between calls)
+        if(bin_counts_.size() != 256*classCount)
+            bin_counts_.resize(256*classCount, 0.0);
+        int minBin = 255, maxBin = 0;
+        for(I_Iter iter = begin; iter != end; ++iter)
+        {
+            int bin = column(*iter, 0);
+            bin_counts_[bin*classCount + labels(*iter, 0)] += 1.0;
+            minBin = std::min(minBin, bin);
+            maxBin = std::max(maxBin, bin);
+        }
+        
+        LineSearchLoss left(labels, ext_param_); //initialize left and right region
+        LineSearchLoss right(labels, ext_param_);
+        min_gini_ = right.init(begin, end, region_response);  
+        min_threshold_ = minBin;
+        min_index_     = 0;
+        
+        // consider the boundaries between consecutive non-empty bins
+        std::ptrdiff_t leftCount = 0;
+        for(int bin = minBin; bin < maxBin;)
+        {
+            ArrayVectorView<double> counts(classCount, bin_counts_.begin() + bin*classCount);
+            int next = bin + 1;
+            while(std::accumulate(bin_counts_.begin() + next*classCount,
+                                  bin_counts_.begin() + (next+1)*classCount, 0.0) == 0.0)
+                ++next;
+            double lr  =  right.decrement_histogram(counts);
+            double ll  =  left.increment_histogram(counts);
+            double loss = lr +ll;
+            leftCount += (std::ptrdiff_t)std::accumulate(counts.begin(), counts.end(), 0.0);
+#ifdef CLASSIFIER_TEST
+            if(loss < min_gini_ && !closeAtTolerance(loss, min_gini_))
+#else
+            if(loss < min_gini_ )
+#endif 
+            {
+                bestCurrentCounts[0] = left.response();
+                bestCurrentCounts[1] = right.response();
+#ifdef CLASSIFIER_TEST
+                min_gini_       = loss < min_gini_? loss : min_gini_;
+#else
+                min_gini_       = loss; 
+#endif
+                min_index_      = leftCount;
+                min_threshold_  = (bin + next) / 2.0;
+            }
+            bin = next;
+        }
+        if(minBin <= maxBin)
+            std::fill(bin_counts_.begin() + minBin*classCount, 
+                      bin_counts_.begin() + (maxBin+1)*classCount, 0.0);
+    }
+
     template<class DataSource_t, class Iter, class Array>
     double loss_of_region(DataSource_t const & labels,
                           Iter & begin, 
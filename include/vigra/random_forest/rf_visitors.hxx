@@ -44,6 +44,7 @@
 
 #include <vigra/multi_pointoperators.hxx>
 #include <vigra/timing.hxx>
+#include <vigra/threadpool.hxx>
 
 namespace vigra
 {
@@ -999,14 +1000,98 @@ class OOB_Error : public VisitorBase
 };
 
 
+namespace detail
+{
+
+/* \brief predict the OOB samples of one block of rows for CompleteOOBInfo. 
+ * Each row is only touched by one thread, the per-tree error counts are
+ * accumulated per thread.
+ */
+template <class RF, class PR, class SM>
+struct CompleteOOBInfoFunctor
+{
+    RF &                    rf_;
+    PR &                    pr_;
+    SM &                    sm_;
+    int                     index_;
+    bool                    is_weighted_;
+    MultiArray<2, double> & prob_oob_;
+    MultiArray<2, double> & oobCount_;
+    MultiArray<2, double> & oobErrorCount_;
+    ArrayVector<int> &      total_oob_;
+    ArrayVector<int> &      wrong_oob_;
+
+    static const int blockSize = 1024;
+
+    CompleteOOBInfoFunctor(RF & rf, PR & pr, SM & sm, int index, bool is_weighted,
+                           MultiArray<2, double> & prob_oob,
+                           MultiArray<2, double> & oobCount,
+                           MultiArray<2, double> & oobErrorCount,
+                           ArrayVector<int> & total_oob,
+                           ArrayVector<int> & wrong_oob)
+    : rf_(rf), pr_(pr), sm_(sm), index_(index), is_weighted_(is_weighted),
+      prob_oob_(prob_oob), oobCount_(oobCount), oobErrorCount_(oobErrorCount),
+      total_oob_(total_oob), wrong_oob_(wrong_oob)
+    {}
+
+    void operator()(int thread, MultiArrayIndex block)
+    {
+        int class_count = rf_.class_count(),
+            begin = block*blockSize,
+            end   = std::min<int>(begin + blockSize, rf_.ext_param_.row_count_);
+        MultiArray<2, double> tmp_prob(MultiArrayShape<2>::type(1, class_count));
+        for(int ll = begin; ll < end; ++ll)
+        {
+            // if the lth sample is oob...
+            if(sm_.is_used()[ll])
+                continue;
+            // update number of trees in which current sample is oob
+            ++oobCount_[ll];
+
+            // update number of oob samples in this tree.
+            ++total_oob_[thread]; 
+            // get the predicted votes ---> tmp_prob;
+            int pos =  rf_.tree(index_).getToLeaf(rowVector(pr_.features(),ll));
+            Node<e_ConstProbNode> node ( rf_.tree(index_).topology_, 
+                                                rf_.tree(index_).parameters_,
+                                                pos);
+            for(int ii = 0; ii < class_count; ++ii)
+            {
+                tmp_prob[ii] = node.prob_begin()[ii];
+            }
+            if(is_weighted_)
+            {
+                for(int ii = 0; ii < class_count; ++ii)
+                    tmp_prob[ii] = tmp_prob[ii] * (*(node.prob_begin()-1));
+            }
+            rowVector(prob_oob_, ll) += tmp_prob;
+            int label = argMax(tmp_prob); 
+            
+            if(label != pr_.response()(ll, 0))
+            {
+                // update number of wrong oob samples in this tree.
+                ++wrong_oob_[thread];
+                // update number of trees in which current sample is wrong oob
+                ++oobErrorCount_[ll];
+            }
+        }
+    }
+};
+
+} // namespace detail
+
 /** Visitor that calculates different OOB error statistics
+
+    The OOB samples of each tree are predicted in parallel, using
+    <tt>rf.options().n_threads_</tt> threads. The results do not depend
+    on the number of threads.
  */
 class CompleteOOBInfo : public VisitorBase
 {
     typedef MultiArrayShape<2>::type Shp;
     int class_count;
     bool is_weighted;
-    MultiArray<2,double> tmp_prob;
+    int trees_visited;  // the cumulative statistics don't depend on the order of the trees
     public:
 
     /** OOB Error rate of each individual tree
@@ -1055,7 +1140,7 @@ class CompleteOOBInfo : public VisitorBase
      */
     MultiArray<4, double>       oobroc_per_tree;
     
-    CompleteOOBInfo() : VisitorBase(), oob_mean(0), oob_std(0), oob_per_tree2(0)  {}
+    CompleteOOBInfo() : VisitorBase(), trees_visited(0), oob_mean(0), oob_std(0), oob_per_tree2(0)  {}
 
 #ifdef HasHDF5
     /** save to HDF5 file
@@ -1090,11 +1175,11 @@ class CompleteOOBInfo : public VisitorBase
             oobroc_per_tree.reshape(MultiArrayShape<4>::type(2,2,rf.tree_count(), rf.tree_count()));
         else
             oobroc_per_tree.reshape(MultiArrayShape<4>::type(rf.class_count(),rf.class_count(),1, rf.tree_count()));
-        tmp_prob.reshape(Shp(1, class_count), 0); 
         prob_oob.reshape(Shp(rf.ext_param().row_count_,class_count), 0);
         is_weighted = rf.options().predict_weighted_;
         oob_per_tree.reshape(Shp(1, rf.tree_count()), 0);
         breiman_per_tree.reshape(Shp(1, rf.tree_count()), 0);
+        trees_visited = 0;
         //do the first time called.
         if(int(oobCount.size()) != rf.ext_param_.row_count_)
         {
@@ -1104,48 +1189,22 @@ class CompleteOOBInfo : public VisitorBase
     }
 
     template<class RF, class PR, class SM, class ST>
-    void visit_after_tree(RF& rf, PR & pr,  SM & sm, ST & st, int index)
+    void visit_after_tree(RF& rf, PR & pr,  SM & sm, ST & /* st */, int index)
     {
         // go through the samples
-        int total_oob =0;
-        int wrong_oob =0;
-        for(int ll = 0; ll < rf.ext_param_.row_count_; ++ll)
-        {
-            // if the lth sample is oob...
-            if(!sm.is_used()[ll])
-            {
-                // update number of trees in which current sample is oob
-                ++oobCount[ll];
-
-                // update number of oob samples in this tree.
-                ++total_oob; 
-                // get the predicted votes ---> tmp_prob;
-                int pos =  rf.tree(index).getToLeaf(rowVector(pr.features(),ll));
-                Node<e_ConstProbNode> node ( rf.tree(index).topology_, 
-                                                    rf.tree(index).parameters_,
-                                                    pos);
-                tmp_prob.init(0); 
-                for(int ii = 0; ii < class_count; ++ii)
-                {
-                    tmp_prob[ii] = node.prob_begin()[ii];
-                }
-                if(is_weighted)
-                {
-                    for(int ii = 0; ii < class_count; ++ii)
-                        tmp_prob[ii] = tmp_prob[ii] * (*(node.prob_begin()-1));
-                }
-                rowVector(prob_oob, ll) += tmp_prob;
-                int label = argMax(tmp_prob); 
-                
-                if(label != pr.response()(ll, 0))
-                {
-                    // update number of wrong oob samples in this tree.
-                    ++wrong_oob;
-                    // update number of trees in which current sample is wrong oob
-                    ++oobErrorCount[ll];
-                }
-            }
-        }
+        ParallelOptions options = ParallelOptions().numThreads(rf.options().n_threads_);
+        ArrayVector<int> total_oob_per_thread(options.getActualNumThreads(), 0),
+                         wrong_oob_per_thread(options.getActualNumThreads(), 0);
+        typedef detail::CompleteOOBInfoFunctor<RF, PR, SM> Functor;
+        parallel_foreach(options, 
+                         (rf.ext_param_.row_count_ + Functor::blockSize - 1) / Functor::blockSize,
+                         Functor(rf, pr, sm, index, is_weighted, prob_oob, oobCount, oobErrorCount,
+                                 total_oob_per_thread, wrong_oob_per_thread));
+        int total_oob = std::accumulate(total_oob_per_thread.begin(), total_oob_per_thread.end(), 0),
+            wrong_oob = std::accumulate(wrong_oob_per_thread.begin(), wrong_oob_per_thread.end(), 0);
+
+        // the ensemble statistics refer to all trees visited so far
+        int trees = trees_visited++;
         int breimanstyle = 0;
         int totalOobCount = 0;
         for(int ll=0; ll < static_cast<int>(rf.ext_param_.row_count_); ++ll)
@@ -1157,31 +1216,53 @@ class CompleteOOBInfo : public VisitorBase
                 ++totalOobCount;
                 if(oobroc_per_tree.shape(2) == 1)
                 {
-                    oobroc_per_tree(pr.response()(ll,0), argMax(rowVector(prob_oob, ll)),0 ,index)++;
+                    oobroc_per_tree(pr.response()(ll,0), argMax(rowVector(prob_oob, ll)),0 ,trees)++;
                 }
             }
         }
         if(oobroc_per_tree.shape(2) == 1)
-            oobroc_per_tree.bindOuter(index)/=totalOobCount;
+            oobroc_per_tree.bindOuter(trees)/=totalOobCount;
         if(oobroc_per_tree.shape(2) > 1)
         {
             MultiArrayView<3, double> current_roc 
-                    = oobroc_per_tree.bindOuter(index);
-            for(int gg = 0; gg < current_roc.shape(2); ++gg)
+                    = oobroc_per_tree.bindOuter(trees);
+            int thresholds = current_roc.shape(2);
+            // A sample is predicted as class 1 for all thresholds gg < k, 
+            // where k is found by bisection. Count the samples per (label, k) 
+            // instead of comparing each sample with every threshold.
+            MultiArray<2, double> k_count(Shp(2, thresholds+1));
+            for(int ll=0; ll < static_cast<int>(rf.ext_param_.row_count_); ++ll)
             {
-                for(int ll=0; ll < static_cast<int>(rf.ext_param_.row_count_); ++ll)
+                if(oobCount[ll])
                 {
-                    if(oobCount[ll])
+                    int lo = 0, hi = thresholds;
+                    while(lo < hi)
                     {
-                        int pred = prob_oob(ll, 1) > (double(gg)/double(current_roc.shape(2)))?
-                                        1 : 0; 
-                        current_roc(pr.response()(ll, 0), pred, gg)+= 1; 
+                        int gg = (lo + hi) / 2;
+                        if(prob_oob(ll, 1) > (double(gg)/double(thresholds)))
+                            lo = gg + 1;
+                        else
+                            hi = gg;
                     }
+                    k_count(pr.response()(ll, 0), lo) += 1;
                 }
-                current_roc.bindOuter(gg)/= totalOobCount;
             }
+            for(int label = 0; label < 2; ++label)
+            {
+                double positive = 0.0, total = 0.0;
+                for(int k = 0; k <= thresholds; ++k)
+                    total += k_count(label, k);
+                for(int gg = thresholds-1; gg >= 0; --gg)
+                {
+                    positive += k_count(label, gg+1);
+                    current_roc(label, 1, gg) += positive;
+                    current_roc(label, 0, gg) += total - positive;
+                }
+            }
+            for(int gg = 0; gg < thresholds; ++gg)
+                current_roc.bindOuter(gg)/= totalOobCount;
         }
-        breiman_per_tree[index] = double(breimanstyle)/double(totalOobCount);
+        breiman_per_tree[trees] = double(breimanstyle)/double(totalOobCount);
         oob_per_tree[index] = double(wrong_oob)/double(total_oob);
         // go through the ib samples; 
     }
@@ -1214,6 +1295,97 @@ class CompleteOOBInfo : public VisitorBase
     }
 };
 
+namespace detail
+{
+
+/* \brief compute the permutation importance of one column for 
+ * VariableImportanceVisitor. random_ holds the state of the random 
+ * number generator at the start of this column, so that the 
+ * permutations are the same as in a sequential computation. Instead
+ * of permuting the feature column, a permutation of the OOB indices
+ * is maintained, and each OOB row is copied into a buffer where the 
+ * permuted value is substituted. Only row 'column' of the result is
+ * modified.
+ */
+template <class RF, class PR, class Random>
+struct VariableImportanceFunctor
+{
+    RF &                        rf_;
+    PR &                        pr_;
+    int                         index_;
+    ArrayVector<Int32> const &  oob_indices_;
+    ArrayVector<Random> const & randoms_;
+    int                         repetition_count_;
+    MultiArray<2, double> const & oob_right_;
+    MultiArray<2, double> &     variable_importance_;
+
+    VariableImportanceFunctor(RF & rf, PR & pr, int index,
+                              ArrayVector<Int32> const & oob_indices,
+                              ArrayVector<Random> const & randoms,
+                              int repetition_count,
+                              MultiArray<2, double> const & oob_right,
+                              MultiArray<2, double> & variable_importance)
+    : rf_(rf), pr_(pr), index_(index), oob_indices_(oob_indices), randoms_(randoms),
+      repetition_count_(repetition_count), oob_right_(oob_right),
+      variable_importance_(variable_importance)
+    {}
+
+    void operator()(int /* thread */, MultiArrayIndex column)
+    {
+        typedef MultiArrayShape<2>::type Shp_t;
+        typedef typename PR::FeatureWithMemory_t FeatureArray;
+        typedef typename FeatureArray::value_type FeatureValue;
+
+        Int32 class_count  = rf_.ext_param_.class_count_,
+              column_count = rf_.ext_param_.column_count_;
+        int n = oob_indices_.size();
+
+        // the permutations of all repetitions (each one permutes the previous one)
+        Random random(randoms_[column]);
+        UniformIntRandomFunctor<Random> randint(random);
+        ArrayVector<Int32> current(n), permutations(n*repetition_count_);
+        for(int jj = 0; jj < n; ++jj)
+            current[jj] = jj;
+        for(int rr = 0; rr < repetition_count_; ++rr)
+        {
+            for(int jj = 1; jj < n; ++jj)
+                std::swap(current[jj], current[randint(jj+1)]);
+            std::copy(current.begin(), current.end(), permutations.begin() + rr*n);
+        }
+
+        MultiArray<2, FeatureValue> row(Shp_t(1, column_count));
+        MultiArray<2, double> perm_oob_right(Shp_t(1, class_count + 1)); 
+        for(int jj = 0; jj < n; ++jj)
+        {
+            row = rowVector(pr_.features(), oob_indices_[jj]).subarray(Shp_t(0, 0), 
+                                                                   Shp_t(1, column_count));
+            Int32 label = pr_.response()(oob_indices_[jj], 0);
+            for(int rr = 0; rr < repetition_count_; ++rr)
+            {
+                row(0, column) = pr_.features()(oob_indices_[permutations[rr*n + jj]], column);
+                if(rf_.tree(index_).predictLabel(row) == label)
+                {
+                    //per class
+                    ++perm_oob_right[label];
+                    //total
+                    ++perm_oob_right[class_count];
+                }
+            }
+        }
+
+        //normalise and add to the variable_importance array.
+        perm_oob_right  /=  repetition_count_;
+        perm_oob_right -= oob_right_;
+        perm_oob_right *= -1;
+        perm_oob_right      /=  n;
+        variable_importance_
+            .subarray(Shp_t(column,0), 
+                      Shp_t(column+1,class_count+1)) += perm_oob_right;
+    }
+};
+
+} // namespace detail
+
 /** calculate variable importance while learning.
  */
 class VariableImportanceVisitor : public VisitorBase
@@ -1302,10 +1474,10 @@ class VariableImportanceVisitor : public VisitorBase
     }
 
     /**compute permutation based var imp. 
-     * (Only an Array of size oob_sample_count x 1 is created.
-     *  - apposed to oob_sample_count x feature_count in the other method.
      * 
-     * \sa FieldProxy
+     * The columns are processed in parallel, using 
+     * <tt>rf.options().n_threads_</tt> threads. The result does 
+     * not depend on the number of threads.
      */
     template<class RF, class PR, class SM, class ST>
     void after_tree_ip_impl(RF& rf, PR & pr,  SM & sm, ST & /* st */, int index)
@@ -1313,19 +1485,6 @@ class VariableImportanceVisitor : public VisitorBase
         typedef MultiArrayShape<2>::type Shp_t;
         Int32                   column_count = rf.ext_param_.column_count_;
         Int32                   class_count  = rf.ext_param_.class_count_;  
-        
-        /* This solution saves memory uptake but not multithreading
-         * compatible
-         */
-        // remove the const cast on the features (yep , I know what I am 
-        // doing here.) data is not destroyed.
-        //typename PR::Feature_t & features 
-        //    = const_cast<typename PR::Feature_t &>(pr.features());
-
-        typedef typename PR::FeatureWithMemory_t FeatureArray;
-        typedef typename FeatureArray::value_type FeatureValue;
-
-        FeatureArray features = pr.features();
 
         //find the oob indices of current tree. 
         ArrayVector<Int32>      oob_indices;
@@ -1335,9 +1494,6 @@ class VariableImportanceVisitor : public VisitorBase
             if(!sm.is_used()[ii])
                 oob_indices.push_back(ii);
 
-        //create space to back up a column      
-        ArrayVector<FeatureValue>     backup_column;
-
         // Random foo
 #ifdef CLASSIFIER_TEST
         RandomMT19937           random(1);
@@ -1347,13 +1503,9 @@ class VariableImportanceVisitor : public VisitorBase
         UniformIntRandomFunctor<RandomMT19937>  
                                 randint(random);
 
-
         //make some space for the results
         MultiArray<2, double>
                     oob_right(Shp_t(1, class_count + 1)); 
-        MultiArray<2, double>
-                    perm_oob_right (Shp_t(1, class_count + 1)); 
-            
         
         // get the oob success rate with the original samples
         for(iter = oob_indices.begin(); 
@@ -1361,7 +1513,7 @@ class VariableImportanceVisitor : public VisitorBase
             ++iter)
         {
             if(rf.tree(index)
-                    .predictLabel(rowVector(features, *iter)) 
+                    .predictLabel(rowVector(pr.features(), *iter)) 
                 ==  pr.response()(*iter, 0))
             {
                 //per class
@@ -1370,58 +1522,25 @@ class VariableImportanceVisitor : public VisitorBase
                 ++oob_right[class_count];
             }
         }
-        //get the oob rate after permuting the ii'th dimension.
+
+        // record the state of the random number generator at the start 
+        // of each column (the columns consume the random numbers in order)
+        ArrayVector<RandomMT19937> column_randoms;
+        column_randoms.reserve(column_count);
+        int n = oob_indices.size();
         for(int ii = 0; ii < column_count; ++ii)
         {
-            perm_oob_right.init(0.0); 
-            //make backup of original column
-            backup_column.clear();
-            for(iter = oob_indices.begin(); 
-                iter != oob_indices.end(); 
-                ++iter)
-            {
-                backup_column.push_back(features(*iter,ii));
-            }
-            
-            //get the oob rate after permuting the ii'th dimension.
+            column_randoms.push_back(random);
             for(int rr = 0; rr < repetition_count_; ++rr)
-            {               
-                //permute dimension. 
-                int n = oob_indices.size();
                 for(int jj = 1; jj < n; ++jj)
-                    std::swap(features(oob_indices[jj], ii), 
-                              features(oob_indices[randint(jj+1)], ii));
-
-                //get the oob success rate after permuting
-                for(iter = oob_indices.begin(); 
-                    iter != oob_indices.end(); 
-                    ++iter)
-                {
-                    if(rf.tree(index)
-                            .predictLabel(rowVector(features, *iter)) 
-                        ==  pr.response()(*iter, 0))
-                    {
-                        //per class
-                        ++perm_oob_right[pr.response()(*iter, 0)];
-                        //total
-                        ++perm_oob_right[class_count];
-                    }
-                }
-            }
-            
-            
-            //normalise and add to the variable_importance array.
-            perm_oob_right  /=  repetition_count_;
-            perm_oob_right -=oob_right;
-            perm_oob_right *= -1;
-            perm_oob_right      /=  oob_indices.size();
-            variable_importance_
-                .subarray(Shp_t(ii,0), 
-                          Shp_t(ii+1,class_count+1)) += perm_oob_right;
-            //copy back permuted dimension
-            for(int jj = 0; jj < int(oob_indices.size()); ++jj)
-                features(oob_indices[jj], ii) = backup_column[jj];
+                    randint(jj+1);
         }
+
+        //get the oob rate after permuting the ii'th dimension.
+        parallel_foreach(ParallelOptions().numThreads(rf.options().n_threads_), column_count,
+            detail::VariableImportanceFunctor<RF, PR, RandomMT19937>(
+                rf, pr, index, oob_indices, column_randoms, repetition_count_,
+                oob_right, variable_importance_));
     }
 
     /** calculate permutation based impurity after every tree has been 
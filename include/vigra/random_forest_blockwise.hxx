@@ -0,0 +1,293 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2015 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+
+#ifndef VIGRA_RANDOM_FOREST_BLOCKWISE_HXX
+#define VIGRA_RANDOM_FOREST_BLOCKWISE_HXX
+
+#include <algorithm>
+#include "multi_array.hxx"
+#include "multi_array_chunked.hxx"
+#include "random_forest.hxx"
+#include "threadpool.hxx"
+
+namespace vigra {
+
+namespace rf_blockwise_detail {
+
+    // Predict the probabilities of one tile of pixels. The tile consists of
+    // the pixels [begin, end) in scan order of the spatial axes. The feature 
+    // channels of these pixels are gathered into a buffer with one contiguous
+    // row per pixel, so that the tree traversal touches only few cache lines
+    // per pixel. The result is scattered into the class channels of 'prob'.
+template <class RF, unsigned int N, class U, class S1, class T, class S2>
+void
+predictTile(RF const & rf,
+            MultiArrayView<N, U, S1> const & features,
+            MultiArrayView<N, T, S2> & prob,
+            MultiArrayIndex begin, MultiArrayIndex end)
+{
+    MultiArrayIndex size = end - begin,
+                    featureCount = rf.feature_count(),
+                    classCount = rf.class_count();
+
+        // allocate transposed so that the rows of the views are contiguous
+    MultiArray<2, U> featureBuffer(Shape2(featureCount, size));
+    MultiArray<2, T> probBuffer(Shape2(classCount, size));
+    MultiArrayView<2, U, StridedArrayTag> rows = featureBuffer.transpose();
+    MultiArrayView<2, T, StridedArrayTag> probRows = probBuffer.transpose();
+
+    for(MultiArrayIndex c=0; c<featureCount; ++c)
+    {
+        MultiArrayView<N-1, U, StridedArrayTag> channel = features.bindOuter(c);
+        typename MultiArrayView<N-1, U, StridedArrayTag>::iterator src = channel.begin();
+        src += begin;
+        MultiArrayView<1, U, StridedArrayTag> dest = rows.bindOuter(c);
+        std::copy(src, src + size, dest.begin());
+    }
+
+    ArrayVector<bool> valid(RF::predictionBlockSize);
+    for(MultiArrayIndex k=0; k<size; k+=RF::predictionBlockSize)
+    {
+        MultiArrayIndex stop = std::min<MultiArrayIndex>(k + RF::predictionBlockSize, size);
+        rf.predictProbabilitiesBlock(rows.subarray(Shape2(k, 0), Shape2(stop, featureCount)),
+                                     probRows.subarray(Shape2(k, 0), Shape2(stop, classCount)),
+                                     valid);
+    }
+
+    for(MultiArrayIndex l=0; l<classCount; ++l)
+    {
+        MultiArrayView<N-1, T, StridedArrayTag> channel = prob.bindOuter(l);
+        typename MultiArrayView<N-1, T, StridedArrayTag>::iterator dest = channel.begin();
+        dest += begin;
+        MultiArrayView<1, T, StridedArrayTag> src = probRows.bindOuter(l);
+        std::copy(src.begin(), src.end(), dest);
+    }
+}
+
+    // number of pixels per tile in the MultiArrayView version
+static const MultiArrayIndex predictionTileSize = 1024;
+
+template <class RF, unsigned int N, class U, class S1, class T, class S2>
+struct PredictTilesFunctor
+{
+    RF const & rf_;
+    MultiArrayView<N, U, S1> const & features_;
+    MultiArrayView<N, T, S2> & prob_;
+    MultiArrayIndex pixelCount_;
+
+    PredictTilesFunctor(RF const & rf,
+                        MultiArrayView<N, U, S1> const & features,
+                        MultiArrayView<N, T, S2> & prob)
+    : rf_(rf),
+      features_(features),
+      prob_(prob),
+      pixelCount_(prod(features.shape().template subarray<0, N-1>()))
+    {}
+
+    void operator()(int /* thread */, MultiArrayIndex k)
+    {
+        MultiArrayIndex begin = k*predictionTileSize,
+                        end   = std::min(begin + predictionTileSize, pixelCount_);
+        predictTile(rf_, features_, prob_, begin, end);
+    }
+};
+
+template <class RF, unsigned int N, class U, class S1, class T, class S2>
+void
+predictProbabilitiesImpl(RF const & rf,
+                         MultiArrayView<N, U, S1> const & features,
+                         MultiArrayView<N, T, S2> prob,
+                         ParallelOptions const & options)
+{
+    vigra_precondition((features.shape().template subarray<0, N-1>() == 
+                            prob.shape().template subarray<0, N-1>()),
+        "predictProbabilities(): Shape mismatch between features and probabilities.");
+    vigra_precondition(features.shape(N-1) >= rf.feature_count(),
+        "predictProbabilities(): Too few feature channels.");
+    vigra_precondition(prob.shape(N-1) == rf.class_count(),
+        "predictProbabilities(): Number of probability channels must equal the number of classes.");
+
+    MultiArrayIndex pixelCount = prod(features.shape().template subarray<0, N-1>()),
+                    tileCount  = (pixelCount + predictionTileSize - 1) / predictionTileSize;
+    parallel_foreach(options, tileCount,
+        PredictTilesFunctor<RF, N, U, S1, T, S2>(rf, features, prob));
+}
+
+    // One tile per chunk of the features' spatial chunk grid. Each tile is
+    // checked out into memory (with all channels), predicted and written back.
+template <class RF, unsigned int N, class U, class T>
+struct PredictChunksFunctor
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    RF const & rf_;
+    ChunkedArray<N, U> const & features_;
+    ChunkedArray<N, T> & prob_;
+    Shape chunkArrayShape_;
+
+    PredictChunksFunctor(RF const & rf,
+                         ChunkedArray<N, U> const & features,
+                         ChunkedArray<N, T> & prob)
+    : rf_(rf),
+      features_(features),
+      prob_(prob),
+      chunkArrayShape_(features.chunkArrayShape())
+    {
+        chunkArrayShape_[N-1] = 1;
+    }
+
+    void operator()(int /* thread */, MultiArrayIndex k)
+    {
+        Shape chunk;
+        detail::ScanOrderToCoordinate<N>::exec(k, chunkArrayShape_, chunk);
+        Shape start = chunk * features_.chunkShape(),
+              stop  = min(start + features_.chunkShape(), features_.shape());
+        stop[N-1] = features_.shape(N-1);
+
+        MultiArray<N, U> featureBuffer(stop - start);
+        features_.checkoutSubarray(start, featureBuffer);
+
+        Shape probShape(stop - start);
+        probShape[N-1] = prob_.shape(N-1);
+        MultiArray<N, T> probBuffer(probShape);
+        predictProbabilitiesImpl(rf_, featureBuffer, probBuffer, 
+                                 ParallelOptions().numThreads(ParallelOptions::NoThreads));
+        prob_.commitSubarray(start, probBuffer);
+    }
+};
+
+} // namespace rf_blockwise_detail
+
+/** \addtogroup MachineLearning
+**/
+//@{
+
+/** \brief Predict the class probabilities of all pixels of an image or volume.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <class RF, unsigned int N, class U, class S1, class T, class S2>
+        void 
+        predictProbabilities(RF const & rf,
+                             MultiArrayView<N, Multiband<U>, S1> const & features,
+                             MultiArrayView<N, Multiband<T>, S2> prob,
+                             ParallelOptions const & options = ParallelOptions());
+
+        template <class RF, unsigned int N, class U, class T>
+        void 
+        predictProbabilities(RF const & rf,
+                             ChunkedArray<N, U> const & features,
+                             ChunkedArray<N, T> & prob,
+                             ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    The last axis of 'features' holds the feature channels of each pixel, and
+    the last axis of 'prob' receives one probability per class. This avoids
+    reshaping the feature stack into a (pixels &times; features) matrix as
+    required by RandomForest::predictProbabilities(). 'rf' can be a
+    \ref vigra::RandomForest or a \ref vigra::CompiledRandomForest.
+
+    The pixels are processed in tiles. The features of a tile are gathered 
+    into a small buffer with contiguous rows and passed to the forest's internal
+    block prediction function, and the tiles are distributed 
+    over the threads specified in 'options' (the forest's own <tt>n_threads</tt> 
+    setting is not used here). For ChunkedArrays, the tiles follow the spatial
+    chunk grid of 'features', so that each chunk is loaded only once, and
+    out-of-core data are processed in a single streaming pass. The chunk shape 
+    of 'prob' may be different. The results are identical to those of 
+    RandomForest::predictProbabilities() on the equivalent matrix. Pixels whose 
+    features contain NaN get zero probabilities.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/random_forest_blockwise.hxx\><br>
+    Namespace: vigra
+
+    \code
+    RandomForest<> rf;
+    rf.learn(trainingFeatures, trainingLabels);
+
+    MultiArray<3, float> features(Shape3(w, h, rf.feature_count()));
+    ... // compute features
+    MultiArray<3, float> prob(Shape3(w, h, rf.class_count()));
+    predictProbabilities(rf, MultiArrayView<3, Multiband<float> >(features),
+                             MultiArrayView<3, Multiband<float> >(prob));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void predictProbabilities)
+
+template <class RF, unsigned int N, class U, class S1, class T, class S2>
+void
+predictProbabilities(RF const & rf,
+                     MultiArrayView<N, Multiband<U>, S1> const & features,
+                     MultiArrayView<N, Multiband<T>, S2> prob,
+                     ParallelOptions const & options = ParallelOptions())
+{
+    rf_blockwise_detail::predictProbabilitiesImpl(rf, MultiArrayView<N, U, S1>(features),
+                                                  MultiArrayView<N, T, S2>(prob), options);
+}
+
+template <class RF, unsigned int N, class U, class T>
+void
+predictProbabilities(RF const & rf,
+                     ChunkedArray<N, U> const & features,
+                     ChunkedArray<N, T> & prob,
+                     ParallelOptions const & options = ParallelOptions())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    vigra_precondition((features.shape().template subarray<0, N-1>() == 
+                            prob.shape().template subarray<0, N-1>()),
+        "predictProbabilities(): Shape mismatch between features and probabilities.");
+    vigra_precondition(features.shape(N-1) >= rf.feature_count(),
+        "predictProbabilities(): Too few feature channels.");
+    vigra_precondition(prob.shape(N-1) == rf.class_count(),
+        "predictProbabilities(): Number of probability channels must equal the number of classes.");
+
+    Shape chunks = features.chunkArrayShape();
+    chunks[N-1] = 1;
+    parallel_foreach(options, prod(chunks),
+        rf_blockwise_detail::PredictChunksFunctor<RF, N, U, T>(rf, features, prob));
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_RANDOM_FOREST_BLOCKWISE_HXX
@@ -0,0 +1,455 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2015 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_SCALAR_REGION_STATISTICS_HXX
+#define VIGRA_SCALAR_REGION_STATISTICS_HXX
+
+#include "accumulator.hxx"
+#include "multi_iterator.hxx"
+
+namespace vigra {
+
+namespace acc {
+
+template <class T>
+class ScalarRegionStatistics;
+
+namespace acc_detail {
+
+struct ScalarRegionStatisticsTag {};
+
+    // result types of the statistics supported by ScalarRegionStatistics
+    // (unsupported statistics cause an 'incomplete type' error)
+template <class TAG, class T>
+struct ScalarRegionStatisticsResult;
+
+template <class T>
+struct ScalarRegionStatisticsResult<Count, T>
+{
+    typedef double type;
+};
+
+template <class T>
+struct ScalarRegionStatisticsResult<Sum, T>
+{
+    typedef typename AccumulatorResultTraits<T>::SumType type;
+};
+
+template <class T>
+struct ScalarRegionStatisticsResult<Mean, T>
+{
+    typedef typename AccumulatorResultTraits<T>::SumType type;
+};
+
+template <class T>
+struct ScalarRegionStatisticsResult<Minimum, T>
+{
+    typedef typename AccumulatorResultTraits<T>::MinmaxType type;
+};
+
+template <class T>
+struct ScalarRegionStatisticsResult<Maximum, T>
+{
+    typedef typename AccumulatorResultTraits<T>::MinmaxType type;
+};
+
+    // lightweight stand-in for a region accumulator, returned by getAccumulator()
+template <class TAG, class T>
+class ScalarRegionStatisticsAccessor
+{
+  public:
+    typedef typename ScalarRegionStatisticsResult<TAG, T>::type value_type;
+    typedef value_type                                          result_type;
+    
+    ScalarRegionStatistics<T> const & a_;
+    MultiArrayIndex label_;
+    
+    ScalarRegionStatisticsAccessor(ScalarRegionStatistics<T> const & a, MultiArrayIndex label)
+    : a_(a),
+      label_(label)
+    {}
+    
+    result_type get() const
+    {
+        return a_.regionResult(TAG(), label_);
+    }
+    
+    result_type operator()() const
+    {
+        return get();
+    }
+};
+
+template <class TAG, class A>
+struct LookupTagImpl<TAG, A, ScalarRegionStatisticsTag>
+{
+    typedef TAG Tag;
+    typedef ScalarRegionStatisticsAccessor<TAG, typename A::value_type> type;
+    typedef type reference;
+    typedef type pointer;
+    typedef typename type::value_type value_type;
+    typedef typename type::result_type result_type;
+};
+
+template <class TAG, class A>
+struct LookupTagImpl<TAG, A const, ScalarRegionStatisticsTag>
+: public LookupTagImpl<TAG, A, ScalarRegionStatisticsTag>
+{};
+
+template <class Tag, class reference>
+struct CastImpl<Tag, ScalarRegionStatisticsTag, reference>
+{
+    template <class A>
+    static reference exec(A & a)
+    {
+        vigra_precondition(false, 
+            "getAccumulator(): a region label is required when a region accumulator is queried.");
+        return reference(a, 0);
+    }
+    
+    template <class A>
+    static reference exec(A & a, MultiArrayIndex label)
+    {
+        vigra_precondition(0 <= label && label <= a.maxRegionLabel(),
+            "getAccumulator(): region label out of range.");
+        return reference(a, label);
+    }
+};
+
+} // namespace acc_detail
+
+/** \brief Per-region Count, Sum, Mean, Minimum, and Maximum of scalar data in structure-of-arrays layout.
+
+    \ref AccumulatorChainArray stores a complete accumulator chain for every region, and the 
+    per-pixel label dispatch jumps between these objects. When only a few scalar statistics 
+    are needed, this class is much faster: each statistic is kept in its own contiguous array 
+    indexed by label, and the update loop accumulates runs of pixels with equal label in local 
+    variables before touching these arrays. Results are accessed via \ref get() as usual:
+    
+    \code
+    MultiArray<3, float>  data(...);
+    MultiArray<3, UInt32> labels(...);
+    
+    ScalarRegionStatistics<float> a;
+    extractFeatures(data, labels, a);
+    
+    double mean = get<Mean>(a, 1);
+    float  maxi = get<Maximum>(a, 1);
+    
+    // the arrays can also be accessed directly
+    MultiArrayView<1, double> counts = a.count();
+    \endcode
+    
+    Only <tt>Count</tt>, <tt>Sum</tt>, <tt>Mean</tt>, <tt>Minimum</tt> and <tt>Maximum</tt> are 
+    supported. The element type <tt>T</tt> must be scalar, and the labels must be in the range 
+    <tt>[0, maxRegionLabel()]</tt> (except for the ignored label). Unless setMaxRegionLabel() 
+    was called, the maximum label is determined from the first label array. Minimum and 
+    maximum of empty regions are <tt>NumericTraits<T>::max()</tt> and 
+    <tt>NumericTraits<T>::min()</tt> respectively.
+    
+    <b>\#include</b> \<vigra/scalar_region_statistics.hxx\><br/>
+    Namespace: vigra::acc
+*/
+template <class T>
+class ScalarRegionStatistics
+{
+  public:
+    typedef acc_detail::ScalarRegionStatisticsTag      Tag;
+    typedef T                                          value_type;
+    typedef typename AccumulatorResultTraits<T>::SumType    SumType;
+    typedef typename AccumulatorResultTraits<T>::MinmaxType MinmaxType;
+    
+    ScalarRegionStatistics()
+    : ignore_label_(-1)
+    {}
+    
+    /** Statistics will not be computed for label l. Note that only one label can be ignored.
+    */
+    void ignoreLabel(MultiArrayIndex l)
+    {
+        ignore_label_ = l;
+    }
+    
+    /** Ask for a label to be ignored. Default: -1 (meaning that no label is ignored).
+    */
+    MultiArrayIndex ignoredLabel() const
+    {
+        return ignore_label_;
+    }
+    
+    /** Set the maximum region label. Existing statistics are preserved when the 
+        label range is enlarged.
+    */
+    void setMaxRegionLabel(unsigned label)
+    {
+        MultiArrayIndex oldSize = count_.size(),
+                        newSize = (MultiArrayIndex)label + 1;
+        if(oldSize == newSize)
+            return;
+        Shape1 shape(newSize);
+        MultiArray<1, double>     count(shape);
+        MultiArray<1, SumType>    sum(shape);
+        MultiArray<1, MinmaxType> minimum(shape, NumericTraits<MinmaxType>::max()),
+                                  maximum(shape, NumericTraits<MinmaxType>::min());
+        MultiArrayIndex common = std::min(oldSize, newSize);
+        if(common > 0)
+        {
+            count.subarray(Shape1(0), Shape1(common))   = count_.subarray(Shape1(0), Shape1(common));
+            sum.subarray(Shape1(0), Shape1(common))     = sum_.subarray(Shape1(0), Shape1(common));
+            minimum.subarray(Shape1(0), Shape1(common)) = minimum_.subarray(Shape1(0), Shape1(common));
+            maximum.subarray(Shape1(0), Shape1(common)) = maximum_.subarray(Shape1(0), Shape1(common));
+        }
+        count_.swap(count);
+        sum_.swap(sum);
+        minimum_.swap(minimum);
+        maximum_.swap(maximum);
+    }
+    
+    /** Maximum region label (-1 if no label range has been set yet).
+    */
+    MultiArrayIndex maxRegionLabel() const
+    {
+        return (MultiArrayIndex)count_.size() - 1;
+    }
+    
+    /** Number of regions (equal to maxRegionLabel() + 1).
+    */
+    unsigned int regionCount() const
+    {
+        return count_.size();
+    }
+    
+    /** Forget all statistics and the label range.
+    */
+    void reset()
+    {
+        MultiArray<1, double>().swap(count_);
+        MultiArray<1, SumType>().swap(sum_);
+        MultiArray<1, MinmaxType>().swap(minimum_);
+        MultiArray<1, MinmaxType>().swap(maximum_);
+    }
+    
+    /** Add the data of the given arrays, where <tt>labels</tt> assigns 
+        a region to each element of <tt>data</tt>.
+    */
+    template <unsigned int N, class T1, class S1, class T2, class S2>
+    void update(MultiArrayView<N, T1, S1> const & data,
+                MultiArrayView<N, T2, S2> const & labels)
+    {
+        vigra_precondition(data.shape() == labels.shape(),
+            "ScalarRegionStatistics::update(): shape mismatch between data and labels.");
+        if(data.size() == 0)
+            return;
+        if(regionCount() == 0)
+        {
+            T2 minLabel, maxLabel;
+            labels.minmax(&minLabel, &maxLabel);
+            setMaxRegionLabel((unsigned)maxLabel);
+        }
+        
+        if(data.isUnstrided() && labels.isUnstrided())
+        {
+            updateLine(data.data(), 1, labels.data(), 1, data.size());
+        }
+        else
+        {
+            // process the array line by line along the first dimension
+            typename MultiArrayShape<N>::type outer(data.shape());
+            outer[0] = 1;
+            MultiCoordinateIterator<N> i(outer), end = i.getEndIterator();
+            for(; i != end; ++i)
+                updateLine(&data[*i], data.stride(0), &labels[*i], labels.stride(0), data.shape(0));
+        }
+    }
+    
+    /** Equivalent to <tt>merge(o)</tt>.
+    */
+    void operator+=(ScalarRegionStatistics const & o)
+    {
+        merge(o);
+    }
+    
+    /** Merge with the statistics o. The label range is enlarged if necessary.
+    */
+    void merge(ScalarRegionStatistics const & o)
+    {
+        if(o.maxRegionLabel() > maxRegionLabel())
+            setMaxRegionLabel((unsigned)o.maxRegionLabel());
+        for(MultiArrayIndex k=0; k<(MultiArrayIndex)o.regionCount(); ++k)
+            mergeRegion(k, o.count_[k], o.sum_[k], o.minimum_[k], o.maximum_[k]);
+    }
+    
+    /** Merge region j into region i and reset region j.
+    */
+    void merge(unsigned i, unsigned j)
+    {
+        vigra_precondition(i <= maxRegionLabel() && j <= maxRegionLabel(),
+            "ScalarRegionStatistics::merge(): region labels out of range.");
+        if(i == j)
+            return;
+        mergeRegion(i, count_[j], sum_[j], minimum_[j], maximum_[j]);
+        count_[j] = 0.0;
+        sum_[j] = SumType();
+        minimum_[j] = NumericTraits<MinmaxType>::max();
+        maximum_[j] = NumericTraits<MinmaxType>::min();
+    }
+    
+    /** Number of elements per region.
+    */
+    MultiArrayView<1, double> count() const
+    {
+        return count_;
+    }
+    
+    /** Sum of the data per region.
+    */
+    MultiArrayView<1, SumType> sum() const
+    {
+        return sum_;
+    }
+    
+    /** Minimum of the data per region.
+    */
+    MultiArrayView<1, MinmaxType> minimum() const
+    {
+        return minimum_;
+    }
+    
+    /** Maximum of the data per region.
+    */
+    MultiArrayView<1, MinmaxType> maximum() const
+    {
+        return maximum_;
+    }
+    
+    double regionResult(Count, MultiArrayIndex k) const
+    {
+        return count_[k];
+    }
+    
+    SumType regionResult(Sum, MultiArrayIndex k) const
+    {
+        return sum_[k];
+    }
+    
+    SumType regionResult(Mean, MultiArrayIndex k) const
+    {
+        return sum_[k] / count_[k];
+    }
+    
+    MinmaxType regionResult(Minimum, MultiArrayIndex k) const
+    {
+        return minimum_[k];
+    }
+    
+    MinmaxType regionResult(Maximum, MultiArrayIndex k) const
+    {
+        return maximum_[k];
+    }
+    
+  private:
+    template <class T1, class T2>
+    void updateLine(T1 const * data, MultiArrayIndex dataStride,
+                    T2 const * labels, MultiArrayIndex labelStride, 
+                    MultiArrayIndex size)
+    {
+        MultiArrayIndex maxLabel = maxRegionLabel();
+        
+        for(MultiArrayIndex i = 0; i < size;)
+        {
+            // find the run of equal labels starting at i
+            T2 label = labels[i*labelStride];
+            MultiArrayIndex end = i + 1;
+            while(end < size && labels[end*labelStride] == label)
+                ++end;
+            
+            MultiArrayIndex l = (MultiArrayIndex)label;
+            if(l != ignore_label_)
+            {
+                vigra_precondition(0 <= l && l <= maxLabel,
+                    "ScalarRegionStatistics::update(): label out of range.");
+                
+                // accumulate the run in registers
+                SumType    sum = SumType();
+                MinmaxType mi = minimum_[l], 
+                           ma = maximum_[l];
+                T1 const * d = data + i*dataStride;
+                for(MultiArrayIndex k = i; k < end; ++k, d += dataStride)
+                {
+                    MinmaxType v = static_cast<MinmaxType>(*d);
+                    sum += v;
+                    mi = std::min(mi, v);
+                    ma = std::max(ma, v);
+                }
+                count_[l] += end - i;
+                sum_[l] += sum;
+                minimum_[l] = mi;
+                maximum_[l] = ma;
+            }
+            i = end;
+        }
+    }
+    
+    void mergeRegion(MultiArrayIndex k, double count, SumType const & sum, 
+                     MinmaxType const & minimum, MinmaxType const & maximum)
+    {
+        count_[k] += count;
+        sum_[k] += sum;
+        minimum_[k] = std::min(minimum_[k], minimum);
+        maximum_[k] = std::max(maximum_[k], maximum);
+    }
+    
+    MultiArray<1, double>     count_;
+    MultiArray<1, SumType>    sum_;
+    MultiArray<1, MinmaxType> minimum_, maximum_;
+    MultiArrayIndex ignore_label_;
+};
+
+    // use the fast update loop of ScalarRegionStatistics
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class T>
+void extractFeatures(MultiArrayView<N, T1, S1> const & data, 
+                     MultiArrayView<N, T2, S2> const & labels, 
+                     ScalarRegionStatistics<T> & a)
+{
+    a.update(data, labels);
+}
+
+} // namespace acc
+
+} // namespace vigra
+
+#endif // VIGRA_SCALAR_REGION_STATISTICS_HXX
@@ -39,6 +39,7 @@
 #include <vector>
 #include <stack>
 #include <queue>
+#include <algorithm>
 #include "utilities.hxx"
 #include "stdimage.hxx"
 #include "stdimagefunctions.hxx"
@@ -116,42 +117,118 @@ public:
             return r->cost_ < l->cost_;
         }
     };
+};
+
+// Candidate queue of seeded region growing. The candidates are stored by value
+// in a single contiguous heap, so no per-candidate allocation is needed.
+template <class Pixel, class CostType>
+class SeedRgPixelQueue
+{
+    typedef typename Pixel::Compare Compare;
+
+    std::vector<Pixel> heap_;
 
-    struct Allocator
+  public:
+
+    std::size_t size() const
     {
-        ~Allocator()
-        {
-            while(!freelist_.empty())
-            {
-                delete freelist_.top();
-                freelist_.pop();
-            }
-        }
+        return heap_.size();
+    }
 
-        SeedRgPixel *
-        create(Point2D const & location, Point2D const & nearest,
-               COST const & cost, int const & count, int const & label)
-        {
-            if(!freelist_.empty())
-            {
-                SeedRgPixel * res = freelist_.top();
-                freelist_.pop();
-                res->set(location, nearest, cost, count, label);
-                return res;
-            }
+    bool empty() const
+    {
+        return heap_.empty();
+    }
 
-            return new SeedRgPixel(location, nearest, cost, count, label);
-        }
+    Pixel const & top() const
+    {
+        return heap_.front();
+    }
 
-        void dismiss(SeedRgPixel * p)
-        {
-            freelist_.push(p);
-        }
+    void pop()
+    {
+        std::pop_heap(heap_.begin(), heap_.end(), Compare());
+        heap_.pop_back();
+    }
 
-        std::stack<SeedRgPixel<COST> *> freelist_;
-    };
+    void push(Pixel const & pixel)
+    {
+        heap_.push_back(pixel);
+        std::push_heap(heap_.begin(), heap_.end(), Compare());
+    }
 };
 
+// For small integer costs, candidates are first sorted into one bucket per
+// cost value. Each bucket is a heap of its own that only resolves ties
+// (distance and insertion order), so the processing order is identical to
+// the one of the plain heap. Buckets are only allocated up to the largest
+// cost actually pushed, so that small images don't pay for the full range 
+// of CostType.
+template <class Pixel, class CostType>
+class SeedRgPixelBucketQueue
+{
+    typedef typename Pixel::Compare Compare;
+
+    std::vector<std::vector<Pixel> > buckets_;
+    std::size_t size_, top_;
+
+  public:
+
+    SeedRgPixelBucketQueue()
+    : buckets_(),
+      size_(0), top_(0)
+    {}
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    Pixel const & top() const
+    {
+        return buckets_[top_].front();
+    }
+
+    void pop()
+    {
+        std::vector<Pixel> & bucket = buckets_[top_];
+        std::pop_heap(bucket.begin(), bucket.end(), Compare());
+        bucket.pop_back();
+        --size_;
+        while(top_ < buckets_.size() && buckets_[top_].empty())
+            ++top_;
+    }
+
+    void push(Pixel const & pixel)
+    {
+        std::size_t index = (std::size_t)pixel.cost_;
+        if(index >= buckets_.size())
+            buckets_.resize(std::min(std::max(index + 1, 2*buckets_.size()),
+                                     (std::size_t)NumericTraits<CostType>::max() + 1));
+        std::vector<Pixel> & bucket = buckets_[index];
+        bucket.push_back(pixel);
+        std::push_heap(bucket.begin(), bucket.end(), Compare());
+        if(size_ == 0 || index < top_)
+            top_ = index;
+        ++size_;
+    }
+};
+
+template <class Pixel>
+class SeedRgPixelQueue<Pixel, unsigned char>
+: public SeedRgPixelBucketQueue<Pixel, unsigned char>
+{};
+
+template <class Pixel>
+class SeedRgPixelQueue<Pixel, unsigned short>
+: public SeedRgPixelBucketQueue<Pixel, unsigned short>
+{};
+
 struct UnlabelWatersheds
 {
     int operator()(int label) const
@@ -437,10 +514,7 @@ seededRegionGrowing(SrcIterator srcul,
     typedef typename RegionStatistics::cost_type CostType;
     typedef detail::SeedRgPixel<CostType> Pixel;
 
-    typename Pixel::Allocator allocator;
-
-    typedef std::priority_queue<Pixel *, std::vector<Pixel *>,
-                                typename Pixel::Compare>  SeedRgPixelHeap;
+    typedef detail::SeedRgPixelQueue<Pixel, CostType>  SeedRgPixelHeap;
 
     // copy seed image in an image with border
     IImage regions(w+2, h+2);
@@ -476,9 +550,7 @@ seededRegionGrowing(SrcIterator srcul,
                     {
                         CostType cost = stats[cneighbor].cost(as(isx));
 
-                        Pixel * pixel =
-                            allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                        pheap.push(pixel);
+                        pheap.push(Pixel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor));
                     }
                 }
             }
@@ -495,16 +567,12 @@ seededRegionGrowing(SrcIterator srcul,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Pixel * pixel = pheap.top();
+        Point2D pos = pheap.top().location_;
+        Point2D nearest = pheap.top().nearest_;
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
         pheap.pop();
 
-        Point2D pos = pixel->location_;
-        Point2D nearest = pixel->nearest_;
-        int lab = pixel->label_;
-        CostType cost = pixel->cost_;
-
-        allocator.dismiss(pixel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -542,20 +610,11 @@ seededRegionGrowing(SrcIterator srcul,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Pixel * new_pixel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_pixel);
+                    pheap.push(Pixel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab));
                 }
             }
         }
     }
-    
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
 
     // write result
     transformImage(ir, ir+Point2D(w,h), regions.accessor(), destul, ad,
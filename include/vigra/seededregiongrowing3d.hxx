@@ -47,6 +47,7 @@
 #include "multi_shape.hxx"
 #include "multi_pointoperators.hxx"
 #include "voxelneighborhood.hxx"
+#include "multi_gridgraph.hxx"
 
 namespace vigra {
 
@@ -126,38 +127,41 @@ public:
             return r->cost_ < l->cost_;
         }
     };
+};
+
+// candidate record for N-dimensional region growing
+template <class COST, class Shape>
+class SeedRgNode
+{
+public:
+    Shape location_, nearest_;
+    COST cost_;
+    int count_;
+    int label_;
+    int dist_;
 
-    struct Allocator
+    SeedRgNode(Shape const & location, Shape const & nearest,
+               COST const & cost, int count, int label)
+    : location_(location), nearest_(nearest),
+      cost_(cost), count_(count), label_(label),
+      dist_((int)squaredNorm(location - nearest))
+    {}
+
+    struct Compare
     {
-        ~Allocator()
+        // must implement > since the heap looks for the largest element
+        bool operator()(SeedRgNode const & l,
+                        SeedRgNode const & r) const
         {
-            while(!freelist_.empty())
+            if(r.cost_ == l.cost_)
             {
-                delete freelist_.top();
-                freelist_.pop();
-            }
-        }
+                if(r.dist_ == l.dist_) return r.count_ < l.count_;
 
-        SeedRgVoxel * create(Diff_type const & location, Diff_type const & nearest,
-                             COST const & cost, int const & count, int const & label)
-        {
-            if(!freelist_.empty())
-            {
-                SeedRgVoxel * res = freelist_.top();
-                freelist_.pop();
-                res->set(location, nearest, cost, count, label);
-                return res;
+                return r.dist_ < l.dist_;
             }
 
-            return new SeedRgVoxel(location, nearest, cost, count, label);
-        }
-
-        void dismiss(SeedRgVoxel * p)
-        {
-            freelist_.push(p);
+            return r.cost_ < l.cost_;
         }
-
-        std::stack<SeedRgVoxel<COST,Diff_type> *> freelist_;
     };
 };
 
@@ -247,7 +251,8 @@ public:
     In some cases, the cost only depends on the feature value of the current
     voxel. Then the update operation will simply be a no-op, and the <TT>cost()</TT>
     function returns its argument. This behavior is implemented by the
-    \ref SeedRgDirectValueFunctor.
+    \ref SeedRgDirectValueFunctor. When its <tt>cost_type</tt> is <tt>UInt8</tt> 
+    or <tt>UInt16</tt>, candidates are ordered by a bucket queue instead of a heap.
 
     <b> Declarations:</b>
 
@@ -340,14 +345,10 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     SrcImageIterator isy = srcul, isx = srcul, isz = srcul;  // iterators for the src image
 
     typedef typename RegionStatisticsArray::value_type RegionStatistics;
-    typedef typename PromoteTraits<typename RegionStatistics::cost_type, double>::Promote CostType;
+    typedef typename RegionStatistics::cost_type CostType;
     typedef detail::SeedRgVoxel<CostType, Diff_type> Voxel;
 
-    typename Voxel::Allocator allocator;
-
-    typedef std::priority_queue< Voxel *,
-                                 std::vector<Voxel *>,
-                                 typename Voxel::Compare >  SeedRgVoxelHeap;
+    typedef detail::SeedRgPixelQueue<Voxel, CostType>  SeedRgVoxelHeap;
     typedef MultiArray<3, int> IVolume;
     typedef IVolume::traverser Traverser;
 
@@ -400,9 +401,7 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                         {
                             CostType cost = stats[cneighbor].cost(as(isx));
 
-                            Voxel * voxel =
-                                allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                            pheap.push(voxel);
+                            pheap.push(Voxel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor));
                         }
                     }
                 }
@@ -413,16 +412,12 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Voxel * voxel = pheap.top();
+        Diff_type pos = pheap.top().location_;
+        Diff_type nearest = pheap.top().nearest_;
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
         pheap.pop();
 
-        Diff_type pos = voxel->location_;
-        Diff_type nearest = voxel->nearest_;
-        int lab = voxel->label_;
-        CostType cost = voxel->cost_;
-
-        allocator.dismiss(voxel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -460,20 +455,11 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Voxel * new_voxel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_voxel);
+                    pheap.push(Voxel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab));
                 }
             }
         }
     }
-    
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
 
     // write result
     transformMultiArray(ir, Diff_type(w,h,d), AccessorTraits<int>::default_accessor(), 
@@ -662,6 +648,185 @@ seededRegionGrowing3D(MultiArrayView<3, T1, S1> const & img1,
                           stats);
 }
 
+/********************************************************/
+/*                                                      */
+/*             seededRegionGrowingMultiArray            */
+/*                                                      */
+/********************************************************/
+
+/** \brief Seeded Region Growing on arrays of arbitrary dimension.
+
+    This function implements the same algorithm as \ref seededRegionGrowing()
+    and \ref seededRegionGrowing3D(), but works for any dimension <tt>N</tt>.
+    The neighborhood is defined by a \ref GridGraph and can be
+    <tt>DirectNeighborhood</tt> (the default, 4-neighborhood in 2D, 6-neighborhood in 3D)
+    or <tt>IndirectNeighborhood</tt> (8-neighborhood in 2D, 26-neighborhood in 3D).
+    The meaning of <tt>srgType</tt>, <tt>max_cost</tt> and the requirements on the
+    <TT>RegionStatisticsArray</TT> are the same as in \ref seededRegionGrowing().
+    The largest seed label is returned.
+
+    When the statistics functor's <tt>cost_type</tt> is <tt>UInt8</tt> or <tt>UInt16</tt>
+    (e.g. when \ref SeedRgDirectValueFunctor is applied to integer data), candidates
+    are ordered by a bucket queue instead of a heap. The result is the same in both cases.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                  class TS, class AS,
+                  class T2, class S2,
+                  class RegionStatisticsArray>
+        TS
+        seededRegionGrowingMultiArray(MultiArrayView<N, T1, S1> const & src,
+                                      MultiArrayView<N, TS, AS> const & seeds,
+                                      MultiArrayView<N, T2, S2>         labels,
+                                      RegionStatisticsArray & stats,
+                                      SRGType srgType = CompleteGrow,
+                                      NeighborhoodType neighborhood = DirectNeighborhood,
+                                      double max_cost = NumericTraits<double>::max());
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/seededregiongrowing3d.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8>  boundaries(shape);
+    MultiArray<3, UInt32> seeds(shape), labels(shape);
+    ... // compute boundary indicator and seeds
+
+    UInt32 max_region_label = ...;
+    ArrayOfRegionStatistics<SeedRgDirectValueFunctor<UInt8> > stats(max_region_label);
+
+    // UInt8 costs => the bucket queue is used
+    seededRegionGrowingMultiArray(boundaries, seeds, labels, stats, KeepContours);
+    \endcode
+*/
+template <unsigned int N, class T1, class S1,
+          class TS, class AS,
+          class T2, class S2,
+          class RegionStatisticsArray>
+TS
+seededRegionGrowingMultiArray(MultiArrayView<N, T1, S1> const & src,
+                              MultiArrayView<N, TS, AS> const & seeds,
+                              MultiArrayView<N, T2, S2> labels,
+                              RegionStatisticsArray & stats,
+                              SRGType srgType = CompleteGrow,
+                              NeighborhoodType neighborhood = DirectNeighborhood,
+                              double max_cost = NumericTraits<double>::max())
+{
+    vigra_precondition(src.shape() == seeds.shape() && src.shape() == labels.shape(),
+        "seededRegionGrowingMultiArray(): shape mismatch between input and output.");
+
+    typedef GridGraph<N, undirected_tag>   Graph;
+    typedef typename Graph::shape_type     Shape;
+    typedef typename RegionStatisticsArray::value_type RegionStatistics;
+    typedef typename RegionStatistics::cost_type CostType;
+    typedef detail::SeedRgNode<CostType, Shape> Pixel;
+    typedef detail::SeedRgPixelQueue<Pixel, CostType>  SeedRgPixelHeap;
+
+    Shape shape(src.shape());
+    Graph g(shape, neighborhood);
+
+    // copy seed array in an array with border, so that neighbors
+    // can be accessed via precomputed offsets without range checks
+    MultiArray<N, int> regions(shape + Shape(2), (int)SRGWatershedLabel);
+    MultiArrayView<N, int> inner(regions.subarray(Shape(1), shape + Shape(1)));
+    inner = seeds;
+
+    int directionCount = (int)g.maxDegree();
+    ArrayVector<MultiArrayIndex> neighbors(directionCount);
+    for(int i=0; i<directionCount; i++)
+        neighbors[i] = dot(g.neighborOffset(i), inner.stride());
+
+    SeedRgPixelHeap pheap;
+    int count = 0, cneighbor, maxRegionLabel = 0;
+
+    typedef typename MultiArrayView<N, int>::iterator RegionIterator;
+    RegionIterator i = inner.begin(), end = inner.end();
+    for(; i != end; ++i)
+    {
+        if(*i == 0)
+        {
+            // find candidate pixels for growing and fill heap
+            for(int k=0; k<directionCount; k++)
+            {
+                cneighbor = (&*i)[neighbors[k]];
+                if(cneighbor > 0)
+                {
+                    CostType cost = stats[cneighbor].cost(src[i.point()]);
+                    pheap.push(Pixel(i.point(), i.point() + g.neighborOffset(k), cost, count++, cneighbor));
+                }
+            }
+        }
+        else
+        {
+            vigra_precondition((TS)*i <= (TS)stats.maxRegionLabel(),
+                "seededRegionGrowingMultiArray(): Largest label exceeds size of RegionStatisticsArray.");
+            if(maxRegionLabel < *i)
+                maxRegionLabel = *i;
+        }
+    }
+
+    // perform region growing
+    while(!pheap.empty())
+    {
+        Shape pos = pheap.top().location_;
+        Shape nearest = pheap.top().nearest_;
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
+        pheap.pop();
+
+        if((srgType & StopAtThreshold) != 0 && cost > max_cost)
+            break;
+
+        int * irx = &inner[pos];
+
+        if(*irx) // already labelled region / watershed?
+            continue;
+
+        if((srgType & KeepContours) != 0)
+        {
+            for(int k=0; k<directionCount; k++)
+            {
+                cneighbor = irx[neighbors[k]];
+                if((cneighbor>0) && (cneighbor != lab))
+                {
+                    lab = SRGWatershedLabel;
+                    break;
+                }
+            }
+        }
+
+        *irx = lab;
+
+        if((srgType & KeepContours) == 0 || lab > 0)
+        {
+            // update statistics
+            stats[lab](src[pos]);
+
+            // find new candidate pixels
+            for(int k=0; k<directionCount; k++)
+            {
+                if(irx[neighbors[k]] == 0)
+                {
+                    Shape target = pos + g.neighborOffset(k);
+                    CostType cost = stats[lab].cost(src[target]);
+                    pheap.push(Pixel(target, nearest, cost, count++, lab));
+                }
+            }
+        }
+    }
+
+    // write result
+    transformMultiArray(inner, labels, detail::UnlabelWatersheds());
+
+    return (TS)maxRegionLabel;
+}
+
 } // namespace vigra
 
 #endif // VIGRA_SEEDEDREGIONGROWING_HXX
@@ -42,6 +42,7 @@
 #include "numerictraits.hxx"
 #include "accumulator.hxx"
 #include "array_vector.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -158,11 +159,13 @@ struct SlicOptions
 {
         /** \brief Create options object with default settings.
 
-            Defaults are: perform 10 iterations, determine a size limit for superpixels automatically.
+            Defaults are: perform 10 iterations, determine a size limit for superpixels automatically,
+            use as many threads as there are cores.
         */
     SlicOptions()
     : iter(10),
-      sizeLimit(0)
+      sizeLimit(0),
+      nThreads(ParallelOptions::Auto)
     {}
     
         /** \brief Number of iterations.
@@ -187,8 +190,24 @@ struct SlicOptions
         return *this;
     }
     
+        /** \brief Number of threads.
+        
+            The array is split into slabs along the last dimension, which are processed in 
+            parallel. The result does not depend on the number of threads.
+
+            Default: <tt>ParallelOptions::Auto</tt> (use as many threads as there are cores).
+            Note that this makes existing callers multi-threaded without any code change.
+            Pass <tt>ParallelOptions::NoThreads</tt> to run everything in the calling thread.
+        */
+    SlicOptions & numThreads(int n)
+    {
+        nThreads = n;
+        return *this;
+    }
+    
     unsigned int iter;
     unsigned int sizeLimit;
+    int nThreads;
 };
 
 namespace detail {
@@ -215,10 +234,15 @@ class Slic
     unsigned int execute();
 
   private:
+    void updateClusters();
     void updateAssigments();
     unsigned int postProcessing();
     
     typedef MultiArray<N,DistanceType>  DistanceImageType;
+    
+    // same types and arithmetic as acc::Mean and acc::RegionCenter
+    typedef typename acc::AccumulatorResultTraits<T>::SumType  MeanType;
+    typedef TinyVector<double, N>                               CenterType;
 
     ShapeType                       shape_;
     DataImageType                   dataImage_;
@@ -227,10 +251,14 @@ class Slic
     int                             max_radius_;
     DistanceType                    normalization_;
     SlicOptions                     options_;
+    ParallelOptions                 parallelOptions_;
+    ArrayVector<MultiArrayIndex>    slabs_;
     
-    typedef acc::Select<acc::DataArg<1>, acc::LabelArg<2>, acc::Mean, acc::RegionCenter> Statistics;
-    typedef acc::AccumulatorChainArray<CoupledArrays<N, T, Label>, Statistics> RegionFeatures;
-    RegionFeatures clusters_;
+    // statistics of each cluster
+    Label                           maxLabel_;
+    ArrayVector<double>             counts_;
+    ArrayVector<MeanType>           means_;
+    ArrayVector<CenterType>         centers_;
 };
 
 
@@ -248,9 +276,24 @@ Slic<N, T, Label>::Slic(
     distance_(shape_),
     max_radius_(maxRadius),
     normalization_(sq(intensityScaling) / sq(max_radius_)),
-    options_(options)
+    options_(options),
+    parallelOptions_(ParallelOptions().numThreads(options.nThreads)),
+    maxLabel_(0)
 {
-    clusters_.ignoreLabel(0);
+    // labels never exceed the largest seed label
+    Label minimum, maximum;
+    labelImage_.minmax(&minimum, &maximum);
+    maxLabel_ = std::max(maximum, Label(0));
+    counts_.resize(maxLabel_+1);
+    means_.resize(maxLabel_+1);
+    centers_.resize(maxLabel_+1);
+
+    // slabs along the last dimension for parallel processing
+    MultiArrayIndex slabCount = std::max<MultiArrayIndex>(1, 
+                     std::min<MultiArrayIndex>(parallelOptions_.getActualNumThreads(), shape_[N-1]));
+    slabs_.resize(slabCount+1);
+    for(MultiArrayIndex k=0; k<=slabCount; ++k)
+        slabs_[k] = k*shape_[N-1] / slabCount;
 }
 
 template <unsigned int N, class T, class Label>
@@ -260,8 +303,7 @@ unsigned int Slic<N, T, Label>::execute()
     for(size_t i=0; i<options_.iter; ++i)
     {
         // update mean for each cluster
-        clusters_.reset();
-        extractFeatures(dataImage_, labelImage_, clusters_);
+        updateClusters();
         
         // update which pixels get assigned to which cluster
         updateAssigments();
@@ -272,45 +314,116 @@ unsigned int Slic<N, T, Label>::execute()
 
 template <unsigned int N, class T, class Label>
 void
-Slic<N, T, Label>::updateAssigments()
+Slic<N, T, Label>::updateClusters()
 {
-    using namespace acc;
-    distance_.init(NumericTraits<DistanceType>::max());
-    for(unsigned int c=1; c<=clusters_.maxRegionLabel(); ++c)
+    // compute mean and center of each cluster in a single pass over the label 
+    // array (sequentially, so that the sums don't depend on the number of threads)
+    ArrayVector<CenterType> centerSums(maxLabel_+1);
+    std::fill(counts_.begin(), counts_.end(), 0.0);
+    std::fill(means_.begin(), means_.end(), MeanType());
+    
+    typedef typename CoupledIteratorType<N, T, Label>::type Iterator;
+    Iterator iter = createCoupledIterator(dataImage_, labelImage_),
+             end  = iter.getEndIterator();
+    for(; iter != end; ++iter)
     {
-        if(get<Count>(clusters_, c) == 0) // label doesn't exist
+        Label c = iter.template get<2>();
+        if(c == 0)
             continue;
-            
-        typedef typename LookupTag<RegionCenter, RegionFeatures>::value_type CenterType;
-        CenterType center = get<RegionCenter>(clusters_, c);
-
-        // get ROI limits around region center
-        ShapeType pixelCenter(round(center)), 
-                  startCoord(max(ShapeType(0), pixelCenter - ShapeType(max_radius_))), 
-                  endCoord(min(shape_, pixelCenter + ShapeType(max_radius_+1)));
-        center -= startCoord; // need center relative to ROI
-        
-        // setup iterators for ROI
-        typedef typename CoupledArrays<N, T, Label, DistanceType>::IteratorType Iterator;
-        Iterator iter = createCoupledIterator(dataImage_, labelImage_, distance_).
-                            restrictToSubarray(startCoord, endCoord),
-                 end = iter.getEndIterator();
-        
-        // only pixels within the ROI can be assigned to a cluster
-        for(; iter != end; ++iter)
+        counts_[c] += 1.0;
+        means_[c] += iter.template get<1>();
+        centerSums[c] += iter.point();
+    }
+    
+    for(Label c=1; c<=maxLabel_; ++c)
+    {
+        if(counts_[c] == 0.0) // label doesn't exist
+            continue;
+        means_[c]  /= counts_[c];
+        centers_[c] = centerSums[c] / counts_[c];
+    }
+}
+
+template <unsigned int N, class T, class Label>
+void
+Slic<N, T, Label>::updateAssigments()
+{
+    // each slab is processed by one thread, and the clusters are visited in the 
+    // same order as in a sequential pass, so there are no write conflicts
+    parallel_foreach(parallelOptions_, slabs_.size() - 1,
+        [&](int, MultiArrayIndex k)
         {
-            // compute distance between cluster center and pixel
-            DistanceType spatialDist   = squaredNorm(center-iter.point());
-            DistanceType colorDist     = squaredNorm(get<Mean>(clusters_, c)-iter.template get<1>());
-            DistanceType dist =  colorDist + normalization_*spatialDist;
-            // update label?
-            if(dist < iter.template get<3>())
+            ShapeType slabStart, slabStop(shape_);
+            slabStart[N-1] = slabs_[k];
+            slabStop[N-1]  = slabs_[k+1];
+            distance_.subarray(slabStart, slabStop).init(NumericTraits<DistanceType>::max());
+            
+            // distances of the current row to the current cluster (the views 
+            // are unstrided, so rows along dimension 0 are contiguous)
+            ArrayVector<DistanceType> rowDist(2*max_radius_+1);
+            
+            for(Label c=1; c<=maxLabel_; ++c)
             {
-                iter.template get<2>() = static_cast<Label>(c);
-                iter.template get<3>() = dist;
+                if(counts_[c] == 0.0) // label doesn't exist
+                    continue;
+                
+                CenterType center = centers_[c];
+                MeanType const & mean = means_[c];
+
+                // get ROI limits around region center
+                ShapeType pixelCenter(round(center)), 
+                          startCoord(max(ShapeType(0), pixelCenter - ShapeType(max_radius_))), 
+                          endCoord(min(shape_, pixelCenter + ShapeType(max_radius_+1)));
+                center -= startCoord; // need center relative to ROI
+                
+                // restrict ROI to the current slab
+                ShapeType roiStart(startCoord), roiStop(endCoord);
+                roiStart[N-1] = std::max(roiStart[N-1], slabStart[N-1]);
+                roiStop[N-1]  = std::min(roiStop[N-1], slabStop[N-1]);
+                if(roiStart[N-1] >= roiStop[N-1])
+                    continue;
+                
+                // only pixels within the ROI can be assigned to a cluster,
+                // which are processed row by row along dimension 0
+                ShapeType rowsShape(roiStop - roiStart);
+                const int width = static_cast<int>(rowsShape[0]);
+                rowsShape[0] = 1;
+                MultiCoordinateIterator<N> row(rowsShape), rowEnd(row.getEndIterator());
+                for(; row != rowEnd; ++row)
+                {
+                    const ShapeType p = *row + roiStart, 
+                                    q = p - startCoord;
+                    T const * data   = &dataImage_[p];
+                    Label * label    = &labelImage_[p];
+                    DistanceType * d = &distance_[p];
+                    CenterType diff  = center - q;
+                    const double diff0 = diff[0];
+                    diff[0] = 0.0;
+                    const double rowSpatialDist = squaredNorm(diff); // constant along the row
+                    
+                    // first pass: distance between cluster center and pixels
+                    // (an int counter, because int => double conversion is cheaper 
+                    // to vectorize than MultiArrayIndex => double)
+                    for(int x=0; x<width; ++x)
+                    {
+                        DistanceType spatialDist = sq(diff0 - x) + rowSpatialDist;
+                        DistanceType colorDist   = squaredNorm(mean - data[x]);
+                        rowDist[x] = colorDist + normalization_*spatialDist;
+                    }
+                    // second pass: update labels of the pixels that are closer
+                    // (separate from the distance update, so that both loops are 
+                    // simple selects that the compiler can vectorize)
+                    for(int x=0; x<width; ++x)
+                    {
+                        const Label oldLabel = label[x];
+                        label[x] = rowDist[x] < d[x] ? static_cast<Label>(c) : oldLabel;
+                    }
+                    for(int x=0; x<width; ++x)
+                        d[x] = std::min(d[x], rowDist[x]);
+                }
             }
         }
-    }
+    );
 }
 
 template <unsigned int N, class T, class Label>
@@ -415,7 +528,9 @@ Slic<N, T, Label>::postProcessing()
     
     The options object can be used to specify the number of iterations (<tt>SlicOptions::iterations()</tt>)
     and an explicit minimal superpixel size (<tt>SlicOptions::minSize()</tt>). By default, the algorithm 
-    merges all regions that are smaller than 1/4 of the average superpixel size.
+    merges all regions that are smaller than 1/4 of the average superpixel size. The algorithm uses
+    as many threads as there are cores unless <tt>SlicOptions::numThreads()</tt> says otherwise
+    (the result is the same for any number of threads).
     
     The function returns the number of superpixels, which equals the largest label 
     because labeling starts at 1.
@@ -0,0 +1,244 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2015 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_THREADPOOL_HXX
+#define VIGRA_THREADPOOL_HXX
+
+#include <vector>
+#include <exception>
+#include <algorithm>
+#include "config.hxx"
+#include "error.hxx"
+#include "multi_shape.hxx"
+#include "threading.hxx"
+
+namespace vigra {
+
+/** \addtogroup ParallelProcessing Functions and classes for parallel processing.
+*/
+
+//@{
+
+    /**\brief Option base class for parallel algorithms.
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+    */
+class ParallelOptions
+{
+  public:
+
+        /** Constants for special settings.
+        */
+    enum {
+        Auto       = -1, ///< Determine number of threads automatically (from <tt>threading::thread::hardware_concurrency()</tt>)
+        Nice       = -2, ///< Use half as many threads as <tt>Auto</tt> would.
+        NoThreads  =  0  ///< Switch off multi-threading (i.e. execute tasks sequentially)
+    };
+
+    ParallelOptions()
+    : numThreads_(actualNumThreads(Auto))
+    {}
+
+        /** \brief Get desired number of threads.
+
+            <b>Note:</b> This function may return 0, which means that multi-threading
+            shall be switched off entirely. If an algorithm receives this value,
+            it should revert to a sequential implementation. In contrast, if
+            <tt>numThread() == 1</tt>, the parallel algorithm version shall be
+            executed with a single thread.
+        */
+    int getNumThreads() const
+    {
+        return numThreads_;
+    }
+
+        /** \brief Get desired number of threads.
+
+            In contrast to <tt>numThread()</tt>, this will always return a value <tt>>=1</tt>.
+        */
+    int getActualNumThreads() const
+    {
+        return std::max(1, numThreads_);
+    }
+
+        /** \brief Set the number of threads or one of the constants <tt>Auto</tt>,
+                   <tt>Nice</tt> and <tt>NoThreads</tt>.
+
+            Default: <tt>ParallelOptions::Auto</tt> (use system default)
+
+            This setting is ignored if the preprocessor flag <tt>VIGRA_SINGLE_THREADED</tt>
+            is defined. Then, the number of threads is set to 0 and all tasks revert to
+            sequential algorithm implementations.
+        */
+    ParallelOptions & numThreads(const int n)
+    {
+        numThreads_ = actualNumThreads(n);
+        return *this;
+    }
+
+  private:
+        // helper function to compute the actual number of threads
+    static int actualNumThreads(const int userNThreads)
+    {
+#ifdef VIGRA_SINGLE_THREADED
+        return 0;
+#else
+        return userNThreads >= 0
+                   ? userNThreads
+                   : userNThreads == Nice
+                           ? (int)threading::thread::hardware_concurrency() / 2
+                           : (int)threading::thread::hardware_concurrency();
+#endif
+    }
+
+    int numThreads_;
+};
+
+namespace detail {
+
+#ifndef VIGRA_SINGLE_THREADED
+
+template <class FUNCTOR>
+struct ParallelForeachWorker
+{
+    FUNCTOR & f_;
+    threading::atomic_long & next_;
+    MultiArrayIndex size_;
+    int threadId_;
+    std::exception_ptr & error_;
+
+    ParallelForeachWorker(FUNCTOR & f, threading::atomic_long & next, MultiArrayIndex size,
+                          int threadId, std::exception_ptr & error)
+    : f_(f), next_(next), size_(size), threadId_(threadId), error_(error)
+    {}
+
+    void operator()()
+    {
+        try
+        {
+            for(MultiArrayIndex i = next_.fetch_add(1); i < size_; i = next_.fetch_add(1))
+                f_(threadId_, i);
+        }
+        catch(...)
+        {
+            error_ = std::current_exception();
+            next_.store(size_); // let the other threads terminate early
+        }
+    }
+};
+
+#endif // not VIGRA_SINGLE_THREADED
+
+} // namespace detail
+
+/** \brief Apply a functor to all indices in the range <tt>[0, size)</tt> in parallel.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <class FUNCTOR>
+        void parallel_foreach(ParallelOptions const & options,
+                              MultiArrayIndex size, FUNCTOR f);
+    }
+    \endcode
+
+    The functor is called as <tt>f(threadId, i)</tt>, where <tt>threadId</tt> is
+    in the range <tt>[0, options.getActualNumThreads())</tt> and identifies the calling
+    thread, and <tt>i</tt> is the current index. The <tt>threadId</tt> allows the functor
+    to maintain thread-local state (e.g. one accumulator per thread) without locking.
+    Indices are handed out dynamically, i.e. the assignment of indices to threads
+    is not deterministic. If <tt>options.getNumThreads() <= 1</tt>, the loop is
+    executed sequentially in the calling thread. An exception thrown by the functor
+    stops the loop and is re-thrown in the calling thread after all workers
+    have finished.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/threadpool.hxx\><br>
+    Namespace: vigra
+
+    \code
+    struct SumPerThread
+    {
+        MultiArrayView<1, double> data;
+        std::vector<double> & sums;  // one entry per thread
+
+        void operator()(int threadId, MultiArrayIndex i)
+        {
+            sums[threadId] += data[i];
+        }
+    };
+
+    ParallelOptions options;
+    std::vector<double> sums(options.getActualNumThreads(), 0.0);
+    SumPerThread f = { data, sums };
+    parallel_foreach(options, data.size(), f);
+    \endcode
+*/
+template <class FUNCTOR>
+void parallel_foreach(ParallelOptions const & options, MultiArrayIndex size, FUNCTOR f)
+{
+#ifndef VIGRA_SINGLE_THREADED
+    int nThreads = (int)std::min<MultiArrayIndex>(options.getNumThreads(), size);
+    if(nThreads > 1)
+    {
+        threading::atomic_long next(0);
+        std::vector<std::exception_ptr> errors(nThreads);
+        std::vector<threading::thread *> threads(nThreads);
+        for(int k=0; k<nThreads; ++k)
+            threads[k] = new threading::thread(
+                   detail::ParallelForeachWorker<FUNCTOR>(f, next, size, k, errors[k]));
+        for(int k=0; k<nThreads; ++k)
+        {
+            threads[k]->join();
+            delete threads[k];
+        }
+        for(int k=0; k<nThreads; ++k)
+            if(errors[k])
+                std::rethrow_exception(errors[k]);
+        return;
+    }
+#endif // not VIGRA_SINGLE_THREADED
+    for(MultiArrayIndex i=0; i<size; ++i)
+        f(0, i);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_THREADPOOL_HXX
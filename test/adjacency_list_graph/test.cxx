@@ -38,6 +38,7 @@
 #include "vigra/stdimage.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/adjacency_list_graph.hxx"
+#include "vigra/random.hxx"
 
 using namespace vigra;
 
@@ -1173,6 +1174,76 @@ struct AdjacencyListGraphTest{
     }
 
 
+    void adjGraphFreezeTest()
+    {
+        // random graph with a gap in the node ids
+        GraphType g(0,0);
+        vigra::RandomMT19937 random(42);
+        for(int i=0; i<60; ++i){
+            const GraphType::index_type u = random.uniformInt(40);
+            const GraphType::index_type v = random.uniformInt(40);
+            if(u!=v && u!=17 && v!=17)
+                g.addEdge(u,v);
+        }
+        should(g.nodeFromId(17)==lemon::INVALID);
+
+        // reference adjacency before freezing
+        std::vector<std::vector<Edge> > incEdges(g.maxNodeId()+1);
+        std::vector<std::vector<Node> > neighbors(g.maxNodeId()+1);
+        std::vector<std::vector<Arc> >  outArcs(g.maxNodeId()+1);
+        for(NodeIt n(g); n!=lemon::INVALID; ++n){
+            incEdges[g.id(*n)].assign(IncEdgeIt(g,*n), IncEdgeIt(lemon::INVALID));
+            neighbors[g.id(*n)].assign(NeighborNodeIt(g,*n), NeighborNodeIt(lemon::INVALID));
+            outArcs[g.id(*n)].assign(OutArcIt(g,*n), OutArcIt(lemon::INVALID));
+        }
+        const GraphType::index_type nodeNum = g.nodeNum(), edgeNum = g.edgeNum();
+        const size_t maxDegree = g.maxDegree();
+
+        should(!g.isFrozen());
+        g.freeze();
+        should(g.isFrozen());
+
+        shouldEqual(g.nodeNum(), nodeNum);
+        shouldEqual(g.edgeNum(), edgeNum);
+        shouldEqual(g.maxDegree(), maxDegree);
+        should(g.nodeFromId(17)==lemon::INVALID);
+        for(NodeIt n(g); n!=lemon::INVALID; ++n){
+            const GraphType::index_type id = g.id(*n);
+            shouldEqual(g.degree(*n), incEdges[id].size());
+            shouldEqualSequence(incEdges[id].begin(), incEdges[id].end(), IncEdgeIt(g,*n));
+            shouldEqualSequence(neighbors[id].begin(), neighbors[id].end(), NeighborNodeIt(g,*n));
+            should(std::equal(outArcs[id].begin(), outArcs[id].end(), OutArcIt(g,*n)));
+            for(size_t k=0; k<neighbors[id].size(); ++k){
+                shouldEqual(g.findEdge(*n, neighbors[id][k]), incEdges[id][k]);
+                shouldEqual(g.findEdge(neighbors[id][k], *n), incEdges[id][k]);
+            }
+        }
+        for(EdgeIt e(g); e!=lemon::INVALID; ++e){
+            shouldEqual(g.findEdge(g.u(*e), g.v(*e)), *e);
+        }
+        should(g.findEdge(g.nodeFromId(0), g.nodeFromId(0))==lemon::INVALID);
+
+        // a frozen graph cannot be modified
+        try{
+            g.addNode();
+            failTest("AdjacencyListGraph::addNode() didn't throw on frozen graph.");
+        }
+        catch(PreconditionViolation &){}
+        try{
+            g.addEdge(g.nodeFromId(0), g.nodeFromId(1));
+            failTest("AdjacencyListGraph::addEdge() didn't throw on frozen graph.");
+        }
+        catch(PreconditionViolation &){}
+
+        // copies share the frozen state
+        GraphType g2(g);
+        should(g2.isFrozen());
+        for(NodeIt n(g2); n!=lemon::INVALID; ++n){
+            const GraphType::index_type id = g2.id(*n);
+            shouldEqualSequence(incEdges[id].begin(), incEdges[id].end(), IncEdgeIt(g2,*n));
+        }
+    }
+
     void adjGraphIncEdgeItTestStart0()
     {
         // 1 |3
@@ -1529,6 +1600,7 @@ struct AdjacencyListGraphTestSuite
 
         add( testCase( &AdjacencyListGraphTest::adjGraphArcTest));
         add( testCase( &AdjacencyListGraphTest::adjGraphArcItTest));
+        add( testCase( &AdjacencyListGraphTest::adjGraphFreezeTest));
         //add( testCase( &AdjacencyListGraphTest::adjGraphInArcItTest));
         //add( testCase( &AdjacencyListGraphTest::adjGraphOutArcItTest));
 
@@ -44,8 +44,12 @@
 #include <fstream>
 #include <functional>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
 #include <vigra/random_forest.hxx>
 #include <vigra/random_forest_deprec.hxx>
+#include <vigra/random_forest_blockwise.hxx>
 #include <vigra/multi_math.hxx>
 #include <vigra/unittest.hxx>
 #include <vector>
@@ -60,6 +64,9 @@
 
 
 #include <stdlib.h>
+#ifndef _WIN32
+# include <unistd.h>
+#endif
 
 #ifdef HasHDF5
 # include <vigra/hdf5impex.hxx>
@@ -71,6 +78,39 @@
 
 using namespace vigra;
 
+    // A unique file in the temporary directory that is removed when the 
+    // guard goes out of scope, i.e. also when a test assertion fails.
+struct TemporaryFile
+{
+    std::string name;
+
+    explicit TemporaryFile(std::string const & prefix)
+    {
+#ifdef _WIN32
+        char const * dir = getenv("TEMP");
+        char buffer[MAX_PATH];
+        GetTempFileNameA(dir ? dir : ".", prefix.substr(0, 3).c_str(), 0, buffer);
+        name = buffer;
+#else
+        char const * dir = getenv("TMPDIR");
+        name = std::string(dir ? dir : "/tmp") + "/" + prefix + "_XXXXXX";
+        int file = mkstemp(&name[0]);
+        vigra_postcondition(file != -1, "TemporaryFile: unable to create '" + name + "'.");
+        close(file);
+#endif
+    }
+
+    ~TemporaryFile()
+    {
+        std::remove(name.c_str());
+    }
+
+    char const * c_str() const
+    {
+        return name.c_str();
+    }
+};
+
 
 struct UnaryRandomFunctor
 {
@@ -573,6 +613,24 @@ struct ClassifierTest
             shouldEqualTolerance(dble_labels[jj], data.labels(ii)[jj], 0.01);
             shouldEqualTolerance(int_labels[jj], data.labels(ii)[jj], 0.01);
         }
+
+        // StopIfCertain with proportion 1 must not change the labels
+        for(int weighted = 0; weighted < 2; ++weighted)
+        {
+            RF2.set_options().predict_weighted_ = weighted;
+            MultiArray<2, double> full_labels(dble_labels.shape()), 
+                                  early_labels(dble_labels.shape());
+            RF2.predictLabels(data.features(ii), full_labels);
+            StopIfCertain stopIfCertain;
+            RF2.predictLabels(data.features(ii), early_labels, stopIfCertain);
+            shouldEqualSequence(early_labels.begin(), early_labels.end(), full_labels.begin());
+            shouldEqual((MultiArrayIndex)stopIfCertain.depths.size(), data.features(ii).shape(0));
+            double meanDepth = std::accumulate(stopIfCertain.depths.begin(), 
+                                               stopIfCertain.depths.end(), 0.0) 
+                                  / stopIfCertain.depths.size();
+            should(meanDepth < 1.0);
+        }
+        RF2.set_options().predict_weighted_ = 0;
         std::cerr << "done \n";
     }
 
@@ -776,6 +834,501 @@ struct ClassifierTest
         std::cerr << "DONE!\n\n";
     }
 
+    void RFparallelLearnTest()
+    {
+        std::cerr << "RFparallelLearnTest(): Learning with several threads\n";
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        
+        int thread_counts[] = { 2, 4, 3 };
+        vigra::RandomForest<> RF[3];
+        rf::visitors::OOB_Error oob[3];
+        rf::visitors::VariableImportanceVisitor var_imp[3] = { 1, 1, 1 };
+        rf::visitors::CompleteOOBInfo complete_oob[3];
+        for(int k = 0; k < 3; ++k)
+        {
+            RF[k] = vigra::RandomForest<>(vigra::RandomForestOptions()
+                                              .tree_count(32)
+                                              .n_threads(thread_counts[k]));
+            RF[k].learn(data.features(ii),
+                        data.labels(ii),
+                        rf::visitors::create_visitor(oob[k], var_imp[k], complete_oob[k]),
+                        rf_default(),
+                        rf_default(),
+                        vigra::RandomMT19937(1));
+        }
+        
+        // the forest must not depend on the number of threads
+        for(int k = 1; k < 3; ++k)
+        {
+            shouldEqual(RF[k].tree_count(), 32);
+            for(int jj = 0; jj < RF[0].tree_count(); ++jj)
+            {
+                should(RF[0].tree(jj).topology_ == RF[k].tree(jj).topology_);
+                should(RF[0].tree(jj).parameters_ == RF[k].tree(jj).parameters_);
+            }
+            // the visitors see the trees in the order in which they are finished,
+            // so sums over the trees may differ by round-off (and flip near-ties)
+            double votes = 1.0 / rowCount(data.features(ii));
+            shouldEqualTolerance(oob[0].oob_breiman, oob[k].oob_breiman, 2.0*votes);
+            shouldEqualSequenceTolerance(var_imp[0].variable_importance_.begin(), 
+                                         var_imp[0].variable_importance_.end(),
+                                         var_imp[k].variable_importance_.begin(), 1e-10);
+            shouldEqualTolerance(complete_oob[0].oob_breiman, complete_oob[k].oob_breiman, 2.0*votes);
+            shouldEqualTolerance(complete_oob[0].oob_per_tree2, complete_oob[k].oob_per_tree2, 1e-10);
+            shouldEqualSequence(complete_oob[0].oob_per_tree.begin(), complete_oob[0].oob_per_tree.end(),
+                                complete_oob[k].oob_per_tree.begin());
+            MultiArrayView<3, double> lastRoc0 = complete_oob[0].oobroc_per_tree.bindOuter(31),
+                                      lastRoc  = complete_oob[k].oobroc_per_tree.bindOuter(31);
+            shouldEqualSequenceTolerance(lastRoc0.begin(), lastRoc0.end(), lastRoc.begin(), 2.0*votes);
+        }
+        shouldEqual(complete_oob[0].oob_breiman, oob[0].oob_breiman);
+
+        // check the ROC of the last tree against the definition
+        {
+            rf::visitors::CompleteOOBInfo const & info = complete_oob[1];
+            int thresholds = info.oobroc_per_tree.shape(2), 
+                last = info.oobroc_per_tree.shape(3) - 1;
+            shouldEqual(thresholds, 32);
+            MultiArray<3, double> roc(Shape3(2, 2, thresholds));
+            double totalOobCount = 0.0;
+            for(int ll = 0; ll < info.oobCount.size(); ++ll)
+            {
+                if(info.oobCount[ll] == 0)
+                    continue;
+                ++totalOobCount;
+                int label = RF[1].ext_param_.to_classIndex(data.labels(ii)(ll, 0));
+                for(int gg = 0; gg < thresholds; ++gg)
+                    roc(label, info.prob_oob(ll, 1) > double(gg)/double(thresholds) ? 1 : 0, gg) += 1;
+            }
+            roc /= totalOobCount;
+            shouldEqualSequence(roc.begin(), roc.end(), info.oobroc_per_tree.bindOuter(last).begin());
+        }
+        // different trees must have different random streams
+        should(RF[0].tree(0).topology_ != RF[0].tree(1).topology_ || 
+               RF[0].tree(0).parameters_ != RF[0].tree(1).parameters_);
+        
+        // sequential learning gives a different, but equally good forest
+        rf::visitors::OOB_Error oob_sequential;
+        vigra::RandomForest<> RF_sequential(vigra::RandomForestOptions().tree_count(32));
+        RF_sequential.learn(data.features(ii),
+                            data.labels(ii),
+                            rf::visitors::create_visitor(oob_sequential),
+                            rf_default(),
+                            rf_default(),
+                            vigra::RandomMT19937(1));
+        shouldEqualTolerance(oob[0].oob_breiman, oob_sequential.oob_breiman, 0.05);
+        
+        try
+        {
+            vigra::RandomForest<> RF_online(vigra::RandomForestOptions()
+                                                .prepare_online_learning(true)
+                                                .n_threads(2));
+            RF_online.learn(data.features(ii), data.labels(ii));
+            failTest("RandomForest::learn() didn't throw with online learning and several threads.");
+        }
+        catch(PreconditionViolation &)
+        {}
+        std::cerr << "DONE!\n\n";
+    }
+
+    void RFparallelPredictTest()
+    {
+        std::cerr << "RFparallelPredictTest(): Predicting with several threads\n";
+        int ii = data.size() - 3; // this is the pina_indians dataset
+
+        vigra::RandomForest<> RF(vigra::RandomForestOptions().tree_count(32));
+        RF.learn(data.features(ii), data.labels(ii),
+                 rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+
+        MultiArray<2, double> features(data.features(ii));
+        features(5, 2) = std::numeric_limits<double>::quiet_NaN();
+        int rows = rowCount(features), classes = RF.class_count();
+
+        // reference: the row-by-row code path with an explicit stopping criterion
+        MultiArray<2, double> prob_ref(Shape2(rows, classes));
+        EarlyStoppStd stop(RF.options());
+        RF.predictProbabilities(features, prob_ref, stop);
+
+        int thread_counts[] = { 1, 4, 0 };
+        for(int k = 0; k < 3; ++k)
+        {
+            RF.set_options().n_threads(thread_counts[k]);
+
+            MultiArray<2, double> prob(Shape2(rows, classes));
+            RF.predictProbabilities(features, prob);
+            shouldEqualSequence(prob.begin(), prob.end(), prob_ref.begin());
+            shouldEqual(prob(5, 0), 0.0);
+
+            MultiArray<2, float> prob_float(Shape2(rows, classes));
+            RF.predictProbabilities(features, prob_float);
+            for(int j = 0; j < rows; ++j)
+                shouldEqualTolerance(prob_float(j, 0), prob_ref(j, 0), 1e-6);
+
+            MultiArray<2, double> labels(Shape2(rows, 1));
+            RF.predictLabels(features, labels, -1.0);
+            for(int j = 0; j < rows; ++j)
+            {
+                if(j == 5)
+                    shouldEqual(labels(j, 0), -1.0);
+                else
+                    shouldEqual(labels(j, 0), RF.predictLabel(rowVector(features, j)));
+            }
+
+            try
+            {
+                RF.predictLabels(features, labels);
+                failTest("RandomForest::predictLabels() didn't throw on NaN.");
+            }
+            catch(PreconditionViolation &)
+            {}
+        }
+        std::cerr << "DONE!\n\n";
+    }
+
+    void RFcompiledTest()
+    {
+        std::cerr << "RFcompiledTest(): Prediction with compiled forests\n";
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        TemporaryFile file("vigra_compiled_forest");
+
+        MultiArray<2, double> features(data.features(ii));
+        MultiArray<2, float>  ffeatures(data.features(ii));
+        features(5, 2) = std::numeric_limits<double>::quiet_NaN();
+        ffeatures(5, 2) = std::numeric_limits<float>::quiet_NaN();
+        int rows = rowCount(features);
+
+        for(int weighted = 0; weighted < 2; ++weighted)
+        {
+            RandomForestOptions options = RandomForestOptions().tree_count(32);
+            if(weighted)
+                options.predict_weighted();
+
+            // double features require double thresholds for identical results
+            vigra::RandomForest<> RF(options);
+            RF.learn(data.features(ii), data.labels(ii),
+                     rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+            int classes = RF.class_count();
+
+            CompiledRandomForest<double, double> compiled(RF);
+            shouldEqual(compiled.tree_count(), 32);
+            shouldEqual(compiled.class_count(), classes);
+            shouldEqual(compiled.node_count(), 2*compiled.leaf_count() - compiled.tree_count());
+
+            MultiArray<2, double> prob_ref(Shape2(rows, classes)), prob(Shape2(rows, classes));
+            RF.predictProbabilities(features, prob_ref);
+            MultiArray<2, double> labels_ref(Shape2(rows, 1)), labels(Shape2(rows, 1));
+            RF.predictLabels(features, labels_ref, -1.0);
+
+            int thread_counts[] = { 1, 4 };
+            for(int k = 0; k < 2; ++k)
+            {
+                compiled.n_threads(thread_counts[k]);
+                compiled.predictProbabilities(features, prob);
+                shouldEqualSequence(prob.begin(), prob.end(), prob_ref.begin());
+                compiled.predictLabels(features, labels, -1.0);
+                shouldEqualSequence(labels.begin(), labels.end(), labels_ref.begin());
+                shouldEqual(labels(5, 0), -1.0);
+            }
+            shouldEqual(compiled.predictLabel(rowVector(features, 0)), labels_ref(0, 0));
+            try
+            {
+                compiled.predictLabels(features, labels);
+                failTest("CompiledRandomForest::predictLabels() didn't throw on NaN.");
+            }
+            catch(PreconditionViolation &)
+            {}
+
+            // float features and float thresholds give identical results as well
+            vigra::RandomForest<> RF_float(options);
+            RF_float.learn(MultiArray<2, float>(data.features(ii)), data.labels(ii),
+                           rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+            RF_float.predictProbabilities(ffeatures, prob_ref);
+
+            CompiledRandomForest<> compiled_float(RF_float);
+            compiled_float.predictProbabilities(ffeatures, prob);
+            shouldEqualSequence(prob.begin(), prob.end(), prob_ref.begin());
+
+            // save and load (memory-mapped and copied)
+            compiled_float.save(file.name);
+            for(int memoryMap = 0; memoryMap < 2; ++memoryMap)
+            {
+                CompiledRandomForest<> loaded;
+                loaded.load(file.c_str(), memoryMap == 1);
+                shouldEqual(loaded.tree_count(), compiled_float.tree_count());
+                shouldEqual(loaded.node_count(), compiled_float.node_count());
+                shouldEqual(loaded.leaf_count(), compiled_float.leaf_count());
+                should(loaded.ext_param_ == compiled_float.ext_param_);
+                prob.init(0.0);
+                loaded.predictProbabilities(ffeatures, prob);
+                shouldEqualSequence(prob.begin(), prob.end(), prob_ref.begin());
+
+                // copies share the data
+                CompiledRandomForest<> copy(loaded);
+                loaded = CompiledRandomForest<>();
+                prob.init(0.0);
+                copy.predictProbabilities(ffeatures, prob);
+                shouldEqualSequence(prob.begin(), prob.end(), prob_ref.begin());
+            }
+            try
+            {
+                CompiledRandomForest<double, double> wrongType;
+                wrongType.load(file.c_str());
+                failTest("CompiledRandomForest::load() didn't detect wrong ThresholdType.");
+            }
+            catch(PreconditionViolation &)
+            {}
+
+            // out-of-range node and leaf indices are detected at load time
+            std::string content;
+            {
+                std::ifstream in(file.c_str(), std::ios::binary);
+                content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+            detail::RF_CompiledHeader header;
+            std::memcpy(&header, content.data(), sizeof(header));
+            Int32 root;
+            std::memcpy(&root, content.data() + header.roots_offset_, sizeof(Int32));
+            std::size_t childOffset = header.nodes_offset_ + root*sizeof(detail::RF_CompiledNode<float>)
+                                        + offsetof(detail::RF_CompiledNode<float>, child_),
+                        leafOffset  = header.leaf_index_offset_ + (header.node_count_-1)*sizeof(Int32);
+            Int32 badIndex = 1 << 30;
+            for(int k = 0; k < 2; ++k)
+            {
+                std::string corrupted(content);
+                std::memcpy(&corrupted[k == 0 ? childOffset : leafOffset], &badIndex, sizeof(Int32));
+                {
+                    std::ofstream out(file.c_str(), std::ios::binary);
+                    out.write(corrupted.data(), corrupted.size());
+                }
+                try
+                {
+                    CompiledRandomForest<> corruptedForest;
+                    corruptedForest.load(file.c_str());
+                    failTest("CompiledRandomForest::load() didn't detect out-of-range index.");
+                }
+                catch(PreconditionViolation &)
+                {}
+            }
+        }
+
+        {
+            std::ofstream out(file.c_str());
+            out << "not a random forest, but long enough to contain a header";
+        }
+        try
+        {
+            CompiledRandomForest<> invalid;
+            invalid.load(file.c_str());
+            failTest("CompiledRandomForest::load() didn't detect invalid file.");
+        }
+        catch(PreconditionViolation &)
+        {}
+        std::cerr << "DONE!\n\n";
+    }
+
+    void RFstridedFeaturesTest()
+    {
+        std::cerr << "RFstridedFeaturesTest(): Learning on strided float32 views\n";
+
+        // row-major storage, as e.g. from numpy: the feature matrix is a
+        // transposed (strided) view that must be used without copying
+        MultiArray<2, float> storage(Shape2(6, 300));
+        MultiArray<2, int>   labels(Shape2(300, 1));
+        vigra::RandomMT19937 random(42);
+        for(int i = 0; i < 300; ++i)
+        {
+            for(int j = 0; j < 6; ++j)
+                storage(j, i) = (float)random.uniform(-1.0, 1.0);
+            labels(i, 0) = (storage(0, i) + storage(1, i) > 0.0) ? 1 : 0;
+        }
+        MultiArrayView<2, float, StridedArrayTag> features = storage.transpose();
+        MultiArray<2, float> contiguous(features);
+
+        vigra::RandomForest<int> RF_strided(vigra::RandomForestOptions().tree_count(10));
+        RF_strided.learn(features, labels, rf_default(), rf_default(), rf_default(),
+                         vigra::RandomMT19937(1));
+        vigra::RandomForest<int> RF_contiguous(vigra::RandomForestOptions().tree_count(10));
+        RF_contiguous.learn(contiguous, labels, rf_default(), rf_default(), rf_default(),
+                            vigra::RandomMT19937(1));
+        for(int k = 0; k < 10; ++k)
+        {
+            should(RF_strided.tree(k).topology_ == RF_contiguous.tree(k).topology_);
+            should(RF_strided.tree(k).parameters_ == RF_contiguous.tree(k).parameters_);
+        }
+
+        shouldEqual(detail::find_non_finite(features), detail::AllFinite);
+        storage(3, 200) = std::numeric_limits<float>::infinity();
+        shouldEqual(detail::find_non_finite(features), detail::ContainsInf);
+        storage(2, 100) = std::numeric_limits<float>::quiet_NaN();
+        shouldEqual(detail::find_non_finite(features), detail::ContainsNaN);
+        try
+        {
+            RF_strided.learn(features, labels);
+            failTest("RandomForest::learn() failed to detect NaN in strided features.");
+        }
+        catch(vigra::PreconditionViolation &) {}
+    }
+
+    void RFbinnedTest()
+    {
+        std::cerr << "RFbinnedTest(): Learning on binned features\n";
+
+        // with few distinct values, binning must not change the forest
+        MultiArray<2, double> features(Shape2(500, 6));
+        MultiArray<2, int>    labels(Shape2(500, 1));
+        vigra::RandomMT19937 random(42);
+        for(int i = 0; i < 500; ++i)
+        {
+            for(int j = 0; j < 6; ++j)
+                features(i, j) = (int)random.uniformInt(40) - 10;
+            labels(i, 0) = (features(i, 0) + features(i, 1) > 20 + (int)random.uniformInt(5))
+                               ? 1
+                               : 0;
+        }
+
+        FeatureBinning binning;
+        binning.learn(features);
+        shouldEqual(binning.columnCount(), 6);
+        MultiArray<2, UInt8> binned(features.shape());
+        binning.transform(features, binned);
+        for(int j = 0; j < 6; ++j)
+        {
+            shouldEqual(binning.binCount(j), 40);
+            shouldEqual((int)binned(0, j), features(0, j) + 10);
+        }
+
+        vigra::RandomForest<int> RF_exact(vigra::RandomForestOptions().tree_count(10));
+        RF_exact.learn(features, labels, rf_default(), rf_default(), rf_default(),
+                       vigra::RandomMT19937(1));
+
+        vigra::RandomForest<int> RF_hist(vigra::RandomForestOptions().tree_count(10));
+        RF_hist.learn(binned, labels, rf_default(), rf_default(), rf_default(),
+                      vigra::RandomMT19937(1));
+        binning.convertThresholds(RF_hist);
+
+        vigra::RandomForest<int> RF_binned(vigra::RandomForestOptions().tree_count(10)
+                                                                       .feature_bins(256));
+        RF_binned.learn(features, labels, rf_default(), rf_default(), rf_default(),
+                        vigra::RandomMT19937(1));
+
+        // (thresholds may differ between values that don't occur in the data)
+        for(int k = 0; k < 10; ++k)
+        {
+            should(RF_exact.tree(k).topology_ == RF_hist.tree(k).topology_);
+            should(RF_exact.tree(k).topology_ == RF_binned.tree(k).topology_);
+            shouldEqual(RF_hist.tree(k).parameters_.size(), RF_binned.tree(k).parameters_.size());
+            shouldEqualSequence(RF_hist.tree(k).parameters_.begin(), RF_hist.tree(k).parameters_.end(),
+                                RF_binned.tree(k).parameters_.begin());
+        }
+        MultiArray<2, double> prob_exact(Shape2(500, 2)), prob_hist(Shape2(500, 2));
+        RF_exact.predictProbabilities(features, prob_exact);
+        RF_hist.predictProbabilities(features, prob_hist);
+        shouldEqualSequence(prob_exact.begin(), prob_exact.end(), prob_hist.begin());
+
+        // with more distinct values, the forest learned on bins gives the same
+        // predictions on raw features (after threshold conversion) as on binned features
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        FeatureBinning binning16(16);
+        binning16.learn(data.features(ii));
+        MultiArray<2, UInt8> binned16(data.features(ii).shape());
+        binning16.transform(data.features(ii), binned16);
+        for(int j = 0; j < binning16.columnCount(); ++j)
+            should(binning16.binCount(j) <= 16);
+
+        vigra::RandomForest<> RF16(vigra::RandomForestOptions().tree_count(32));
+        RF16.learn(binned16, data.labels(ii));
+        MultiArray<2, double> prob_binned(Shape2(binned16.shape(0), RF16.class_count())),
+                              prob_raw(prob_binned.shape());
+        RF16.predictProbabilities(binned16, prob_binned);
+        binning16.convertThresholds(RF16);
+        RF16.predictProbabilities(data.features(ii), prob_raw);
+        shouldEqualSequence(prob_binned.begin(), prob_binned.end(), prob_raw.begin());
+
+        // binning gives a comparable out-of-bag error
+        rf::visitors::OOB_Error oob_exact, oob_binned;
+        vigra::RandomForest<> RF_pina(vigra::RandomForestOptions().tree_count(64));
+        RF_pina.learn(data.features(ii), data.labels(ii),
+                      rf::visitors::create_visitor(oob_exact),
+                      rf_default(), rf_default(), vigra::RandomMT19937(1));
+        vigra::RandomForest<> RF_pina_binned(vigra::RandomForestOptions().tree_count(64)
+                                                                         .feature_bins(32));
+        RF_pina_binned.learn(data.features(ii), data.labels(ii),
+                             rf::visitors::create_visitor(oob_binned),
+                             rf_default(), rf_default(), vigra::RandomMT19937(1));
+        shouldEqualTolerance(oob_exact.oob_breiman, oob_binned.oob_breiman, 0.05);
+        std::cerr << "DONE!\n\n";
+    }
+
+    void RFimagePredictTest()
+    {
+        std::cerr << "RFimagePredictTest(): Prediction on feature images\n";
+        int ii = data.size() - 3; // this is the pina_indians dataset
+
+        MultiArray<2, float> matrix(data.features(ii));
+        matrix(5, 2) = std::numeric_limits<float>::quiet_NaN();
+        int columns = columnCount(matrix),
+            w = 16, h = rowCount(matrix) / w, rows = w*h;
+        matrix = MultiArray<2, float>(matrix.subarray(Shape2(0, 0), Shape2(rows, columns)));
+
+        vigra::RandomForest<> RF(vigra::RandomForestOptions().tree_count(32));
+        RF.learn(MultiArray<2, float>(data.features(ii)), data.labels(ii),
+                 rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+        CompiledRandomForest<> compiled(RF);
+        int classes = RF.class_count();
+
+        MultiArray<2, float> prob_ref(Shape2(rows, classes));
+        RF.predictProbabilities(matrix, prob_ref);
+
+        // the feature image has an additional channel that must be ignored
+        MultiArray<3, float> features(Shape3(w, h, columns + 1), -1.0f);
+        ChunkedArrayLazy<3, float> chunked_features(features.shape(), Shape3(4, 8, 2));
+        for(int y = 0; y < h; ++y)
+            for(int x = 0; x < w; ++x)
+                for(int c = 0; c < columns; ++c)
+                    features(x, y, c) = matrix(x + w*y, c);
+        chunked_features.commitSubarray(Shape3(0), features);
+
+        MultiArray<3, float> prob(Shape3(w, h, classes)), chunked_result(prob.shape());
+        ChunkedArrayLazy<3, float> chunked_prob(prob.shape(), Shape3(8, 4, 1));
+
+        int thread_counts[] = { 1, 4 };
+        for(int k = 0; k < 2; ++k)
+        {
+            ParallelOptions options = ParallelOptions().numThreads(thread_counts[k]);
+
+            prob = 0.0f;
+            predictProbabilities(RF, MultiArrayView<3, Multiband<float> >(features),
+                                     MultiArrayView<3, Multiband<float> >(prob), options);
+            for(int l = 0; l < classes; ++l)
+                shouldEqualSequence(prob.bindOuter(l).begin(), prob.bindOuter(l).end(),
+                                    prob_ref.bindOuter(l).begin());
+
+            prob = 0.0f;
+            predictProbabilities(compiled, MultiArrayView<3, Multiband<float> >(features),
+                                           MultiArrayView<3, Multiband<float> >(prob), options);
+            for(int l = 0; l < classes; ++l)
+                shouldEqualSequence(prob.bindOuter(l).begin(), prob.bindOuter(l).end(),
+                                    prob_ref.bindOuter(l).begin());
+
+            predictProbabilities(RF, chunked_features, chunked_prob, options);
+            chunked_prob.checkoutSubarray(Shape3(0), chunked_result);
+            for(int l = 0; l < classes; ++l)
+                shouldEqualSequence(chunked_result.bindOuter(l).begin(), chunked_result.bindOuter(l).end(),
+                                    prob_ref.bindOuter(l).begin());
+
+            predictProbabilities(compiled, chunked_features, chunked_prob, options);
+            chunked_prob.checkoutSubarray(Shape3(0), chunked_result);
+            for(int l = 0; l < classes; ++l)
+                shouldEqualSequence(chunked_result.bindOuter(l).begin(), chunked_result.bindOuter(l).end(),
+                                    prob_ref.bindOuter(l).begin());
+        }
+
+        // pixels containing NaN get zero probabilities
+        shouldEqual(prob(5, 0, 0), 0.0f);
+        shouldEqual(chunked_result(5, 0, 0), 0.0f);
+        std::cerr << "DONE!\n\n";
+    }
+
     void RFwrongLabelTest()
     {
         double rawfeatures [] = 
@@ -1072,6 +1625,12 @@ struct ClassifierTestSuite
 #endif
         add( testCase( &ClassifierTest::RFresponseTest));
         add( testCase( &ClassifierTest::RFDepthAndSizeEarlyStopTest));
+        add( testCase( &ClassifierTest::RFparallelLearnTest));
+        add( testCase( &ClassifierTest::RFparallelPredictTest));
+        add( testCase( &ClassifierTest::RFcompiledTest));
+        add( testCase( &ClassifierTest::RFstridedFeaturesTest));
+        add( testCase( &ClassifierTest::RFbinnedTest));
+        add( testCase( &ClassifierTest::RFimagePredictTest));
 
         add( testCase( &ClassifierTest::RFridgeRegressionTest));
         add( testCase( &ClassifierTest::RFSplitFunctorTest));
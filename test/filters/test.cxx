@@ -13,6 +13,7 @@
 #include "vigra/impex.hxx"
 
 #include "vigra/medianfilter.hxx"
+#include "vigra/flatmorphology.hxx"
 #include "vigra/shockfilter.hxx"
 #include "vigra/specklefilters.hxx"
 
@@ -225,6 +226,110 @@ struct MedianFilterExactTest
     
 };
 
+struct RankFilterMultiArrayTest
+{
+    template <unsigned int N, class T>
+    static void bruteForceRankFilter(MultiArrayView<N, T> const & src, MultiArrayView<N, T> dest,
+                                     typename MultiArrayShape<N>::type const & radius, double rank)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        std::vector<T> window;
+        MultiCoordinateIterator<N> i(src.shape()), end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            Shape start(max(Shape(), *i - radius)),
+                  stop(min(src.shape(), *i + radius + Shape(1)));
+            MultiArrayView<N, T> sub(src.subarray(start, stop));
+            window.assign(sub.begin(), sub.end());
+            std::sort(window.begin(), window.end());
+            MultiArrayIndex k = std::max<MultiArrayIndex>(1, (MultiArrayIndex)std::ceil(rank*window.size()));
+            dest[*i] = window[k-1];
+        }
+    }
+
+    template <unsigned int N, class T>
+    void checkBox(typename MultiArrayShape<N>::type const & shape,
+                  typename MultiArrayShape<N>::type const & radius)
+    {
+        MultiArray<N, T> src(shape), res(shape), ref(shape);
+        unsigned int seed = 5;
+        for(int k=0; k<src.size(); ++k)
+        {
+            seed = seed * 1103515245u + 12345u;
+            src[k] = (T)((seed >> 8) % 1000);
+        }
+
+        double ranks[] = { 0.0, 0.25, 0.5, 0.7, 1.0 };
+        for(int r=0; r<5; ++r)
+        {
+            bruteForceRankFilter(src, ref, radius, ranks[r]);
+            for(int t=0; t<4; ++t)
+            {
+                res.init(0);
+                rankFilterMultiArray(src, res, radius, ranks[r], BoxWindow,
+                                     ParallelOptions().numThreads(t));
+                shouldEqualSequence(res.begin(), res.end(), ref.begin());
+            }
+        }
+    }
+
+    void testBox()
+    {
+        checkBox<1, UInt8>(Shape1(50), Shape1(4));
+        checkBox<2, Int16>(Shape2(20, 15), Shape2(3, 2));
+        checkBox<3, UInt8>(Shape3(23, 17, 11), Shape3(2, 3, 1));
+        checkBox<3, UInt16>(Shape3(13, 12, 11), Shape3(2, 0, 3));
+        checkBox<3, float>(Shape3(23, 17, 11), Shape3(2, 3, 1));
+        checkBox<3, double>(Shape3(5, 17, 11), Shape3(6, 3, 20));
+    }
+
+    void testDisc()
+    {
+        MultiArray<3, UInt8> src(Shape3(40, 30, 3)), res(src.shape()), ref(src.shape());
+        MultiArray<3, float> fsrc(src.shape()), fres(src.shape());
+        unsigned int seed = 7;
+        for(int k=0; k<src.size(); ++k)
+        {
+            seed = seed * 1103515245u + 12345u;
+            src[k] = (UInt8)(seed >> 16);
+            fsrc[k] = src[k];
+        }
+
+        // a disc with zero radius along the last axis acts on each slice
+        // separately and must agree with discRankOrderFilter()
+        double ranks[] = { 0.0, 0.25, 0.5, 1.0 };
+        for(int r=0; r<4; ++r)
+        {
+            for(int radius=0; radius<6; ++radius)
+            {
+                for(int z=0; z<src.shape(2); ++z)
+                    discRankOrderFilter(src.bind<2>(z), ref.bind<2>(z), radius, (float)ranks[r]);
+                rankFilterMultiArray(src, res, Shape3(radius, radius, 0), ranks[r], DiscWindow,
+                                     ParallelOptions().numThreads(2));
+                shouldEqualSequence(res.begin(), res.end(), ref.begin());
+                rankFilterMultiArray(fsrc, fres, Shape3(radius, radius, 0), ranks[r], DiscWindow);
+                shouldEqualSequence(fres.begin(), fres.end(), ref.begin());
+            }
+        }
+    }
+
+    void testMedian()
+    {
+        // in the interior, the result equals the one of medianFilter()
+        FImage img(20, 16), result(img.size());
+        for(int k=0; k<img.width()*img.height(); ++k)
+            img.begin()[k] = (float)((k * 7919) % 101);
+        medianFilter(srcImageRange(img), destImage(result), Diff2D(5, 3), BORDER_TREATMENT_AVOID);
+
+        MultiArray<2, float> src(Shape2(20, 16)), res(src.shape());
+        copyImage(srcImageRange(img), destImage(src));
+        medianFilterMultiArray(src, res, Shape2(2, 1));
+        for(int y=1; y<15; ++y)
+            for(int x=2; x<18; ++x)
+                shouldEqual(res(x, y), result(x, y));
+    }
+};
+
 struct MedianFilterTestSuite
 : public vigra::test_suite
 {
@@ -238,6 +343,9 @@ struct MedianFilterTestSuite
         add( testCase( &MedianFilterExactTest::testREFLECT));
         add( testCase( &MedianFilterExactTest::testWRAP));
         add( testCase( &MedianFilterExactTest::testZEROPAD));
+        add( testCase( &RankFilterMultiArrayTest::testBox));
+        add( testCase( &RankFilterMultiArrayTest::testDisc));
+        add( testCase( &RankFilterMultiArrayTest::testMedian));
    }
 };
 
@@ -40,6 +40,8 @@
 #include "vigra/adjacency_list_graph.hxx"
 #include "vigra/graph_algorithms.hxx"
 #include "vigra/multi_resize.hxx"
+#include "vigra/multi_array_chunked.hxx"
+#include "vigra/graph_rag_features.hxx"
 
 using namespace vigra;
 
@@ -305,6 +307,227 @@ struct GraphAlgorithmTest{
         testShortestPathWithROIImpl(g);
     }
 
+    template <class Graph, class WEIGHTS>
+    void checkShortestPath(ShortestPathDijkstra<Graph,float> const & sp, WEIGHTS const & weights,
+                           typename Graph::Node const & source, typename Graph::Node const & target,
+                           float distance)
+    {
+        typedef typename Graph::Node Node;
+        Graph const & g = sp.graph();
+        should(sp.target() == target);
+        shouldEqualTolerance(sp.distance(target), distance, 1e-4f);
+        float length = 0.0f;
+        Node current = target;
+        while(current != source)
+        {
+            const Node pred = sp.predecessors()[current];
+            should(pred != lemon::INVALID);
+            length += weights[g.findEdge(pred, current)];
+            current = pred;
+        }
+        shouldEqualTolerance(length, distance, 1e-4f);
+    }
+
+    template <class Graph>
+    void testShortestPathRepeatedImpl(Graph const & g)
+    {
+        typedef ShortestPathDijkstra<Graph,float> Sp;
+        typedef typename Graph::Node              Node;
+        typedef typename Graph::NodeIt            GraphNodeIt;
+        typedef typename Graph::EdgeIt            GraphEdgeIt;
+
+        typename Graph::template EdgeMap<float> weights(g);
+        int k = 0;
+        for(GraphEdgeIt e(g); e != lemon::INVALID; ++e, ++k)
+            weights[*e] = 1.0f + float((k * 7919) % 13);
+        std::vector<Node> nodes;
+        for(GraphNodeIt n(g); n != lemon::INVALID; ++n)
+            nodes.push_back(*n);
+
+        Sp reused(g);
+        for(int q=0; q<20; ++q)
+        {
+            const Node source = nodes[(q * 104729) % nodes.size()],
+                       target = nodes[(q * 1299709 + 17) % nodes.size()];
+            // reference: a fresh object
+            Sp fresh(g);
+            fresh.run(weights, source);
+            const float distance = fresh.distance(target);
+
+            reused.run(weights, source, target);
+            checkShortestPath(reused, weights, source, target, distance);
+
+            reused.runBidirectional(weights, source, target);
+            checkShortestPath(reused, weights, source, target, distance);
+
+            reused.runBidirectional(weights, source, target, distance - 0.5f);
+            should(reused.target() == lemon::INVALID);
+
+            // the cheap reset must leave no traces of previous searches
+            reused.run(weights, source);
+            for(GraphNodeIt n(g); n != lemon::INVALID; ++n)
+            {
+                should(reused.predecessors()[*n] == fresh.predecessors()[*n]);
+                shouldEqual(reused.distance(*n), fresh.distance(*n));
+            }
+            shouldEqual(reused.discoveryOrder().size(), fresh.discoveryOrder().size());
+        }
+    }
+
+    void testShortestPathRepeated()
+    {
+        GridGraph<2> gridGraph(Shape2(23,19), IndirectNeighborhood);
+        testShortestPathRepeatedImpl(gridGraph);
+
+        GraphType g(0,0);
+        for(int i=0; i<100; ++i)
+            g.addNode(i);
+        for(int i=0; i<100; ++i)
+        {
+            g.addEdge(g.nodeFromId(i), g.nodeFromId((i+1)%100));
+            g.addEdge(g.nodeFromId(i), g.nodeFromId((i*37+11)%100));
+        }
+        testShortestPathRepeatedImpl(g);
+    }
+
+    template <class Graph>
+    void testShortestPathVoronoiImpl(Graph const & g)
+    {
+        typedef ShortestPathDijkstra<Graph,float> Sp;
+        typedef typename Graph::NodeIt            GraphNodeIt;
+        typedef typename Graph::EdgeIt            GraphEdgeIt;
+        typedef typename Graph::template NodeMap<UInt32> LabelMap;
+        typedef typename Graph::template NodeMap<float>  DistanceMap;
+
+        // integer weights, so that there are many ties
+        typename Graph::template EdgeMap<float> weights(g);
+        int k = 0;
+        for(GraphEdgeIt e(g); e != lemon::INVALID; ++e, ++k)
+            weights[*e] = 1.0f + float((k * 7919) % 5);
+
+        // reference: one search per seed, ties are resolved in favor of the smaller label
+        LabelMap seeds(g), refLabels(g);
+        DistanceMap refDistances(g);
+        fillNodeMap(g, seeds, 0u);
+        fillNodeMap(g, refLabels, 0u);
+        fillNodeMap(g, refDistances, NumericTraits<float>::max());
+        Sp sp(g);
+        k = 0;
+        for(GraphNodeIt n(g); n != lemon::INVALID; ++n, ++k)
+        {
+            if(k % 11 != 3)
+                continue;
+            const UInt32 label = 100 - k % 37;
+            seeds[*n] = label;
+            sp.run(weights, *n);
+            for(GraphNodeIt m(g); m != lemon::INVALID; ++m)
+            {
+                if(sp.predecessors()[*m] == lemon::INVALID)
+                    continue;
+                const float d = sp.distance(*m);
+                if(d < refDistances[*m] || (d == refDistances[*m] && label < refLabels[*m]))
+                {
+                    refDistances[*m] = d;
+                    refLabels[*m] = label;
+                }
+            }
+        }
+
+        LabelMap labels(g);
+        DistanceMap distances(g);
+        shortestPathVoronoi(g, weights, seeds, distances, labels);
+        for(GraphNodeIt n(g); n != lemon::INVALID; ++n)
+        {
+            shouldEqual(distances[*n], refDistances[*n]);
+            shouldEqual(labels[*n], refLabels[*n]);
+        }
+
+        const float deltas[] = { 0.0f, 0.5f, 2.5f, 1000.0f };
+        for(int threads=1; threads<=3; threads+=2)
+        {
+            for(int d=0; d<4; ++d)
+            {
+                fillNodeMap(g, labels, 0u);
+                shortestPathVoronoi(g, weights, seeds, distances, labels, 
+                                    ParallelOptions().numThreads(threads), deltas[d]);
+                for(GraphNodeIt n(g); n != lemon::INVALID; ++n)
+                {
+                    shouldEqual(distances[*n], refDistances[*n]);
+                    shouldEqual(labels[*n], refLabels[*n]);
+                }
+            }
+        }
+    }
+
+    void testShortestPathVoronoi()
+    {
+        GridGraph<2> gridGraph(Shape2(23,19), IndirectNeighborhood);
+        testShortestPathVoronoiImpl(gridGraph);
+
+        GridGraph<3> gridGraph3(Shape3(9,8,7), DirectNeighborhood);
+        testShortestPathVoronoiImpl(gridGraph3);
+
+        GraphType g(0,0);
+        for(int i=0; i<100; ++i)
+            g.addNode(i);
+        for(int i=0; i<100; ++i)
+        {
+            g.addEdge(g.nodeFromId(i), g.nodeFromId((i+1)%100));
+            g.addEdge(g.nodeFromId(i), g.nodeFromId((i*37+11)%100));
+        }
+        testShortestPathVoronoiImpl(g);
+
+        // isolated nodes are not reached by any seed
+        g.addNode(100);
+        testShortestPathVoronoiImpl(g);
+
+        // a zero-weight edge relabels a node that was already reached at the same distance
+        {
+            GraphType g(0,0);
+            const Node s1 = g.addNode(0), v = g.addNode(1), u = g.addNode(2), s2 = g.addNode(3);
+            GraphType::EdgeMap<float> weights(g);
+            weights[g.addEdge(s1, v)] = 1.0f;
+            weights[g.addEdge(s2, u)] = 1.0f;
+            weights[g.addEdge(u, v)]  = 0.0f;
+            GraphType::NodeMap<UInt32> seeds(g), labels(g);
+            GraphType::NodeMap<float>  distances(g);
+            fillNodeMap(g, seeds, 0u);
+            seeds[s1] = 5;
+            seeds[s2] = 1;
+            for(int threads=0; threads<=2; threads+=2)
+            {
+                shortestPathVoronoi(g, weights, seeds, distances, labels, 
+                                    ParallelOptions().numThreads(threads));
+                shouldEqual(labels[v], 1u);
+                shouldEqual(labels[u], 1u);
+                shouldEqual(distances[v], 1.0f);
+            }
+        }
+
+        // a weight much larger than delta exceeds the cyclic bucket array
+        {
+            GraphType g(0,0);
+            for(int i=0; i<5; ++i)
+                g.addNode(i);
+            GraphType::EdgeMap<float> weights(g);
+            weights[g.addEdge(g.nodeFromId(0), g.nodeFromId(1))] = 1.0f;
+            weights[g.addEdge(g.nodeFromId(1), g.nodeFromId(2))] = 5000.0f;
+            weights[g.addEdge(g.nodeFromId(2), g.nodeFromId(3))] = 1.0f;
+            weights[g.addEdge(g.nodeFromId(0), g.nodeFromId(4))] = 3000.0f;
+            weights[g.addEdge(g.nodeFromId(4), g.nodeFromId(3))] = 2000.0f;
+            GraphType::NodeMap<UInt32> seeds(g), labels(g);
+            GraphType::NodeMap<float>  distances(g);
+            fillNodeMap(g, seeds, 0u);
+            seeds[g.nodeFromId(0)] = 1;
+            shortestPathVoronoi(g, weights, seeds, distances, labels, 
+                                ParallelOptions().numThreads(2), 0.5f);
+            shouldEqual(distances[g.nodeFromId(2)], 5001.0f);
+            shouldEqual(distances[g.nodeFromId(3)], 5000.0f);
+            shouldEqual(distances[g.nodeFromId(4)], 3000.0f);
+            shouldEqual(labels[g.nodeFromId(3)], 1u);
+        }
+    }
+
     void testRegionAdjacencyGraph(){
         {
             GraphType g(0,0);
@@ -377,6 +600,236 @@ struct GraphAlgorithmTest{
     }
 
 
+    template<class AFFILIATED_EDGES, class CHUNKED_AFFILIATED_EDGES>
+    void checkGridGraphRag(GraphType const & rag, AFFILIATED_EDGES const & affEdges,
+                           GraphType const & ragParallel, CHUNKED_AFFILIATED_EDGES const & affEdgesParallel,
+                           bool sameOrder)
+    {
+        typedef typename AFFILIATED_EDGES::Value::value_type GridEdge;
+        shouldEqual(ragParallel.nodeNum(), rag.nodeNum());
+        shouldEqual(ragParallel.edgeNum(), rag.edgeNum());
+        for(NodeIt n(rag); n!=lemon::INVALID; ++n)
+            should(ragParallel.nodeFromId(rag.id(*n))!=lemon::INVALID);
+        for(EdgeIt e(rag); e!=lemon::INVALID; ++e)
+        {
+            const Edge pe = ragParallel.findEdge(ragParallel.nodeFromId(rag.id(rag.u(*e))),
+                                                 ragParallel.nodeFromId(rag.id(rag.v(*e))));
+            should(pe!=lemon::INVALID);
+            should(ragParallel.id(ragParallel.u(pe)) < ragParallel.id(ragParallel.v(pe)));
+            std::vector<GridEdge> a(affEdges[*e]), b(affEdgesParallel[pe]);
+            shouldEqual(a.size(), b.size());
+            if(!sameOrder)
+            {
+                std::sort(a.begin(), a.end());
+                std::sort(b.begin(), b.end());
+            }
+            should(a == b);
+        }
+        // RAG edges are numbered by label pair
+        for(EdgeIt e(ragParallel); e!=lemon::INVALID; ++e)
+        {
+            if(ragParallel.id(*e) == 0)
+                continue;
+            const Edge prev(ragParallel.id(*e)-1);
+            should(ragParallel.id(ragParallel.u(prev)) < ragParallel.id(ragParallel.u(*e)) ||
+                   (ragParallel.id(ragParallel.u(prev)) == ragParallel.id(ragParallel.u(*e)) &&
+                    ragParallel.id(ragParallel.v(prev)) < ragParallel.id(ragParallel.v(*e))));
+        }
+    }
+
+    void testRegionAdjacencyGraphGridGraph(){
+        typedef GridGraph<3, boost_graph::undirected_tag> Graph;
+        typedef Graph::Edge                               GridEdge;
+        typedef GraphType::EdgeMap< std::vector<GridEdge> > AffiliatedEdges;
+
+        Shape3 shape(20, 17, 15);
+        MultiArray<3, UInt32> labels(shape);
+        for(MultiCoordinateIterator<3> p(shape), end(p.getEndIterator()); p != end; ++p)
+            labels[*p] = 1 + ((*p)[0]+(*p)[2]) / 4 + 6 * ((*p)[1] / 5) + ((*p)[2] % 7 == 3 ? 24 : 0);
+
+        ChunkedArrayLazy<3, UInt32> chunkedLabels(shape, Shape3(8));
+        chunkedLabels.commitSubarray(Shape3(), labels);
+
+        for(int neighborhood=0; neighborhood<2; ++neighborhood)
+        {
+            Graph g(shape, neighborhood == 0 ? DirectNeighborhood : IndirectNeighborhood);
+            Graph::NodeMap<UInt32> labelMap(g);
+            labelMap = labels;
+
+            for(Int64 ignoreLabel=-1; ignoreLabel<=1; ignoreLabel+=2)
+            {
+                // serial reference
+                GraphType rag;
+                AffiliatedEdges affEdges;
+                makeRegionAdjacencyGraph(g, labelMap, rag, affEdges, ignoreLabel);
+
+                for(int threads=1; threads<=4; threads+=3)
+                {
+                    GraphType ragParallel;
+                    AffiliatedEdges affEdgesParallel;
+                    makeRegionAdjacencyGraph(g, labels, ragParallel, affEdgesParallel, 
+                                             ignoreLabel, ParallelOptions().numThreads(threads));
+                    checkGridGraphRag(rag, affEdges, ragParallel, affEdgesParallel, true);
+
+                    GraphType ragChunked;
+                    AffiliatedEdges affEdgesChunked;
+                    makeRegionAdjacencyGraph(g, chunkedLabels, ragChunked, affEdgesChunked, 
+                                             ignoreLabel, ParallelOptions().numThreads(threads));
+                    checkGridGraphRag(rag, affEdges, ragChunked, affEdgesChunked, false);
+                }
+            }
+        }
+    }
+
+    void testRagFeatures(){
+        using namespace vigra::acc;
+        typedef GridGraph<3, boost_graph::undirected_tag> Graph;
+        typedef Graph::Edge                               GridEdge;
+        typedef GraphType::EdgeMap< std::vector<GridEdge> > AffiliatedEdges;
+        typedef AccumulatorChainArray<CoupledArrays<1, float, UInt32>,
+                                      Select<DataArg<1>, LabelArg<2>, Count, Mean, Minimum, Maximum> > Features;
+
+        Shape3 shape(20, 17, 15);
+        MultiArray<3, UInt32> labels(shape);
+        MultiArray<3, float>  data(shape);
+        for(MultiCoordinateIterator<3> p(shape), end(p.getEndIterator()); p != end; ++p)
+        {
+            labels[*p] = 1 + ((*p)[0]+(*p)[2]) / 4 + 6 * ((*p)[1] / 5) + ((*p)[2] % 7 == 3 ? 24 : 0);
+            data[*p]   = (float)(((*p)[0]*7 + (*p)[1]*3 + (*p)[2]*11) % 17);
+        }
+
+        Graph g(shape, IndirectNeighborhood);
+        Graph::EdgeMap<float> edgeData(g);
+        for(Graph::EdgeIt e(g); e != lemon::INVALID; ++e)
+            edgeData[*e] = (float)((g.id(*e)*5) % 23);
+
+        ChunkedArrayLazy<3, UInt32> chunkedLabels(shape, Shape3(8));
+        chunkedLabels.commitSubarray(Shape3(), labels);
+        ChunkedArrayLazy<3, float>  chunkedData(shape, Shape3(8));
+        chunkedData.commitSubarray(Shape3(), data);
+        ChunkedArrayLazy<4, float>  chunkedEdgeData(edgeData.shape(), Shape4(8, 8, 8, 2));
+        chunkedEdgeData.commitSubarray(Shape4(), edgeData);
+
+        GraphType rag;
+        AffiliatedEdges affEdges;
+        makeRegionAdjacencyGraph(g, labels, rag, affEdges, 1, ParallelOptions());
+
+        // serial reference from the affiliated edges
+        std::vector<float> edgeValues, nodeValues;
+        std::vector<UInt32> ids;
+        for(EdgeIt e(rag); e != lemon::INVALID; ++e)
+        {
+            for(std::size_t k=0; k<affEdges[*e].size(); ++k)
+            {
+                const GridEdge ge = affEdges[*e][k];
+                edgeValues.push_back(edgeData[ge]);
+                nodeValues.push_back((data[g.u(ge)] + data[g.v(ge)]) / 2.0f);
+                ids.push_back(rag.id(*e));
+            }
+        }
+        Shape1 sampleShape(ids.size());
+        Features edgeRef, nodeDataRef;
+        edgeRef.setMaxRegionLabel(rag.maxEdgeId());
+        nodeDataRef.setMaxRegionLabel(rag.maxEdgeId());
+        extractFeatures(MultiArrayView<1, float>(sampleShape, &edgeValues[0]),
+                        MultiArrayView<1, UInt32>(sampleShape, &ids[0]), edgeRef);
+        extractFeatures(MultiArrayView<1, float>(sampleShape, &nodeValues[0]),
+                        MultiArrayView<1, UInt32>(sampleShape, &ids[0]), nodeDataRef);
+        AccumulatorChainArray<CoupledArrays<3, float, UInt32>,
+                              Select<DataArg<1>, LabelArg<2>, Count, Mean, Minimum, Maximum> > nodeRef;
+        extractFeatures(data, labels, nodeRef);
+
+        for(int threads=1; threads<=4; threads+=3)
+        {
+            ParallelOptions options = ParallelOptions().numThreads(threads);
+            Features edgeFeatures, chunkedEdgeFeatures, nodeDataFeatures, chunkedNodeDataFeatures,
+                     nodeFeatures, chunkedNodeFeatures;
+            extractRagEdgeFeatures(g, rag, labels, edgeData, edgeFeatures, options);
+            extractRagEdgeFeatures(g, rag, chunkedLabels, chunkedEdgeData, chunkedEdgeFeatures, options);
+            extractRagEdgeFeatures(g, rag, labels, data, nodeDataFeatures, options);
+            extractRagEdgeFeatures(g, rag, chunkedLabels, chunkedData, chunkedNodeDataFeatures, options);
+            extractRagNodeFeatures(rag, labels, data, nodeFeatures, options);
+            extractRagNodeFeatures(rag, chunkedLabels, chunkedData, chunkedNodeFeatures, options);
+
+            shouldEqual(edgeFeatures.maxRegionLabel(), rag.maxEdgeId());
+            for(EdgeIt e(rag); e != lemon::INVALID; ++e)
+            {
+                const int id = rag.id(*e);
+                shouldEqual(get<Count>(edgeFeatures, id), (double)affEdges[*e].size());
+                Features * results[] = { &edgeFeatures, &chunkedEdgeFeatures };
+                for(int k=0; k<2; ++k)
+                {
+                    shouldEqual(get<Count>(*results[k], id), get<Count>(edgeRef, id));
+                    shouldEqualTolerance(get<Mean>(*results[k], id), get<Mean>(edgeRef, id), 1e-10);
+                    shouldEqual(get<Minimum>(*results[k], id), get<Minimum>(edgeRef, id));
+                    shouldEqual(get<Maximum>(*results[k], id), get<Maximum>(edgeRef, id));
+                }
+                results[0] = &nodeDataFeatures;
+                results[1] = &chunkedNodeDataFeatures;
+                for(int k=0; k<2; ++k)
+                {
+                    shouldEqual(get<Count>(*results[k], id), get<Count>(nodeDataRef, id));
+                    shouldEqualTolerance(get<Mean>(*results[k], id), get<Mean>(nodeDataRef, id), 1e-10);
+                    shouldEqual(get<Minimum>(*results[k], id), get<Minimum>(nodeDataRef, id));
+                    shouldEqual(get<Maximum>(*results[k], id), get<Maximum>(nodeDataRef, id));
+                }
+            }
+
+            // the ignored label is not a node of the RAG
+            shouldEqual(get<Count>(nodeFeatures, 1), 0.0);
+            shouldEqual(get<Count>(chunkedNodeFeatures, 1), 0.0);
+            for(NodeIt n(rag); n != lemon::INVALID; ++n)
+            {
+                const int id = rag.id(*n);
+                shouldEqual(get<Count>(nodeFeatures, id), get<Count>(nodeRef, id));
+                shouldEqual(get<Count>(chunkedNodeFeatures, id), get<Count>(nodeRef, id));
+                shouldEqualTolerance(get<Mean>(nodeFeatures, id), get<Mean>(nodeRef, id), 1e-10);
+                shouldEqualTolerance(get<Mean>(chunkedNodeFeatures, id), get<Mean>(nodeRef, id), 1e-10);
+                shouldEqual(get<Minimum>(nodeFeatures, id), get<Minimum>(nodeRef, id));
+                shouldEqual(get<Maximum>(chunkedNodeFeatures, id), get<Maximum>(nodeRef, id));
+            }
+        }
+
+        // several feature arrays are passed as the channels of one multiband array
+        MultiArray<3, TinyVector<float, 2> > multibandData(shape);
+        for(int k=0; k<data.size(); ++k)
+            multibandData[k] = TinyVector<float, 2>(data[k], 2.0f*data[k]);
+        AccumulatorChainArray<CoupledArrays<1, TinyVector<float, 2>, UInt32>,
+                              Select<DataArg<1>, LabelArg<2>, Count, Mean, Minimum, Maximum> > multibandFeatures;
+        extractRagEdgeFeatures(g, rag, labels, multibandData, multibandFeatures, 
+                               ParallelOptions().numThreads(4));
+        for(EdgeIt e(rag); e != lemon::INVALID; ++e)
+        {
+            const int id = rag.id(*e);
+            shouldEqual(get<Count>(multibandFeatures, id), get<Count>(nodeDataRef, id));
+            shouldEqualTolerance(get<Mean>(multibandFeatures, id)[0], get<Mean>(nodeDataRef, id), 1e-10);
+            shouldEqualTolerance(get<Mean>(multibandFeatures, id)[1], 2.0*get<Mean>(nodeDataRef, id), 1e-10);
+            shouldEqual(get<Minimum>(multibandFeatures, id)[0], get<Minimum>(nodeDataRef, id));
+            shouldEqual(get<Maximum>(multibandFeatures, id)[1], 2.0f*get<Maximum>(nodeDataRef, id));
+        }
+
+        // quantiles need two passes
+        typedef AccumulatorChainArray<CoupledArrays<1, float, UInt32>,
+                                      Select<DataArg<1>, LabelArg<2>, Count, 
+                                             StandardQuantiles<AutoRangeHistogram<32> > > > Quantiles;
+        Quantiles quantileRef, quantiles, chunkedQuantiles;
+        quantileRef.setMaxRegionLabel(rag.maxEdgeId());
+        extractFeatures(MultiArrayView<1, float>(sampleShape, &nodeValues[0]),
+                        MultiArrayView<1, UInt32>(sampleShape, &ids[0]), quantileRef);
+        extractRagEdgeFeatures(g, rag, labels, data, quantiles, ParallelOptions().numThreads(4));
+        extractRagEdgeFeatures(g, rag, chunkedLabels, chunkedData, chunkedQuantiles, 
+                               ParallelOptions().numThreads(4));
+        for(EdgeIt e(rag); e != lemon::INVALID; ++e)
+        {
+            const int id = rag.id(*e);
+            TinyVector<double, 7> q = get<StandardQuantiles<AutoRangeHistogram<32> > >(quantileRef, id);
+            shouldEqualSequenceTolerance(q.begin(), q.end(), 
+                get<StandardQuantiles<AutoRangeHistogram<32> > >(quantiles, id).begin(), 1e-10);
+            shouldEqualSequenceTolerance(q.begin(), q.end(), 
+                get<StandardQuantiles<AutoRangeHistogram<32> > >(chunkedQuantiles, id).begin(), 1e-10);
+        }
+    }
+
     void testEdgeSort(){
         {
             GraphType g(0,0);
@@ -428,6 +881,64 @@ struct GraphAlgorithmTest{
             should(edgeVec[0]==e24);
 
         }
+        {
+            // parallel sort: stable w.r.t. EdgeIt order, independent of the number of threads
+            GridGraph<2> g(Shape2(120,100), IndirectNeighborhood);
+            GridGraph<2>::EdgeMap<float> ew(g);
+            std::vector<GridGraph<2>::Edge> ref;
+            int k = 0;
+            for(GridGraph<2>::EdgeIt e(g); e != lemon::INVALID; ++e, ++k)
+            {
+                ew[*e] = float((k * 7919) % 97);
+                ref.push_back(*e);
+            }
+            std::less<float> l;
+            std::stable_sort(ref.begin(), ref.end(), 
+                             detail_graph_algorithms::GraphItemCompare<GridGraph<2>::EdgeMap<float>, std::less<float> >(ew, l));
+            for(int threads=1; threads<=3; threads+=2)
+            {
+                std::vector<GridGraph<2>::Edge> edgeVec;
+                edgeSort(g, ew, l, edgeVec, ParallelOptions().numThreads(threads));
+                shouldEqual(edgeVec.size(), ref.size());
+                should(edgeVec == ref);
+            }
+        }
+    }
+
+    void testFelzenszwalbSegmentation()
+    {
+        typedef GridGraph<3> Graph3;
+        Graph3 g(Shape3(30,25,20), IndirectNeighborhood);
+        Graph3::EdgeMap<float> edgeWeights(g);
+        Graph3::NodeMap<float> nodeSizes(g, 1.0f);
+        Graph3::NodeMap<UInt32> labels1(g), labels2(g);
+
+        // distinct weights, so that sorting is unambiguous
+        int k = 0;
+        for(Graph3::EdgeIt e(g); e != lemon::INVALID; ++e, ++k)
+            edgeWeights[*e] = float((k * 7919) % 10007) + 0.5f * ((*e)[0] < 15);
+
+        felzenszwalbSegmentation(g, edgeWeights, nodeSizes, 5000.0f, labels1);
+        felzenszwalbSegmentation(g, edgeWeights, nodeSizes, 5000.0f, labels2, -1, ParallelOptions().numThreads(3));
+        shouldEqualSequence(labels1.begin(), labels1.end(), labels2.begin());
+
+        felzenszwalbSegmentation(g, edgeWeights, nodeSizes, 5000.0f, labels1, 50);
+        felzenszwalbSegmentation(g, edgeWeights, nodeSizes, 5000.0f, labels2, 50, ParallelOptions().numThreads(3));
+        shouldEqualSequence(labels1.begin(), labels1.end(), labels2.begin());
+        shouldEqual(*argMax(labels1.begin(), labels1.end()), 49u);
+
+        // the two plateaus of a piecewise constant image are found
+        MultiArray<3, float> image(g.shape());
+        image.subarray(Shape3(0), Shape3(12,25,20)) = 100.0f;
+        for(int i=0; i<image.size(); ++i)
+            image[i] += float((i * 7919) % 7) * 0.1f;
+        edgeWeightsFromNodeWeights(g, image, edgeWeights, false, 
+                                   functor::abs(functor::Arg1() - functor::Arg2()));
+        felzenszwalbSegmentation(g, edgeWeights, nodeSizes, 1000.0f, labels1);
+        felzenszwalbSegmentation(g, edgeWeights, nodeSizes, 1000.0f, labels2, -1, ParallelOptions().numThreads(3));
+        shouldEqualSequence(labels1.begin(), labels1.end(), labels2.begin());
+        shouldEqual(*argMax(labels1.begin(), labels1.end()), 1u);
+        should(labels1[Shape3(0)] != labels1[Shape3(29,24,19)]);
     }
 
     void testEdgeWeightComputation()
@@ -467,6 +978,60 @@ struct GraphAlgorithmTest{
         shouldEqualSequence(edgeMap1.begin(), edgeMap1.end(), ref2);
         shouldEqualSequence(edgeMap2.begin(), edgeMap2.end(), ref2);
     }
+
+    void testImplicitEdgeWeights()
+    {
+        MultiArray<2, double> nodeMap(Shape2(3,2), LinearSequence);
+        MultiArray<2, double> interpolated(Shape2(5,3));
+        resizeImageLinearInterpolation(nodeMap, interpolated);
+
+        GridGraph<2> g(nodeMap.shape(), IndirectNeighborhood);
+        GridGraph<2>::EdgeMap<double> edgeMap(g);
+
+        for(int euclidean=0; euclidean<2; ++euclidean)
+        {
+            edgeWeightsFromNodeWeights(g, nodeMap, edgeMap, euclidean == 1);
+            for(GridGraph<2>::EdgeIt e(g); e != lemon::INVALID; ++e)
+            {
+                shouldEqualTolerance(implicitEdgeWeightsFromNodeWeights(g, nodeMap, euclidean == 1)[*e], 
+                                     edgeMap[*e], 1e-14);
+                shouldEqualTolerance(implicitEdgeWeightsFromInterpolatedImage(g, interpolated, euclidean == 1)[*e], 
+                                     edgeMap[*e], 1e-14);
+            }
+        }
+
+        // the implicit maps give the same results as the materialized ones in the algorithms
+        typedef GridGraph<3> Graph3;
+        Graph3 g3(Shape3(12,10,8), IndirectNeighborhood);
+        MultiArray<3, float> nodeWeights(g3.shape());
+        for(int k=0; k<nodeWeights.size(); ++k)
+            nodeWeights[k] = float((k * 7919) % 101);
+        Graph3::EdgeMap<float> edgeWeights(g3);
+        edgeWeightsFromNodeWeights(g3, nodeWeights, edgeWeights, true);
+        ImplicitEdgeWeightsFromNodeWeights<3, boost_graph::undirected_tag, MultiArray<3, float>, 
+                                           detail_graph_algorithms::EndpointMean> 
+            implicitWeights = implicitEdgeWeightsFromNodeWeights(g3, nodeWeights, true);
+
+        ShortestPathDijkstra<Graph3, float> sp1(g3), sp2(g3);
+        sp1.run(edgeWeights, Shape3(0), Shape3(11,9,7));
+        sp2.run(implicitWeights, Shape3(0), Shape3(11,9,7));
+        shouldEqual(sp1.distance(Shape3(11,9,7)), sp2.distance(Shape3(11,9,7)));
+        shouldEqualSequence(sp1.predecessors().begin(), sp1.predecessors().end(), 
+                            sp2.predecessors().begin());
+
+        Graph3::NodeMap<UInt32> seeds(g3), labels1(g3), labels2(g3);
+        seeds[Shape3(1,1,1)] = 1;
+        seeds[Shape3(10,8,6)] = 2;
+        seeds[Shape3(2,8,5)] = 3;
+        edgeWeightedWatershedsSegmentation(g3, edgeWeights, seeds, labels1);
+        edgeWeightedWatershedsSegmentation(g3, implicitWeights, seeds, labels2);
+        shouldEqualSequence(labels1.begin(), labels1.end(), labels2.begin());
+
+        Graph3::NodeMap<float> nodeSizes(g3, 1.0f);
+        felzenszwalbSegmentation(g3, edgeWeights, nodeSizes, 30.0f, labels1);
+        felzenszwalbSegmentation(g3, implicitWeights, nodeSizes, 30.0f, labels2);
+        shouldEqualSequence(labels1.begin(), labels1.end(), labels2.begin());
+    }
 };
 
 
@@ -479,9 +1044,15 @@ struct GraphAlgorithmTestSuite
     {   
         add( testCase( &GraphAlgorithmTest::testShortestPathAdjacencyListGraph));
         add( testCase( &GraphAlgorithmTest::testShortestPathGridGraph));
+        add( testCase( &GraphAlgorithmTest::testShortestPathRepeated));
+        add( testCase( &GraphAlgorithmTest::testShortestPathVoronoi));
         add( testCase( &GraphAlgorithmTest::testRegionAdjacencyGraph));
+        add( testCase( &GraphAlgorithmTest::testRegionAdjacencyGraphGridGraph));
+        add( testCase( &GraphAlgorithmTest::testRagFeatures));
         add( testCase( &GraphAlgorithmTest::testEdgeSort));
+        add( testCase( &GraphAlgorithmTest::testFelzenszwalbSegmentation));
         add( testCase( &GraphAlgorithmTest::testEdgeWeightComputation));
+        add( testCase( &GraphAlgorithmTest::testImplicitEdgeWeights));
     }
 };
 
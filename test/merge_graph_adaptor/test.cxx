@@ -40,6 +40,7 @@
 #include "vigra/multi_array.hxx"
 #include "vigra/adjacency_list_graph.hxx"
 #include "vigra/merge_graph_adaptor.hxx"
+#include "vigra/hierarchical_clustering.hxx"
 using namespace vigra;
 
 template<class ID_TYPE>
@@ -1678,6 +1679,214 @@ struct AdjacencyListGraph2MergeGraphTest{
 
     }
 
+    template<class HCLUSTER>
+    void checkMergeTree(const HCLUSTER & hc, const AdjacencyListGraph & g){
+        // every node has been merged exactly once
+        const typename HCLUSTER::MergeTreeEncoding & tree = hc.mergeTreeEndcoding();
+        shouldEqual(tree.size(), g.nodeNum()-1);
+        std::vector<int> merged(g.maxNodeId()+tree.size()+1, 0);
+        for(size_t i=0;i<tree.size();++i){
+            ++merged[tree[i].a_];
+            ++merged[tree[i].b_];
+        }
+        for(size_t i=0;i+1<merged.size();++i)
+            shouldEqual(merged[i], 1);
+        shouldEqual(merged.back(), 0);
+    }
+
+    void HierarchicalClusteringLazyTest(){
+        typedef AdjacencyListGraph::EdgeMap<float>  EdgeMap;
+        typedef AdjacencyListGraph::NodeMap<float>  NodeMap;
+        typedef cluster_operators::EdgeWeightNodeFeatures<
+            MergeGraphType,EdgeMap,EdgeMap,NodeMap,NodeMap,EdgeMap
+        > ClusterOperator;
+        typedef HierarchicalClustering<ClusterOperator> HCluster;
+
+        const int w=12;
+        for(int withCycles=0;withCycles<2;++withCycles){
+            // a comb (no cycles, no double edges) or a 4-connected grid
+            AdjacencyListGraph g;
+            for(int i=0;i<w*w;++i)
+                g.addNode(i);
+            for(int y=0;y<w;++y)
+            for(int x=0;x<w;++x){
+                if(x+1<w)
+                    g.addEdge(g.nodeFromId(y*w+x),g.nodeFromId(y*w+x+1));
+                if(y+1<w && (withCycles || x==0))
+                    g.addEdge(g.nodeFromId(y*w+x),g.nodeFromId((y+1)*w+x));
+            }
+
+            MergeGraphType * mergeGraphs[2];
+            ClusterOperator * operators[2];
+            HCluster * clusterings[2];
+            EdgeMap edgeIndicator[2], edgeSize[2], minWeight[2];
+            NodeMap nodeFeatures[2], nodeSize[2];
+            for(int lazy=0;lazy<2;++lazy){
+                edgeIndicator[lazy]=EdgeMap(g);
+                edgeSize[lazy]=EdgeMap(g,1.0f);
+                minWeight[lazy]=EdgeMap(g);
+                nodeFeatures[lazy]=NodeMap(g);
+                nodeSize[lazy]=NodeMap(g,1.0f);
+                for(AdjacencyListGraph::EdgeIt e(g);e!=lemon::INVALID;++e)
+                    edgeIndicator[lazy][*e]=float((g.id(*e)*37)%101);
+                for(AdjacencyListGraph::NodeIt n(g);n!=lemon::INVALID;++n)
+                    nodeFeatures[lazy][*n]=float((g.id(*n)*13)%29);
+
+                // without node features and wardness, the weights on the comb 
+                // never change, so that lazy and eager updates must agree
+                mergeGraphs[lazy]=new MergeGraphType(g);
+                operators[lazy]=new ClusterOperator(*mergeGraphs[lazy],
+                    edgeIndicator[lazy],edgeSize[lazy],nodeFeatures[lazy],nodeSize[lazy],minWeight[lazy],
+                    withCycles ? 0.5f : 0.0f, metrics::ManhattanMetric, withCycles ? 1.0f : 0.0f, lazy==1);
+                clusterings[lazy]=new HCluster(*operators[lazy]);
+                clusterings[lazy]->cluster();
+
+                shouldEqual(mergeGraphs[lazy]->nodeNum(),1);
+                shouldEqual(mergeGraphs[lazy]->edgeNum(),0);
+                checkMergeTree(*clusterings[lazy],g);
+            }
+
+            if(!withCycles){
+                const HCluster::MergeTreeEncoding & eager = clusterings[0]->mergeTreeEndcoding();
+                const HCluster::MergeTreeEncoding & lazy  = clusterings[1]->mergeTreeEndcoding();
+                for(size_t i=0;i<eager.size();++i){
+                    shouldEqual(eager[i].a_,lazy[i].a_);
+                    shouldEqual(eager[i].b_,lazy[i].b_);
+                    shouldEqual(eager[i].w_,lazy[i].w_);
+                }
+            }
+            for(int lazy=0;lazy<2;++lazy){
+                delete clusterings[lazy];
+                delete operators[lazy];
+                delete mergeGraphs[lazy];
+            }
+        }
+    }
+
+    void HierarchicalClusteringMergeTreeTest(){
+        typedef AdjacencyListGraph::EdgeMap<float>  EdgeMap;
+        typedef AdjacencyListGraph::NodeMap<float>  NodeMap;
+        typedef cluster_operators::EdgeWeightNodeFeatures<
+            MergeGraphType,EdgeMap,EdgeMap,NodeMap,NodeMap,EdgeMap
+        > ClusterOperator;
+        typedef HierarchicalClustering<ClusterOperator> HCluster;
+        typedef HCluster::MergeTree MergeTree;
+
+        const int w=12;
+        for(int withCycles=0;withCycles<2;++withCycles){
+            AdjacencyListGraph g;
+            for(int i=0;i<w*w;++i)
+                g.addNode(i);
+            for(int y=0;y<w;++y)
+            for(int x=0;x<w;++x){
+                if(x+1<w)
+                    g.addEdge(g.nodeFromId(y*w+x),g.nodeFromId(y*w+x+1));
+                if(y+1<w && (withCycles || x==0))
+                    g.addEdge(g.nodeFromId(y*w+x),g.nodeFromId((y+1)*w+x));
+            }
+            const float beta     = withCycles ? 0.5f : 0.0f;
+            const float wardness = withCycles ? 1.0f : 0.0f;
+
+            // full clustering
+            EdgeMap edgeIndicator(g), edgeSize(g,1.0f), minWeight(g);
+            NodeMap nodeFeatures(g), nodeSize(g,1.0f);
+            for(AdjacencyListGraph::EdgeIt e(g);e!=lemon::INVALID;++e)
+                edgeIndicator[*e]=float((g.id(*e)*37)%101);
+            for(AdjacencyListGraph::NodeIt n(g);n!=lemon::INVALID;++n)
+                nodeFeatures[*n]=float((g.id(*n)*13)%29);
+            MergeGraphType mergeGraph(g);
+            ClusterOperator op(mergeGraph,edgeIndicator,edgeSize,nodeFeatures,nodeSize,minWeight,
+                               beta,metrics::ManhattanMetric,wardness);
+            HCluster hc(op);
+            hc.cluster();
+
+            const MergeTree tree = hc.mergeTree();
+            shouldEqual(tree.mergeNum(), g.nodeNum()-1);
+            for(size_t m=0;m<tree.mergeNum();++m){
+                const MergeGraphType::index_type id = g.maxNodeId()+1+m;
+                if(tree.parent(id)!=-1)
+                    should(tree.level(tree.parent(id)) >= tree.level(id));
+            }
+            // the tree is built only once
+            should(&hc.mergeTree() == &hc.mergeTree());
+
+            // a base graph node is a singleton exactly below its merge level
+            {
+                std::vector<MergeGraphType::index_type> labels(g.maxNodeId()+1);
+                const float thresholds[] = {-1.0f, 20.0f, 50.5f, 100.0f};
+                for(int k=0;k<4;++k){
+                    tree.labelsAtThreshold(thresholds[k], labels.begin());
+                    std::vector<int> clusterSize(g.maxNodeId()+1, 0);
+                    for(size_t i=0;i<labels.size();++i)
+                        ++clusterSize[labels[i]];
+                    for(size_t i=0;i<labels.size();++i)
+                        shouldEqual(clusterSize[labels[i]] == 1, thresholds[k] < tree.mergeLevel(i));
+                }
+                const MergeGraphType::index_type root = g.maxNodeId()+tree.mergeNum();
+                shouldEqual(tree.parent(root), -1);
+                shouldEqual(tree.mergeLevel(root), NumericTraits<float>::max());
+            }
+
+            // stopping the clustering early gives the same partition
+            const size_t stopAt[] = {1, 7, 40, size_t(w*w)};
+            for(int k=0;k<4;++k){
+                EdgeMap edgeIndicator2(g), edgeSize2(g,1.0f), minWeight2(g);
+                NodeMap nodeFeatures2(g), nodeSize2(g,1.0f);
+                for(AdjacencyListGraph::EdgeIt e(g);e!=lemon::INVALID;++e)
+                    edgeIndicator2[*e]=float((g.id(*e)*37)%101);
+                for(AdjacencyListGraph::NodeIt n(g);n!=lemon::INVALID;++n)
+                    nodeFeatures2[*n]=float((g.id(*n)*13)%29);
+                MergeGraphType mergeGraph2(g);
+                ClusterOperator op2(mergeGraph2,edgeIndicator2,edgeSize2,nodeFeatures2,nodeSize2,minWeight2,
+                                    beta,metrics::ManhattanMetric,wardness);
+                HCluster hc2(op2,HCluster::Parameter(stopAt[k], k != 0));
+                hc2.cluster();
+                shouldEqual(mergeGraph2.nodeNum(), stopAt[k]);
+                if(k == 0){
+                    // the merge tree requires the encoding
+                    try{
+                        hc2.mergeTree();
+                        failTest("mergeTree() failed to throw without merge tree encoding.");
+                    }
+                    catch(PreconditionViolation &){}
+                }
+
+                std::vector<MergeGraphType::index_type> labels(g.maxNodeId()+1);
+                tree.labelsAfterMerges(g.nodeNum()-stopAt[k], labels.begin());
+                std::map<MergeGraphType::index_type,MergeGraphType::index_type> reprToLabel, labelToRepr;
+                for(AdjacencyListGraph::NodeIt n(g);n!=lemon::INVALID;++n){
+                    const MergeGraphType::index_type repr  = mergeGraph2.reprNodeId(g.id(*n));
+                    const MergeGraphType::index_type label = labels[g.id(*n)];
+                    should(label <= g.id(*n));
+                    if(reprToLabel.count(repr)==0){
+                        reprToLabel[repr]=label;
+                        should(labelToRepr.count(label)==0);
+                        labelToRepr[label]=repr;
+                    }
+                    shouldEqual(reprToLabel[repr], label);
+                }
+            }
+
+            if(!withCycles){
+                // the weights never change, so that the levels are monotonic
+                // and cutting at a threshold is a prefix of the merges
+                std::vector<MergeGraphType::index_type> labels(g.maxNodeId()+1), labels2(g.maxNodeId()+1);
+                const float thresholds[] = {-1.0f, 20.0f, 50.5f, 100.0f};
+                for(int k=0;k<4;++k){
+                    size_t mergeNum=0;
+                    while(mergeNum<tree.mergeNum() && hc.mergeTreeEndcoding()[mergeNum].w_<=thresholds[k])
+                        ++mergeNum;
+                    tree.labelsAtThreshold(thresholds[k], labels.begin());
+                    tree.labelsAfterMerges(mergeNum, labels2.begin());
+                    shouldEqualSequence(labels.begin(), labels.end(), labels2.begin());
+                }
+                tree.labelsAtThreshold(1000.0f, labels.begin());
+                for(size_t i=0;i<labels.size();++i)
+                    shouldEqual(labels[i], 0);
+            }
+        }
+    }
+
     size_t degreeSum(const MergeGraphType & g){
         size_t degreeSum=0;
         for(NodeIt n(g);n!=lemon::INVALID;++n){
@@ -1716,6 +1925,8 @@ struct AdjacencyListGraphMergeGraphAdaptorTestSuite
         // test which do some merging
         add( testCase( &AdjacencyListGraph2MergeGraphTest<vigra::UInt32>::GraphMergeGridDegreeTest));
         add( testCase( &AdjacencyListGraph2MergeGraphTest<vigra::UInt32>::GraphMergeGridEdgeTest));
+        add( testCase( &AdjacencyListGraph2MergeGraphTest<vigra::UInt32>::HierarchicalClusteringLazyTest));
+        add( testCase( &AdjacencyListGraph2MergeGraphTest<vigra::UInt32>::HierarchicalClusteringMergeTreeTest));
     }
 };
 
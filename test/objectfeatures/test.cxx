@@ -41,6 +41,9 @@
 #include <vigra/unittest.hxx>
 #include <vigra/multi_array.hxx>
 #include <vigra/accumulator.hxx>
+#include <vigra/blockwise_features.hxx>
+#include <vigra/scalar_region_statistics.hxx>
+#include <vigra/random.hxx>
 
 namespace std {
 
@@ -735,6 +738,322 @@ struct AccumulatorTest
         shouldEqualTolerance(get<Kurtosis>(a), -1.0054784514243973, 1e-15);
     }
 
+    void testChunkedFeatures()
+    {
+        using namespace vigra::acc;
+        
+        typedef Shape3 V;
+        typedef TinyVector<double, 3> P;
+        
+        V shape(23, 17, 9);
+        MultiArray<3, float> data(shape);
+        MultiArray<3, unsigned int> labels(shape);
+        
+        RandomMT19937 random(42);
+        for(MultiArrayIndex k=0; k<data.size(); ++k)
+        {
+            data[k] = (float)random.uniform();
+            labels[k] = random.uniformInt(7);
+        }
+        labels[0] = 8; // label 7 does not occur
+        
+        ChunkedArrayLazy<3, float> chunkedData(shape, V(8));
+        ChunkedArrayLazy<3, unsigned int> chunkedLabels(shape, V(8)),
+                                          otherChunkedLabels(shape, V(4));
+        chunkedData.commitSubarray(V(0), data);
+        chunkedLabels.commitSubarray(V(0), labels);
+        otherChunkedLabels.commitSubarray(V(0), labels);
+        
+        typedef AccumulatorChainArray<CoupledArrays<3, float, unsigned int>, 
+                                      Select<DataArg<1>, LabelArg<2>, Count, Mean, Variance, 
+                                             Skewness, Minimum, Maximum, RegionCenter, 
+                                             Coord<Minimum>, Coord<Maximum>, Global<Count> > > A;
+        
+        A ref;
+        extractFeatures(data, labels, ref);
+        
+        shouldEqual(ref.maxRegionLabel(), 8);
+        shouldEqual(2, ref.passesRequired());
+        
+        A serial, parallel, otherChunks;
+        extractFeatures(chunkedData, chunkedLabels, serial, ParallelOptions().numThreads(1));
+        extractFeatures(chunkedData, chunkedLabels, parallel, ParallelOptions().numThreads(4));
+        extractFeatures(chunkedData, otherChunkedLabels, otherChunks, ParallelOptions().numThreads(3));
+        
+        A * results[] = { &serial, &parallel, &otherChunks };
+        for(int i=0; i<3; ++i)
+        {
+            A & a = *results[i];
+            shouldEqual(a.maxRegionLabel(), 8);
+            shouldEqual(get<Global<Count> >(a), get<Global<Count> >(ref));
+            for(int k=0; k<=8; ++k)
+            {
+                shouldEqual(get<Count>(a, k), get<Count>(ref, k));
+                if(k == 7)
+                    continue;
+                shouldEqual(get<Minimum>(a, k), get<Minimum>(ref, k));
+                shouldEqual(get<Maximum>(a, k), get<Maximum>(ref, k));
+                shouldEqual(get<Coord<Minimum> >(a, k), get<Coord<Minimum> >(ref, k));
+                shouldEqual(get<Coord<Maximum> >(a, k), get<Coord<Maximum> >(ref, k));
+                shouldEqualTolerance(get<RegionCenter>(a, k), get<RegionCenter>(ref, k), P(1e-12));
+                shouldEqualTolerance(get<Mean>(a, k), get<Mean>(ref, k), 1e-12);
+                shouldEqualTolerance(get<Variance>(a, k), get<Variance>(ref, k), 1e-12);
+                if(k != 8)
+                    shouldEqualTolerance(get<Skewness>(a, k), get<Skewness>(ref, k), 1e-10);
+            }
+        }
+        
+        A sparse;
+        sparse.setSparseLabels();
+        extractFeatures(chunkedData, chunkedLabels, sparse, ParallelOptions().numThreads(4));
+        shouldEqual(sparse.regionCount(), 8);
+        shouldEqual(sparse.maxRegionLabel(), 8);
+        for(int k=0; k<=8; ++k)
+        {
+            if(k == 7)
+                continue;
+            shouldEqual(get<Count>(sparse, k), get<Count>(ref, k));
+            shouldEqualTolerance(get<Mean>(sparse, k), get<Mean>(ref, k), 1e-12);
+            shouldEqualTolerance(get<RegionCenter>(sparse, k), get<RegionCenter>(ref, k), P(1e-12));
+        }
+        
+        // single-pass chains are merged from several threads
+        typedef AccumulatorChainArray<CoupledArrays<3, float, unsigned int>, 
+                                      Select<DataArg<1>, LabelArg<2>, Count, Mean, RegionCenter> > S;
+        S single;
+        shouldEqual(1, single.passesRequired());
+        extractFeatures(chunkedData, chunkedLabels, single, ParallelOptions().numThreads(4));
+        for(int k=0; k<=8; ++k)
+        {
+            shouldEqual(get<Count>(single, k), get<Count>(ref, k));
+            if(k == 7)
+                continue;
+            shouldEqualTolerance(get<Mean>(single, k), get<Mean>(ref, k), 1e-12);
+            shouldEqualTolerance(get<RegionCenter>(single, k), get<RegionCenter>(ref, k), P(1e-12));
+        }
+        
+        // histograms with automatic range need the minimum and maximum of the entire region
+        typedef AccumulatorChainArray<CoupledArrays<3, float, unsigned int>, 
+                                      Select<DataArg<1>, LabelArg<2>, Count, 
+                                             StandardQuantiles<AutoRangeHistogram<64> > > > Q;
+        Q qref, qparallel;
+        extractFeatures(data, labels, qref);
+        extractFeatures(chunkedData, otherChunkedLabels, qparallel, ParallelOptions().numThreads(4));
+        for(int k=0; k<=8; ++k)
+        {
+            shouldEqual(get<Count>(qparallel, k), get<Count>(qref, k));
+            if(k == 7)
+                continue;
+            shouldEqualSequenceTolerance(get<StandardQuantiles<AutoRangeHistogram<64> > >(qref, k).begin(),
+                                         get<StandardQuantiles<AutoRangeHistogram<64> > >(qref, k).end(),
+                                         get<StandardQuantiles<AutoRangeHistogram<64> > >(qparallel, k).begin(), 
+                                         1e-12);
+        }
+    }
+
+    void testSparseLabels()
+    {
+        using namespace vigra::acc;
+        
+        typedef Shape2 V;
+        typedef TinyVector<double, 2> P;
+        typedef AccumulatorChainArray<CoupledArrays<2, double, UInt32>, 
+                                      Select<DataArg<1>, LabelArg<2>, Count, Mean, Maximum,
+                                             Coord<Sum>, Global<Count> > > A;
+        
+        double d[] = { 1.0, 3.0, 3.0,
+                       1.0, 2.0, 5.0 };
+        UInt32 l[] = { 4000000000u, 7, 7,
+                       4000000000u, 123456789, 7 };
+        MultiArrayView<2, double> data(V(3,2), d);
+        MultiArrayView<2, UInt32> labels(V(3,2), l);
+        
+        A a;
+        should(!a.sparseLabels());
+        a.setSparseLabels();
+        should(a.sparseLabels());
+        
+        extractFeatures(data, labels, a);
+        
+        shouldEqual(a.regionCount(), 3);
+        shouldEqual(a.maxRegionLabel(), 4000000000);
+        shouldEqual(a.regionLabel(0), 4000000000);
+        shouldEqual(a.regionLabel(1), 7);
+        shouldEqual(a.regionLabel(2), 123456789);
+        
+        shouldEqual(6, get<Global<Count> >(a));
+        shouldEqual(2, get<Count>(a, 4000000000));
+        shouldEqual(3, get<Count>(a, 7));
+        shouldEqual(1, get<Count>(a, 123456789));
+        shouldEqual(1.0, get<Mean>(a, 4000000000));
+        shouldEqualTolerance(11.0 / 3.0, get<Mean>(a, 7), 1e-15);
+        shouldEqual(5.0, get<Maximum>(a, 7));
+        shouldEqual(P(0,1), get<Coord<Sum> >(a, 4000000000));
+        shouldEqual(P(5,1), get<Coord<Sum> >(a, 7));
+        
+        try
+        {
+            get<Count>(a, 8);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nAccumulatorChainArray: region label not found.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        
+        // merge sparse with sparse
+        UInt32 l2[] = { 8, 8, 7,
+                        8, 8, 8 };
+        MultiArrayView<2, UInt32> labels2(V(3,2), l2);
+        
+        A b;
+        b.setSparseLabels();
+        extractFeatures(data, labels2, b);
+        shouldEqual(b.regionCount(), 2);
+        
+        b.merge(a);
+        shouldEqual(b.regionCount(), 4);
+        shouldEqual(b.maxRegionLabel(), 4000000000);
+        shouldEqual(12, get<Global<Count> >(b));
+        shouldEqual(4, get<Count>(b, 7));
+        shouldEqual(5, get<Count>(b, 8));
+        shouldEqual(2, get<Count>(b, 4000000000));
+        shouldEqual((11.0 + 3.0) / 4.0, get<Mean>(b, 7));
+        shouldEqual(P(7,1), get<Coord<Sum> >(b, 7));
+        
+        // merge sparse into dense
+        UInt32 l3[] = { 0, 1, 7,
+                        8, 8, 8 };
+        MultiArrayView<2, UInt32> labels3(V(3,2), l3);
+        
+        A c, e;
+        extractFeatures(data, labels3, c);
+        shouldEqual(c.regionCount(), 9);
+        e.setSparseLabels();
+        extractFeatures(data, labels2, e);
+        c.merge(e);
+        shouldEqual(c.regionCount(), 9);
+        shouldEqual(2, get<Count>(c, 7));
+        shouldEqual(8, get<Count>(c, 8));
+        shouldEqual(1, get<Count>(c, 0));
+        
+        // merge with label mapping
+        A f;
+        f.setSparseLabels();
+        ArrayVector<int> mapping(2);
+        mapping[0] = 7;   // region 0 of e has label 8
+        mapping[1] = 11;  // region 1 of e has label 7
+        f.merge(e, mapping);
+        shouldEqual(f.regionCount(), 2);
+        shouldEqual(5, get<Count>(f, 7));
+        shouldEqual(1, get<Count>(f, 11));
+        
+        // merge regions
+        f.merge(7, 11);
+        shouldEqual(6, get<Count>(f, 7));
+        shouldEqual(0, get<Count>(f, 11));
+    }
+
+    void testScalarRegionStatistics()
+    {
+        using namespace vigra::acc;
+        
+        typedef Shape3 V;
+        
+        V shape(19, 11, 7);
+        MultiArray<3, int> data(shape);
+        MultiArray<3, UInt8> labels(shape);
+        
+        RandomMT19937 random(23);
+        for(MultiArrayIndex k=0; k<data.size(); ++k)
+        {
+            data[k] = random.uniformInt(1000) - 500;
+            labels[k] = (k / 4 + random.uniformInt(2)) % 6;  // short runs of equal labels
+        }
+        labels[3] = 7; // label 6 does not occur
+        
+        typedef AccumulatorChainArray<CoupledArrays<3, int, UInt8>, 
+                                      Select<DataArg<1>, LabelArg<2>, Count, Sum, Mean, Minimum, Maximum> > Reference;
+        
+        {
+            Reference ref;
+            extractFeatures(data, labels, ref);
+            
+            ScalarRegionStatistics<int> a;
+            extractFeatures(data, labels, a);
+            
+            shouldEqual(a.regionCount(), 8);
+            shouldEqual(a.maxRegionLabel(), 7);
+            for(int l=0; l<8; ++l)
+            {
+                shouldEqual(get<Count>(a, l), get<Count>(ref, l));
+                shouldEqual(a.count()[l], get<Count>(ref, l));
+                if(l == 6)
+                    continue;
+                shouldEqual(get<Sum>(a, l), get<Sum>(ref, l));
+                shouldEqualTolerance(get<Mean>(a, l), get<Mean>(ref, l), 1e-12);
+                shouldEqual(get<Minimum>(a, l), get<Minimum>(ref, l));
+                shouldEqual(get<Maximum>(a, l), get<Maximum>(ref, l));
+            }
+            shouldEqual(get<Minimum>(a, 6), NumericTraits<int>::max());
+            
+            // strided arrays give the same result
+            ScalarRegionStatistics<int> b;
+            extractFeatures(data.transpose(), labels.transpose(), b);
+            shouldEqualSequence(a.count().begin(), a.count().end(), b.count().begin());
+            shouldEqualSequence(a.sum().begin(), a.sum().end(), b.sum().begin());
+            shouldEqualSequence(a.minimum().begin(), a.minimum().end(), b.minimum().begin());
+            shouldEqualSequence(a.maximum().begin(), a.maximum().end(), b.maximum().begin());
+            
+            try
+            {
+                get<Mean>(a, 8);
+                failTest("no exception thrown");
+            }
+            catch(ContractViolation & c)
+            {
+                std::string expected("\nPrecondition violation!\ngetAccumulator(): region label out of range.");
+                std::string message(c.what());
+                should(0 == expected.compare(message.substr(0,expected.size())));
+            }
+        }
+        
+        {
+            // ignore label and merge of two halves
+            Reference ref;
+            ref.ignoreLabel(0);
+            extractFeatures(data, labels, ref);
+            
+            ScalarRegionStatistics<int> a, b;
+            a.ignoreLabel(0);
+            b.ignoreLabel(0);
+            extractFeatures(data.subarray(V(0), V(19, 11, 3)), labels.subarray(V(0), V(19, 11, 3)), a);
+            extractFeatures(data.subarray(V(0, 0, 3), shape), labels.subarray(V(0, 0, 3), shape), b);
+            a += b;
+            
+            shouldEqual(get<Count>(a, 0), 0.0);
+            for(int l=1; l<8; ++l)
+            {
+                if(l == 6)
+                    continue;
+                shouldEqual(get<Count>(a, l), get<Count>(ref, l));
+                shouldEqual(get<Sum>(a, l), get<Sum>(ref, l));
+                shouldEqual(get<Minimum>(a, l), get<Minimum>(ref, l));
+                shouldEqual(get<Maximum>(a, l), get<Maximum>(ref, l));
+            }
+            
+            a.merge(1, 2);
+            shouldEqual(get<Count>(a, 1), get<Count>(ref, 1) + get<Count>(ref, 2));
+            shouldEqual(get<Count>(a, 2), 0.0);
+            shouldEqual(get<Maximum>(a, 1), std::max(get<Maximum>(ref, 1), get<Maximum>(ref, 2)));
+            
+            a.reset();
+            shouldEqual(a.regionCount(), 0);
+        }
+    }
+
     void testCoordAccess()
     {
         using namespace vigra::acc;
@@ -1121,6 +1440,134 @@ struct AccumulatorTest
         }
     }
 
+    void testTDigest()
+    {
+        using namespace vigra::acc;
+        
+        static const int SIZE = 20000;
+        RandomMT19937 random(17);
+        ArrayVector<double> data(SIZE);
+        for(int k=0; k<SIZE; ++k)
+            data[k] = random.normal(10.0, 3.0);
+        ArrayVector<double> sorted(data);
+        std::sort(sorted.begin(), sorted.end());
+        
+        double desired[] = { 0.0, 0.1, 0.25, 0.5, 0.75, 0.9, 1.0 };
+        TinyVector<double, 7> exact;
+        for(int k=0; k<7; ++k)
+            exact[k] = sorted[std::min(SIZE-1, (int)(desired[k]*SIZE))];
+        
+        typedef AccumulatorChain<double, Select<TDigest<100>, StandardQuantiles<TDigest<100> >, Count> > A;
+        shouldEqual(A().passesRequired(), 1);
+        
+        {
+            A a;
+            extractFeatures(data.begin(), data.end(), a);
+            
+            shouldEqual(get<Count>(a), SIZE);
+            should(get<TDigest<100> >(a).size() <= 200);
+            shouldEqualTolerance(getAccumulator<TDigest<100> >(a).quantile(0.0), sorted[0], 1e-15);
+            shouldEqualTolerance(getAccumulator<TDigest<100> >(a).quantile(1.0), sorted[SIZE-1], 1e-15);
+            shouldEqualTolerance(getAccumulator<TDigest<100> >(a).quantile(0.99), sorted[(int)(0.99*SIZE)], 0.05);
+            shouldEqualSequenceTolerance(exact.begin(), exact.end(), get<StandardQuantiles<TDigest<100> > >(a).begin(), 0.05);
+            
+            double weights = 0.0;
+            for(unsigned int k=0; k<get<TDigest<100> >(a).size(); ++k)
+                weights += get<TDigest<100> >(a)[k][1];
+            shouldEqualTolerance(weights, SIZE, 1e-10);
+        }
+        
+        {
+            // merge digests of three parts
+            A a, b, c;
+            extractFeatures(data.begin(), data.begin()+SIZE/3, a);
+            extractFeatures(data.begin()+SIZE/3, data.begin()+SIZE/2, b);
+            extractFeatures(data.begin()+SIZE/2, data.end(), c);
+            a += b;
+            a += c;
+            
+            shouldEqual(get<Count>(a), SIZE);
+            shouldEqualSequenceTolerance(exact.begin(), exact.end(), get<StandardQuantiles<TDigest<100> > >(a).begin(), 0.05);
+        }
+        
+        {
+            // few data points are represented exactly
+            double d[] = { 4.0, 1.0, 3.0, 2.0, 5.0 };
+            A a;
+            extractFeatures(d, d+5, a);
+            shouldEqual(get<TDigest<100> >(a).size(), 5);
+            shouldEqual(getAccumulator<TDigest<100> >(a).quantile(0.5), 3.0);
+            shouldEqual(get<StandardQuantiles<TDigest<100> > >(a)[0], 1.0);
+            shouldEqual(get<StandardQuantiles<TDigest<100> > >(a)[6], 5.0);
+            
+            a.reset();
+            shouldEqual(get<TDigest<100> >(a).size(), 0);
+        }
+        
+        {
+            // per-region quantiles
+            typedef AccumulatorChainArray<CoupledArrays<1, double, int>, 
+                                          Select<DataArg<1>, LabelArg<2>, StandardQuantiles<TDigest<50> > > > RA;
+            MultiArrayView<1, double> dataView(Shape1(SIZE), data.begin());
+            MultiArray<1, int> labels = MultiArray<1, int>(Shape1(SIZE));
+            for(int k=0; k<SIZE; ++k)
+                labels[k] = k % 2;
+            
+            RA a;
+            extractFeatures(dataView, labels, a);
+            
+            for(int l=0; l<2; ++l)
+            {
+                ArrayVector<double> region;
+                for(int k=l; k<SIZE; k+=2)
+                    region.push_back(data[k]);
+                std::sort(region.begin(), region.end());
+                shouldEqualTolerance(get<StandardQuantiles<TDigest<50> > >(a, l)[3], region[region.size()/2], 0.05);
+                shouldEqual(get<StandardQuantiles<TDigest<50> > >(a, l)[6], region.back());
+            }
+        }
+        
+        {
+            // many small regions and one large region give the same results 
+            // as separate digests of the regions' data
+            typedef AccumulatorChainArray<CoupledArrays<1, double, int>, 
+                                          Select<DataArg<1>, LabelArg<2>, Count, TDigest<100>,
+                                                 StandardQuantiles<TDigest<100> > > > RA;
+            static const int SMALL = 5, REGIONS = 1000;
+            MultiArrayView<1, double> dataView(Shape1(SIZE), data.begin());
+            MultiArray<1, int> labels = MultiArray<1, int>(Shape1(SIZE));
+            for(int k=0; k<SIZE; ++k)
+                labels[k] = k < SMALL*REGIONS ? 1 + k / SMALL : 0;
+            
+            RA a;
+            extractFeatures(dataView, labels, a);
+            shouldEqual(get<Count>(a, 0), SIZE - SMALL*REGIONS);
+            
+            for(int l=0; l<=REGIONS; ++l)
+            {
+                A ref;
+                for(int k=0; k<SIZE; ++k)
+                    if(labels[k] == l)
+                        ref(data[k]);
+                shouldEqual(get<Count>(a, l), get<Count>(ref));
+                shouldEqual(get<TDigest<100> >(a, l).size(), get<TDigest<100> >(ref).size());
+                shouldEqualSequence(get<StandardQuantiles<TDigest<100> > >(a, l).begin(),
+                                    get<StandardQuantiles<TDigest<100> > >(a, l).end(),
+                                    get<StandardQuantiles<TDigest<100> > >(ref).begin());
+                if(l > 0)
+                {
+                    // small regions are represented exactly
+                    ArrayVector<double> region(data.begin() + (l-1)*SMALL, data.begin() + l*SMALL);
+                    std::sort(region.begin(), region.end());
+                    shouldEqual(get<TDigest<100> >(a, l).size(), SMALL);
+                    shouldEqual(getAccumulator<TDigest<100> >(a, l).quantile(0.5), region[SMALL/2]);
+                    shouldEqual(get<StandardQuantiles<TDigest<100> > >(a, l)[0], region[0]);
+                    shouldEqual(get<StandardQuantiles<TDigest<100> > >(a, l)[6], region[SMALL-1]);
+                }
+            }
+        }
+    }
+
     template <class TAG, class A>
     static inline typename acc::LookupDependency<TAG, A>::reference
     getAccumulatorIndirectly(A & a)
@@ -1561,8 +2008,12 @@ struct FeaturesTestSuite : public vigra::test_suite
         add(testCase(&AccumulatorTest::testScalar));
         add(testCase(&AccumulatorTest::testVector));
         add(testCase(&AccumulatorTest::testMerge));
+        add(testCase(&AccumulatorTest::testChunkedFeatures));
+        add(testCase(&AccumulatorTest::testSparseLabels));
+        add(testCase(&AccumulatorTest::testScalarRegionStatistics));
         add(testCase(&AccumulatorTest::testCoordAccess));
         add(testCase(&AccumulatorTest::testHistogram));
+        add(testCase(&AccumulatorTest::testTDigest));
         add(testCase(&AccumulatorTest::testRegionAccumulators));
         add(testCase(&AccumulatorTest::testIndexSpecifiers));
         add(testCase(&AccumulatorTest::testConvexHullFeatures));
@@ -286,6 +286,99 @@ struct SeededRegionGrowing3DTest
 
         shouldEqualSequence(res.begin(), res.end(), vol3.begin());
     }
+
+    void multiArrayTest()
+    {
+        // same result as voronoiTestWithBorder()
+        IntVolume res(vol1.shape());
+        vigra::ArrayOfRegionStatistics<DirectCostFunctor> cost(2);
+        shouldEqual(seededRegionGrowingMultiArray(distvol1, vol1, res, cost, KeepContours), 2);
+        IntVolume ref(vol1);
+        seededRegionGrowing3D(srcMultiArrayRange(distvol1), srcMultiArray(vol1),
+                              destMultiArray(ref), cost, KeepContours);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // random data with many ties: the bucket queue (UInt8 costs) must
+        // reproduce the heap (double costs) exactly
+        MultiArrayShape<3>::type shape(30, 20, 25);
+        MultiArray<3, UInt8>  data8(shape);
+        MultiArray<3, double> data(shape);
+        MultiArray<3, int>    seeds(shape);
+        unsigned int seed = 17;
+        for(int k=0; k<data8.size(); ++k)
+        {
+            seed = (seed * 1103515245u + 12345u) & 0x7fffffff;
+            data8[k] = (UInt8)(seed % 8);
+            data[k] = data8[k];
+            if(seed % 97 == 0)
+                seeds[k] = 1 + (seed / 97) % 20;
+        }
+
+        vigra::ArrayOfRegionStatistics<SeedRgDirectValueFunctor<UInt8> >  stats8(20);
+        vigra::ArrayOfRegionStatistics<SeedRgDirectValueFunctor<double> > stats(20);
+        IntVolume res8(shape), resd(shape);
+
+        int types[] = { CompleteGrow, KeepContours, KeepContours | StopAtThreshold };
+        for(int t=0; t<3; ++t)
+        {
+            SRGType srgType = (SRGType)types[t];
+            for(int n=0; n<2; ++n)
+            {
+                NeighborhoodType neighborhood = n == 0 ? DirectNeighborhood : IndirectNeighborhood;
+                res8.init(0);
+                resd.init(0);
+                seededRegionGrowingMultiArray(data8, seeds, res8, stats8, srgType, neighborhood, 5.0);
+                seededRegionGrowingMultiArray(data, seeds, resd, stats, srgType, neighborhood, 5.0);
+                shouldEqualSequence(res8.begin(), res8.end(), resd.begin());
+                if(srgType == CompleteGrow)
+                    should(res8.all());
+            }
+        }
+
+        // without ties, the result equals the one of seededRegionGrowing3D()
+        for(int k=0; k<data.size(); ++k)
+            data[k] += k * 1e-6;
+        seededRegionGrowingMultiArray(data, seeds, resd, stats, KeepContours);
+        seededRegionGrowing3D(data, seeds, res8, stats, KeepContours);
+        shouldEqualSequence(res8.begin(), res8.end(), resd.begin());
+    }
+
+    void bucketQueueTest()
+    {
+        // seededRegionGrowing3D() with UInt8 costs uses the bucket queue
+        // and must reproduce the heap (double costs) exactly
+        MultiArrayShape<3>::type shape(25, 30, 20);
+        MultiArray<3, UInt8>  data8(shape);
+        MultiArray<3, double> data(shape);
+        MultiArray<3, int>    seeds(shape);
+        unsigned int seed = 4711;
+        for(int k=0; k<data8.size(); ++k)
+        {
+            seed = (seed * 1103515245u + 12345u) & 0x7fffffff;
+            data8[k] = (UInt8)(seed % 8);
+            data[k] = data8[k];
+            if(seed % 89 == 0)
+                seeds[k] = 1 + (seed / 89) % 20;
+        }
+
+        vigra::ArrayOfRegionStatistics<SeedRgDirectValueFunctor<UInt8> >  stats8(20);
+        vigra::ArrayOfRegionStatistics<SeedRgDirectValueFunctor<double> > stats(20);
+        IntVolume res8(shape), resd(shape);
+
+        int types[] = { CompleteGrow, KeepContours, KeepContours | StopAtThreshold };
+        for(int t=0; t<3; ++t)
+        {
+            SRGType srgType = (SRGType)types[t];
+            seededRegionGrowing3D(data8, seeds, res8, stats8, srgType, NeighborCode3DSix(), 5.0);
+            seededRegionGrowing3D(data, seeds, resd, stats, srgType, NeighborCode3DSix(), 5.0);
+            shouldEqualSequence(res8.begin(), res8.end(), resd.begin());
+
+            seededRegionGrowing3D(data8, seeds, res8, stats8, srgType, NeighborCode3DTwentySix(), 5.0);
+            seededRegionGrowing3D(data, seeds, resd, stats, srgType, NeighborCode3DTwentySix(), 5.0);
+            shouldEqualSequence(res8.begin(), res8.end(), resd.begin());
+        }
+        should(res8.any());
+    }
     
     IntVolume    vol1;
     DoubleVolume vol2;
@@ -305,6 +398,8 @@ struct SeededRegionGrowing3DTestSuite
         add( testCase( &SeededRegionGrowing3DTest::voronoiTest));
         add( testCase( &SeededRegionGrowing3DTest::voronoiTestWithBorder));
         add( testCase( &SeededRegionGrowing3DTest::simpleTest));
+        add( testCase( &SeededRegionGrowing3DTest::multiArrayTest));
+        add( testCase( &SeededRegionGrowing3DTest::bucketQueueTest));
     }
 };
 
@@ -120,6 +120,22 @@ struct SlicTest
 
         should(labels == labels_ref);
     }
+
+    void test_slic_parallel()
+    {
+        IArray labels_ref(lennaImage.shape());
+        importImage(ImageImportInfo("slic.xv"), destImage(labels_ref));
+
+        // the result does not depend on the number of threads
+        for(int threads=0; threads<=4; ++threads)
+        {
+            IArray labels(lennaImage.shape());
+            int maxlabel = slicSuperpixels(lennaImage, labels, 20.0, 8, 
+                                           SlicOptions().minSize(0).iterations(40).numThreads(threads));
+            shouldEqual(maxlabel, 245);
+            should(labels == labels_ref);
+        }
+    }
 };
 
 
@@ -131,6 +147,7 @@ struct Slic2dTestSuite
     {
         add( testCase( &SlicTest<2>::test_seeding));
         add( testCase( &SlicTest<2>::test_slic));
+        add( testCase( &SlicTest<2>::test_slic_parallel));
     }
 };
 
@@ -1441,6 +1441,32 @@ def _genGraphSegmentationFunctions():
     edgeWeightedWatersheds.__module__ = 'vigra.graphs'
     graphs.edgeWeightedWatersheds = edgeWeightedWatersheds
 
+    def shortestPathVoronoi(graph,edgeWeights,seeds,nThreads=-1,delta=0.0,distances=None,labels=None):
+        """ geodesic distance to the nearest seed and Voronoi labeling
+
+        Keyword Arguments :
+
+            - graph : input graph
+
+            - edgeWeights : non-negative edge weights
+
+            - seeds : node map with seed labels (0 means: no seed)
+
+            - nThreads : number of threads (default: -1 means as many as there are cores,
+                0 means: sequential Dijkstra search)
+
+            - delta : bucket width of the parallel delta-stepping search
+                (default : 0.0 means the mean edge weight)
+
+        Returns the tuple (distances, labels). Ties are resolved in favor of the smaller label.
+        """
+        return graphs._shortestPathVoronoi(graph=graph,edgeWeights=edgeWeights,seeds=seeds,
+                                           nThreads=nThreads,delta=delta,
+                                           distances=distances,labels=labels)
+
+    shortestPathVoronoi.__module__ = 'vigra.graphs'
+    graphs.shortestPathVoronoi = shortestPathVoronoi
+
     def nodeWeightedWatershedsSeeds(graph,nodeWeights,out=None):
         """ generate watersheds seeds
 
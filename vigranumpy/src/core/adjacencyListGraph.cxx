@@ -67,6 +67,9 @@ namespace vigra{
         .def(LemonGraphShortestPathVisitor<Graph>(clsName))
         .def(LemonGraphRagVisitor<Graph>(clsName))
         .def(LemonGraphHierachicalClusteringVisitor<Graph>(clsName))
+        .def("freeze", &Graph::freeze,
+            "Store the adjacency in compact (CSR) form. The graph cannot be modified afterwards.")
+        .add_property("isFrozen", &Graph::isFrozen)
         ;
     }
 } 
@@ -135,6 +135,22 @@ public:
             ),
             "Felzenwalb graph based segmentation"
         );
+
+        python::def("_shortestPathVoronoi",registerConverters(&pyShortestPathVoronoi),
+            (
+                python::arg("graph"),
+                python::arg("edgeWeights"),
+                python::arg("seeds"),
+                python::arg("nThreads")=-1,
+                python::arg("delta")=0.0f,
+                python::arg("distances")=python::object(),
+                python::arg("labels")=python::object()
+            ),
+            "Geodesic distance to the nearest seed and the label of that seed.\n"
+            "Returns the tuple (distances, labels). With nThreads=0, a sequential Dijkstra\n"
+            "search is used, otherwise parallel delta-stepping with bucket width 'delta'\n"
+            "(0 means: mean edge weight)."
+        );
     }
 
     void exportMiscAlgorithms()const{
@@ -435,6 +451,33 @@ public:
         return labelsArray;
     }
 
+    static python::tuple pyShortestPathVoronoi(
+        const GRAPH & g,
+        FloatEdgeArray edgeWeightsArray,
+        UInt32NodeArray seedsArray,
+        const int nThreads,
+        const float delta,
+        FloatNodeArray distancesArray,
+        UInt32NodeArray labelsArray
+    ){
+        // resize output ? 
+        distancesArray.reshapeIfEmpty( IntrinsicGraphShape<Graph>::intrinsicNodeMapShape(g) );
+        labelsArray.reshapeIfEmpty( IntrinsicGraphShape<Graph>::intrinsicNodeMapShape(g) );
+
+        // numpy arrays => lemon maps
+        FloatEdgeArrayMap  edgeWeightsArrayMap(g,edgeWeightsArray);
+        UInt32NodeArrayMap seedsArrayMap(g,seedsArray);
+        FloatNodeArrayMap  distancesArrayMap(g,distancesArray);
+        UInt32NodeArrayMap labelsArrayMap(g,labelsArray);
+
+        {
+            PyAllowThreads _pythread;
+            shortestPathVoronoi(g,edgeWeightsArrayMap,seedsArrayMap,distancesArrayMap,labelsArrayMap,
+                                ParallelOptions().numThreads(nThreads),delta);
+        }
+        return python::make_tuple(distancesArray,labelsArray);
+    }
+
     static NumpyAnyArray pyNodeWeightedWatershedsSegmentation(
         const Graph &       g,
         FloatNodeArray      nodeWeightsArray,
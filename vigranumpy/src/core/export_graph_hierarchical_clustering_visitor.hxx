@@ -160,6 +160,23 @@ public:
                 python::arg("out")=python::object()
             )
         )
+        .def("resultLabelsAtThreshold",registerConverters(&pyResultLabelsAtThreshold<HCluster>),
+            (
+                python::arg("threshold"),
+                python::arg("out")=python::object()
+            )
+        )
+        .def("resultLabelsAtNodeNum",registerConverters(&pyResultLabelsAtNodeNum<HCluster>),
+            (
+                python::arg("nodeNum"),
+                python::arg("out")=python::object()
+            )
+        )
+        .def("mergeLevels",registerConverters(&pyMergeLevels<HCluster>),
+            (
+                python::arg("out")=python::object()
+            )
+        )
         ;
 
         // free function
@@ -292,6 +309,72 @@ public:
         return resultArray;
     }
 
+    template<class HCLUSTER>
+    static NumpyAnyArray pyMergeTreeLabels(
+        const HCLUSTER  & hcluster,
+        const std::vector<typename HCLUSTER::MergeGraphIndexType> & labels,
+        UInt32NodeArray   resultArray
+    ){
+        resultArray.reshapeIfEmpty(IntrinsicGraphShape<Graph>::intrinsicNodeMapShape(hcluster.graph()));
+
+        UInt32NodeArrayMap resultArrayMap(hcluster.graph(),resultArray);
+
+        for(NodeIt iter(hcluster.graph());iter!=lemon::INVALID;++iter ){
+            resultArrayMap[*iter]=labels[hcluster.graph().id(*iter)];
+        }
+        return resultArray;
+    }
+
+    template<class HCLUSTER>
+    static NumpyAnyArray pyResultLabelsAtThreshold(
+        const HCLUSTER  & hcluster,
+        const float       threshold,
+        UInt32NodeArray   resultArray
+    ){
+        // the merge tree is built on the first call (while holding the GIL) 
+        // and cached in hcluster
+        const typename HCLUSTER::MergeTree & tree = hcluster.mergeTree();
+        std::vector<typename HCLUSTER::MergeGraphIndexType> labels(hcluster.graph().maxNodeId()+1);
+        {
+            PyAllowThreads _pythread;
+            tree.labelsAtThreshold(threshold,labels.begin());
+        }
+        return pyMergeTreeLabels(hcluster,labels,resultArray);
+    }
+
+    template<class HCLUSTER>
+    static NumpyAnyArray pyResultLabelsAtNodeNum(
+        const HCLUSTER  & hcluster,
+        const size_t      nodeNum,
+        UInt32NodeArray   resultArray
+    ){
+        vigra_precondition(nodeNum>=hcluster.mergeGraph().nodeNum() && nodeNum<=hcluster.graph().nodeNum(),
+            "resultLabelsAtNodeNum(): nodeNum must be between the final and the initial number of nodes.");
+        const typename HCLUSTER::MergeTree & tree = hcluster.mergeTree();
+        std::vector<typename HCLUSTER::MergeGraphIndexType> labels(hcluster.graph().maxNodeId()+1);
+        {
+            PyAllowThreads _pythread;
+            tree.labelsAfterMerges(hcluster.graph().nodeNum()-nodeNum,labels.begin());
+        }
+        return pyMergeTreeLabels(hcluster,labels,resultArray);
+    }
+
+    template<class HCLUSTER>
+    static NumpyAnyArray pyMergeLevels(
+        const HCLUSTER  & hcluster,
+        FloatNodeArray    resultArray
+    ){
+        const typename HCLUSTER::MergeTree & tree = hcluster.mergeTree();
+        resultArray.reshapeIfEmpty(IntrinsicGraphShape<Graph>::intrinsicNodeMapShape(hcluster.graph()));
+
+        FloatNodeArrayMap resultArrayMap(hcluster.graph(),resultArray);
+
+        for(NodeIt iter(hcluster.graph());iter!=lemon::INVALID;++iter ){
+            resultArrayMap[*iter]=tree.mergeLevel(hcluster.graph().id(*iter));
+        }
+        return resultArray;
+    }
+
     template<class HCLUSTER>
     static python::tuple mergeTreeEncodingAsNumpyArray(const HCLUSTER & hcluster) {
         typedef typename HCLUSTER::MergeTreeEncoding      MergeTreeEncoding;
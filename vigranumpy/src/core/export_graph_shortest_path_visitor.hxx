@@ -149,6 +149,13 @@ public:
                 python::arg("target")
             )
         )
+        .def("runBidirectional",registerConverters(&runShortestPathBidirectional),
+            (
+                python::arg("edgeWeights"),
+                python::arg("source"),
+                python::arg("target")
+            )
+        )
         .def("nodeIdPath",registerConverters(&makeNodeIdPath),
             (
                 python::arg("target"),
@@ -280,6 +287,19 @@ public:
         sp.run(edgeWeightsArrayMap,source,target);
     }
 
+    static void runShortestPathBidirectional(
+        ShortestPathDijkstraType & sp,
+        FloatEdgeArray edgeWeightsArray,
+        PyNode source,
+        PyNode target
+    ){
+        // numpy arrays => lemon maps
+        FloatEdgeArrayMap edgeWeightsArrayMap(sp.graph(),edgeWeightsArray);
+
+        // run algorithm itself
+        sp.runBidirectional(edgeWeightsArrayMap,source,target);
+    }
+
     static void runShortestPathNoTarget(
         ShortestPathDijkstraType & sp,
         FloatEdgeArray edgeWeightsArray,